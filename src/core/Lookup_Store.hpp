@@ -11,6 +11,8 @@
 #include "util/Matrix.hpp"
 #include "util/maps.hpp"
 #include "util/Range.hpp"
+#include "seq/Sequence_View.hpp"
+#include "util/Memory_Budget.hpp"
 
 constexpr size_t INVALID = std::numeric_limits<size_t>::max();
 
@@ -30,11 +32,13 @@ class Lookup_Store {
 public:
   using lookup_type = Matrix<double>;
 
-  Lookup_Store(const size_t num_branches, const size_t num_states)
+  Lookup_Store(const size_t num_branches, const size_t num_states,
+               Memory_Budget* budget = nullptr)
       : branch_(num_branches),
         store_(num_branches),
         char_map_size_((num_states == 4) ? NT_MAP_SIZE : AA_MAP_SIZE),
-        char_map_((num_states == 4) ? NT_MAP : AA_MAP) {
+        char_map_((num_states == 4) ? NT_MAP : AA_MAP),
+        budget_(budget) {
     const bool dna = (num_states == 4);
 
     for (size_t i = 0; i < 128; ++i) {
@@ -65,10 +69,26 @@ public:
       char_to_posish_['x'] = char_to_posish_['N'];
     }
     char_to_posish_['?'] = char_to_posish_['-'];
+
+    if (budget_) {
+      budget_pool_ =
+          budget_->add_pool(num_branches, [this](const size_t branch_id) {
+            std::unique_lock<std::mutex> lock(branch_[branch_id], std::try_to_lock);
+            if (not lock) {
+              return false;
+            }
+            store_[branch_id] = lookup_type();
+            return true;
+          });
+    }
   }
 
   Lookup_Store() = delete;
-  ~Lookup_Store() = default;
+  ~Lookup_Store() {
+    if (budget_) {
+      budget_->release_pool(budget_pool_);
+    }
+  }
 
   void init_branch(const size_t branch_id, std::vector<std::vector<double>> precomps) {
     store_[branch_id] = Matrix<double>(precomps[0].size(), char_map_size_);
@@ -84,6 +104,18 @@ public:
 
   bool has_branch(const size_t branch_id) { return store_[branch_id].size() != 0; }
 
+  /**
+   * Keeps the lookup table of the branch from being evicted under a memory budget. To be called
+   * while holding the mutex of the branch, once the table is initialized.
+   */
+  Memory_Budget::Pin pin(const size_t branch_id) {
+    if (not budget_) {
+      return Memory_Budget::Pin();
+    }
+    return budget_->acquire(budget_pool_, branch_id,
+                            store_[branch_id].size() * sizeof(lookup_type::value_type));
+  }
+
   lookup_type& operator[](const size_t branch_id) { return store_[branch_id]; }
 
   unsigned char char_map(const size_t i) {
@@ -107,9 +139,10 @@ public:
     return pos;
   }
 
-  double sum_precomputed_sitelk(const size_t branch_id, const std::string& seq,
+  double sum_precomputed_sitelk(const size_t branch_id, const Sequence_View& sequence,
                                 const Range& range) const {
-    assert(seq.length() == store_[branch_id].rows());
+    assert(sequence.size() == store_[branch_id].rows());
+    auto const seq = sequence.sites();
 
     double sum = 0;
     const auto& lookup_matrix = store_[branch_id];
@@ -146,4 +179,6 @@ private:
   const size_t char_map_size_;
   const unsigned char* char_map_;
   std::array<size_t, 128> char_to_posish_;
+  Memory_Budget* budget_;
+  size_t budget_pool_ = 0;
 };
@@ -0,0 +1,118 @@
+#include "core/Query_Dedup.hpp"
+
+#include <limits>
+#include <cstring>
+
+#ifdef __OMP
+#include <omp.h>
+#endif
+
+void Query_Dedup::reduce(const MSA_Chunk& chunk, MSA_Chunk& unique, const size_t num_threads) {
+#ifdef __OMP
+  const size_t threads = num_threads ? num_threads : omp_get_max_threads();
+#else
+  static_cast<void>(num_threads);
+#endif
+
+  unique.clear();
+  unique_index_.clear();
+  unique_hash_.clear();
+  chunk_unique_.clear();
+  duplicates_.clear();
+  known_.clear();
+
+  hashes_.resize(chunk.size());
+#ifdef __OMP
+#pragma omp parallel for schedule(static) num_threads(threads)
+#endif
+  for (size_t i = 0; i < chunk.size(); ++i) {
+    const auto s = chunk[i];
+    hashes_[i] = hash_sequence(s.sites(), s.size());
+  }
+
+  for (size_t i = 0; i < chunk.size(); ++i) {
+    const auto& hash = hashes_[i];
+
+    const auto placed = placed_.find(hash);
+    if (placed != placed_.end()) {
+      known_.emplace_back(i, placed->second);
+      continue;
+    }
+
+    const auto first = chunk_unique_.find(hash);
+    if (first != chunk_unique_.end()) {
+      duplicates_.emplace_back(first->second, i);
+      continue;
+    }
+
+    chunk_unique_.emplace(hash, unique_index_.size());
+    unique_index_.push_back(i);
+    unique_hash_.push_back(hash);
+
+    const auto s = chunk[i];
+    auto const sites = unique.append(s.header_data(), s.header_size(), s.size(), s.range());
+    std::memcpy(sites, s.sites(), s.size());
+  }
+}
+
+void Query_Dedup::expand(const MSA_Chunk& chunk, Columnar_Sample& sample,
+                         const size_t seq_id_offset) {
+  constexpr auto NONE = std::numeric_limits<size_t>::max();
+
+  // where the placed queries are in the sample
+  std::vector<size_t> sample_index(unique_index_.size(), NONE);
+  for (size_t q = 0; q < sample.size(); ++q) {
+    const auto u = sample.sequence_id(q) - seq_id_offset;
+    if (u >= unique_index_.size()) {
+      throw std::runtime_error{"In Query_Dedup: unexpected sequence id"};
+    }
+    sample_index[u] = q;
+  }
+
+  for (auto const& duplicate : duplicates_) {
+    const auto q = sample_index[duplicate.first];
+    if (q != NONE) {
+      sample.add_name(q, chunk[duplicate.second].header());
+    }
+  }
+
+  // queries known from earlier chunks get their own pquery, one per distinct sequence
+  std::unordered_map<size_t, size_t> added;
+  auto seq_id = seq_id_offset + unique_index_.size();
+  for (auto const& known : known_) {
+    const auto s = chunk[known.first];
+    const auto it = added.find(known.second);
+    if (it != added.end()) {
+      sample.add_name(it->second, s.header());
+      continue;
+    }
+    const auto q = sample.add_pquery(seq_id++, s.header_data(), s.header_size(), 0);
+    for (auto const& p : results_[known.second]) {
+      sample.add_placement(p);
+    }
+    added.emplace(known.second, q);
+  }
+}
+
+void Query_Dedup::record(const Columnar_Sample& sample, const size_t seq_id_offset,
+                         const fn_type& fn) {
+  for (size_t q = 0; q < sample.size(); ++q) {
+    const auto u = sample.sequence_id(q) - seq_id_offset;
+    // skip the queries that expand added
+    if (u >= unique_index_.size()) {
+      continue;
+    }
+    auto placements = sample.placements(q);
+    if (fn) {
+      fn(unique_hash_[u], placements);
+    }
+    add_result(unique_hash_[u], std::move(placements));
+  }
+}
+
+void Query_Dedup::add_result(const Sequence_Hash& hash, std::vector<Placement> placements) {
+  if (not full() and placed_.emplace(hash, results_.size()).second) {
+    results_.push_back(std::move(placements));
+    result_hashes_.push_back(hash);
+  }
+}
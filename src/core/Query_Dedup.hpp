@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <limits>
+#include <functional>
+
+#include "seq/MSA_Chunk.hpp"
+#include "seq/Sequence_Hash.hpp"
+#include "sample/Columnar_Sample.hpp"
+#include "sample/Placement.hpp"
+
+/**
+  Places every distinct (masked) query sequence only once.
+
+  Before placement, reduce cuts a chunk down to the queries that are left to place: those equal
+  to an earlier query of the same chunk are set aside, as are those whose sequence was placed in
+  an earlier chunk. After placement, expand adds the headers of the set aside queries to the
+  results of the placed ones, which the jplace output lists in the "n" array of the pquery. The
+  queries known from earlier chunks get a copy of the results of back then. Once the placed
+  queries are filtered, record keeps their results for the chunks to come.
+
+  Queries are recognized by a 128 bit hash of their sites, so only the hashes and the final
+  (filtered) placements of the distinct sequences are kept across chunks, and at most those of
+  max_results of them. Once that many are kept, the sequences placed later are only recognized
+  within their chunk.
+*/
+class Query_Dedup {
+public:
+  using fn_type = std::function<void(const Sequence_Hash&, const std::vector<Placement>&)>;
+
+  explicit Query_Dedup(const size_t max_results = std::numeric_limits<size_t>::max())
+      : max_results_(max_results) {}
+  ~Query_Dedup() = default;
+
+  /**
+    Fills unique with the queries of the chunk that are left to place.
+  */
+  void reduce(const MSA_Chunk& chunk, MSA_Chunk& unique, const size_t num_threads = 0);
+
+  /**
+    Completes the sample of the placed queries, whose sequence ids are seq_id_offset plus their
+    index in the unique chunk. The chunk has to be the one last passed to reduce.
+  */
+  void expand(const MSA_Chunk& chunk, Columnar_Sample& sample, const size_t seq_id_offset);
+
+  /**
+    Keeps the (filtered) results of the placed queries of the sample, as completed by expand, for
+    the chunks to come, as far as there is room. If given, fn is called with the results of every
+    placed query, kept or not.
+  */
+  void record(const Columnar_Sample& sample, const size_t seq_id_offset,
+              const fn_type& fn = nullptr);
+
+  // number of queries of the last chunk that were not placed
+  size_t num_duplicates() const { return duplicates_.size() + known_.size(); }
+
+  /**
+    Adds the results of a sequence placed elsewhere (such as in an earlier run), so that queries
+    with this sequence are not placed again. Ignored once full.
+  */
+  void add_result(const Sequence_Hash& hash, std::vector<Placement> placements);
+
+  // the results of the kept sequences, in the order they were placed or added
+  size_t num_results() const { return results_.size(); }
+  bool full() const { return results_.size() >= max_results_; }
+  const Sequence_Hash& result_hash(const size_t i) const { return result_hashes_[i]; }
+  const std::vector<Placement>& result(const size_t i) const { return results_[i]; }
+
+private:
+  // for every query to place, its index in the chunk and its hash
+  std::vector<size_t> unique_index_;
+  std::vector<Sequence_Hash> unique_hash_;
+  std::vector<Sequence_Hash> hashes_;
+  std::unordered_map<Sequence_Hash, size_t> chunk_unique_;
+  // duplicates within the chunk: index of the query to place, index in the chunk
+  std::vector<std::pair<size_t, size_t>> duplicates_;
+  // queries placed in an earlier chunk: index in the chunk, index of the results
+  std::vector<std::pair<size_t, size_t>> known_;
+
+  // across chunks: the results of the sequences placed so far, up to max_results_ of them
+  size_t max_results_;
+  std::unordered_map<Sequence_Hash, size_t> placed_;
+  std::vector<std::vector<Placement>> results_;
+  std::vector<Sequence_Hash> result_hashes_;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <limits>
 
 #ifdef __OMP
 #include <omp.h>
@@ -38,9 +39,10 @@ static inline size_t get_thread_id() {
 using getiter_t = pq_iter_t(PQuery<Placement>&, double const);
 
 template <typename F>
-static Work heuristic_(Sample<Placement>& sample, const Options& options, F filterstop) {
+static Work heuristic_(Sample<Placement>& sample, const size_t num_pquerys, const Options& options,
+                       F filterstop) {
   Work result;
-  compute_and_set_lwr(sample);
+  compute_and_set_lwr(sample, num_pquerys);
 
   const auto num_threads = get_num_threads(options);
 
@@ -49,7 +51,7 @@ static Work heuristic_(Sample<Placement>& sample, const Options& options, F filt
 #ifdef __OMP
 #pragma omp parallel for schedule(dynamic)
 #endif
-  for (size_t i = 0; i < sample.size(); ++i) {
+  for (size_t i = 0; i < num_pquerys; ++i) {
     auto& pq = sample[i];
     const auto tid = get_thread_id();
 
@@ -63,15 +65,17 @@ static Work heuristic_(Sample<Placement>& sample, const Options& options, F filt
   return result;
 }
 
-Work dynamic_heuristic(Sample<Placement>& sample, const Options& options) {
-  return heuristic_<getiter_t>(sample, options, until_accumulated_reached);
+Work dynamic_heuristic(Sample<Placement>& sample, const size_t num_pquerys,
+                       const Options& options) {
+  return heuristic_<getiter_t>(sample, num_pquerys, options, until_accumulated_reached);
 }
 
-Work fixed_heuristic(Sample<Placement>& sample, const Options& options) {
-  return heuristic_<getiter_t>(sample, options, until_top_percent);
+Work fixed_heuristic(Sample<Placement>& sample, const size_t num_pquerys, const Options& options) {
+  return heuristic_<getiter_t>(sample, num_pquerys, options, until_top_percent);
 }
 
-Work baseball_heuristic(Sample<Placement>& sample, const Options& options) {
+Work baseball_heuristic(Sample<Placement>& sample, const size_t num_pquerys,
+                        const Options& options) {
   Work result;
 
   const auto num_threads = get_num_threads(options);
@@ -87,7 +91,7 @@ Work baseball_heuristic(Sample<Placement>& sample, const Options& options) {
 #ifdef __OMP
 #pragma omp parallel for schedule(dynamic)
 #endif
-  for (size_t i = 0; i < sample.size(); ++i) {
+  for (size_t i = 0; i < num_pquerys; ++i) {
     auto& pq = sample[i];
     const auto tid = get_thread_id();
 
@@ -116,12 +120,18 @@ Work baseball_heuristic(Sample<Placement>& sample, const Options& options) {
   return result;
 }
 
-Work apply_heuristic(Sample<Placement>& sample, const Options& options) {
+/**
+  Selects the candidate branches of the first num_pquerys pquerys of the sample, by default of all
+  of them.
+*/
+Work apply_heuristic(Sample<Placement>& sample, const Options& options,
+                     const size_t num_pquerys = std::numeric_limits<size_t>::max()) {
+  const size_t size = std::min(num_pquerys, static_cast<size_t>(sample.size()));
   if (options.baseball) {
-    return baseball_heuristic(sample, options);
+    return baseball_heuristic(sample, size, options);
   } else if (options.prescoring_by_percentage) {
-    return fixed_heuristic(sample, options);
+    return fixed_heuristic(sample, size, options);
   } else {
-    return dynamic_heuristic(sample, options);
+    return dynamic_heuristic(sample, size, options);
   }
 }
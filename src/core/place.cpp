@@ -5,6 +5,7 @@
 #include <memory>
 #include <functional>
 #include <limits>
+#include <sstream>
 
 #ifdef __OMP
 #include <omp.h>
@@ -13,8 +14,10 @@
 #include "io/file_io.hpp"
 #include "io/jplace_util.hpp"
 #include "io/msa_reader.hpp"
+#include "io/Prefetching_Reader.hpp"
 #include "io/Binary_Fasta.hpp"
 #include "io/jplace_writer.hpp"
+#include "io/Placement_Cache.hpp"
 #include "util/stringify.hpp"
 #include "util/logging.hpp"
 #include "util/Timer.hpp"
@@ -22,14 +25,17 @@
 #include "net/mpihead.hpp"
 #include "pipeline/schedule.hpp"
 #include "pipeline/Pipeline.hpp"
-#include "seq/MSA.hpp"
+#include "seq/MSA_Chunk.hpp"
 #include "core/pll/pll_util.hpp"
 #include "core/pll/epa_pll_util.hpp"
 #include "core/Work.hpp"
 #include "core/Lookup_Store.hpp"
 #include "core/Work.hpp"
 #include "core/heuristics.hpp"
+#include "core/Query_Dedup.hpp"
+#include "core/postprocess.hpp"
 #include "sample/Sample.hpp"
+#include "sample/Columnar_Sample.hpp"
 #include "set_manipulators.hpp"
 
 #ifdef __MPI
@@ -38,10 +44,48 @@
 
 using mytimer = Timer<std::chrono::milliseconds>;
 
+/**
+  Collects the nodes whose buffers the placement of the given work will touch: both ends of every
+  branch in it.
+*/
+static std::vector<pll_unode_t const*> work_nodes(const Work& work,
+                                                  const std::vector<pll_unode_t*>& branches) {
+  std::vector<pll_unode_t const*> nodes;
+  for (auto it = work.bin_cbegin(); it != work.bin_cend(); ++it) {
+    nodes.push_back(branches[it->first]);
+    nodes.push_back(branches[it->first]->back);
+  }
+  return nodes;
+}
+
+/**
+  Key of the placement cache entries of this run: everything besides the query sequence itself
+  that the final placements depend on. The likelihood of the reference tree stands in for the
+  reference alignment.
+*/
+static Sequence_Hash placement_cache_key(Tree& reference_tree, const MSA_Info& msa_info,
+                                         const Options& options) {
+  std::ostringstream key;
+  key.precision(17);
+  key << get_numbered_newick_string(reference_tree.tree(), reference_tree.mapper(), 17) << "\n";
+  key << reference_tree.model().to_string(true) << "\n";
+  key << reference_tree.ref_tree_logl() << "\n";
+  key << msa_info.sites() << " " << msa_info.gap_mask() << "\n";
+  key << options.prescoring << options.prescoring_by_percentage << options.baseball << " "
+      << options.prescoring_threshold << "\n";
+  key << options.sliding_blo << options.premasking << options.repeats << " "
+      << static_cast<int>(options.scaling) << " " << static_cast<int>(options.store_precision)
+      << "\n";
+  key << options.acc_threshold << " " << options.support_threshold << " " << options.filter_min
+      << " " << options.filter_max << "\n";
+  return hash_sequence(key.str());
+}
+
 template <class T>
-static void place(MSA& msa, Tree& reference_tree, const std::vector<pll_unode_t*>& branches,
-                  Sample<T>& sample, const Options& options,
-                  std::shared_ptr<Lookup_Store>& lookup_store, mytimer* time = nullptr) {
+static void place(const MSA_Chunk& msa, Tree& reference_tree,
+                  const std::vector<pll_unode_t*>& branches, Sample<T>& sample,
+                  const Options& options, std::shared_ptr<Lookup_Store>& lookup_store,
+                  mytimer* time = nullptr) {
 #ifdef __OMP
   const unsigned int num_threads =
       options.num_threads ? options.num_threads : omp_get_max_threads();
@@ -94,9 +138,12 @@ static void place(MSA& msa, Tree& reference_tree, const std::vector<pll_unode_t*
   }
 }
 
-template <class T>
-static void place_thorough(const Work& to_place, MSA& msa, Tree& reference_tree,
-                           const std::vector<pll_unode_t*>& branches, Sample<T>& sample,
+/**
+  Places the queries of the work on their candidate branches. Every query gets its slots in the
+  result up front, in the order of the work, so the threads fill them in without any coordination.
+*/
+static void place_thorough(const Work& to_place, const MSA_Chunk& msa, Tree& reference_tree,
+                           const std::vector<pll_unode_t*>& branches, Columnar_Sample& sample,
                            const Options& options, std::shared_ptr<Lookup_Store>& lookup_store,
                            const size_t seq_id_offset = 0, mytimer* time = nullptr) {
 #ifdef __OMP
@@ -109,17 +156,34 @@ static void place_thorough(const Work& to_place, MSA& msa, Tree& reference_tree,
   const unsigned int num_threads = 1;
 #endif
 
-  // split the sample structure such that the parts are thread-local
-  std::vector<Sample<T>> sample_parts(num_threads);
+  if (branches.size() > std::numeric_limits<Columnar_Sample::branch_id_type>::max()) {
+    throw std::runtime_error{"Too many branches in the reference tree"};
+  }
 
-  // build vector of elements
+  // build vector of elements, and count the candidates of every query
   std::vector<Work::Work_Pair> id;
+  std::vector<size_t> num_candidates(msa.size(), 0);
   for (auto it = to_place.begin(); it != to_place.end(); ++it) {
     id.push_back(*it);
+    ++num_candidates[id.back().sequence_id];
   }
 
-  // Map from sequence indices to indices in the pquery vector.
-  auto seq_lookup_vec = std::vector<std::unordered_map<size_t, size_t>>(num_threads);
+  // the queries with candidates, each with its slots
+  sample.clear();
+  sample.reserve(msa.size(), id.size());
+  std::vector<size_t> next_slot(msa.size(), 0);
+  for (size_t seq_id = 0; seq_id < msa.size(); ++seq_id) {
+    if (num_candidates[seq_id]) {
+      const auto seq = msa[seq_id];
+      const auto q = sample.add_pquery(seq_id_offset + seq_id, seq.header_data(),
+                                       seq.header_size(), num_candidates[seq_id]);
+      next_slot[seq_id] = sample.begin(q);
+    }
+  }
+  std::vector<size_t> slot(id.size());
+  for (size_t i = 0; i < id.size(); ++i) {
+    slot[i] = next_slot[id[i].sequence_id]++;
+  }
 
   std::vector<std::unique_ptr<Tiny_Tree>> branch_ptrs(num_threads);
   auto prev_branch_id = std::numeric_limits<size_t>::max();
@@ -137,12 +201,8 @@ static void place_thorough(const Work& to_place, MSA& msa, Tree& reference_tree,
 #else
     const auto tid = 0;
 #endif
-    auto& local_sample = sample_parts[tid];
-    auto& seq_lookup = seq_lookup_vec[tid];
-
     const auto branch_id = id[i].branch_id;
-    const auto seq_id = id[i].sequence_id;
-    const auto& seq = msa[seq_id];
+    const auto seq = msa[id[i].sequence_id];
 
     // get a tiny tree representing the current branch,
     // IF the branch has changed. Overwriting the old variable ensures
@@ -153,21 +213,13 @@ static void place_thorough(const Work& to_place, MSA& msa, Tree& reference_tree,
                                                      true, options, lookup_store);
     }
 
-    if (seq_lookup.count(seq_id) == 0) {
-      auto const new_idx = local_sample.add_pquery(seq_id_offset + seq_id, seq.header());
-      seq_lookup[seq_id] = new_idx;
-    }
-    assert(seq_lookup.count(seq_id) > 0);
-    local_sample[seq_lookup[seq_id]].emplace_back(branch_ptrs[tid]->place(seq));
+    sample.set_placement(slot[i], branch_ptrs[tid]->place(seq));
 
     prev_branch_id = branch_id;
   }
   if (time) {
     time->stop();
   }
-  // merge samples back
-  merge(sample, std::move(sample_parts));
-  collapse(sample);
 }
 
 void simple_mpi(Tree& reference_tree, const std::string& query_file, const MSA_Info& msa_info,
@@ -181,17 +233,26 @@ void simple_mpi(Tree& reference_tree, const std::string& query_file, const MSA_I
     throw std::runtime_error{"Traversing the utree went wrong during pipeline startup!"};
   }
 
-  auto lookups = std::make_shared<Lookup_Store>(num_branches, reference_tree.partition()->states);
+  auto lookups = std::make_shared<Lookup_Store>(num_branches, reference_tree.partition()->states,
+                                                reference_tree.budget());
 
-  auto reader = make_msa_reader(query_file, msa_info, options.premasking, true);
+  std::unique_ptr<msa_reader> reader =
+      make_msa_reader(query_file, msa_info, options.premasking, true, options.num_threads);
+#ifdef __PREFETCH
+  if (options.prefetch_chunks) {
+    reader = std::make_unique<Prefetching_Reader>(std::move(reader), options.prefetch_chunks,
+                                                  options.prefetch_memory);
+  }
+#endif
 
   size_t num_sequences = 0;
   Work all_work(std::make_pair(0, num_branches), std::make_pair(0, options.chunk_size));
+  size_t all_work_queries = options.chunk_size;
 
   Work blo_work;
 
   using Sample = Sample<Placement>;
-  MSA chunk;
+  MSA_Chunk chunk;
   size_t sequences_done = 0;  // not just for info output!
 
   // prepare output file
@@ -204,6 +265,29 @@ void simple_mpi(Tree& reference_tree, const std::string& query_file, const MSA_I
 
   Sample preplace(options.chunk_size, num_branches);
 
+  // the results of a chunk, reusing the storage of the previous one
+  Columnar_Sample result;
+
+  // identical queries are placed once, the chunk is reduced to the distinct ones
+  Query_Dedup dedup(options.dedup_across);
+  MSA_Chunk unique;
+
+  // results of earlier runs count as placed already
+  std::unique_ptr<Placement_Cache> cache;
+  if (not options.cache_file.empty()) {
+    cache = std::make_unique<Placement_Cache>(
+        options.cache_file, placement_cache_key(reference_tree, msa_info, options));
+    const auto num_cached =
+        cache->load([&dedup](const Sequence_Hash& hash, std::vector<Placement>& placements) {
+          dedup.add_result(hash, std::move(placements));
+        });
+    LOG_INFO << "Placement cache: " << num_cached << " matching entries in " << cache->path();
+    if (dedup.num_results() < num_cached) {
+      LOG_WARN << "Kept only " << dedup.num_results()
+               << " of the cached entries, see --dedup-across";
+    }
+  }
+
   while ((num_sequences = reader->read_next(chunk, options.chunk_size))) {
     assert(chunk.size() == num_sequences);
 
@@ -211,35 +295,73 @@ void simple_mpi(Tree& reference_tree, const std::string& query_file, const MSA_I
 
     size_t const seq_id_offset = sequences_done + reader->local_seq_offset();
 
-    if (num_sequences < options.chunk_size) {
-      all_work = Work(std::make_pair(0, num_branches), std::make_pair(0, num_sequences));
-      preplace = Sample(num_sequences, num_branches);
+    if (options.dedup) {
+      dedup.reduce(chunk, unique, options.num_threads);
+      LOG_DBG << "Identical queries: " << dedup.num_duplicates() << std::endl;
     }
+    auto const& queries = options.dedup ? unique : chunk;
+    const size_t num_queries = queries.size();
 
-    if (options.prescoring) {
-      LOG_DBG << "Preplacement." << std::endl;
-      place(chunk, reference_tree, branches, preplace, options, lookups);
+    // preplace keeps its rows for a whole chunk, only the first num_queries of them are used
+    if (num_queries != all_work_queries) {
+      all_work = Work(std::make_pair(0, num_branches), std::make_pair(0, num_queries));
+      all_work_queries = num_queries;
+    }
 
-      LOG_DBG << "Selecting candidates." << std::endl;
+    result.clear();
 
-      blo_work = apply_heuristic(preplace, options);
+    if (num_queries) {
+      if (options.prescoring) {
+        LOG_DBG << "Preplacement." << std::endl;
+        auto prefetched = reference_tree.prefetch(work_nodes(all_work, branches));
+        place(queries, reference_tree, branches, preplace, options, lookups);
+        prefetched.get();
 
-    } else {
-      blo_work = all_work;
-    }
+        LOG_DBG << "Selecting candidates." << std::endl;
 
-    Sample blo_sample;
+        blo_work = apply_heuristic(preplace, options, num_queries);
 
-    LOG_DBG << "BLO Placement." << std::endl;
-    place_thorough(blo_work, chunk, reference_tree, branches, blo_sample, options, lookups,
-                   seq_id_offset);
+      } else {
+        blo_work = all_work;
+      }
 
-    // Output
-    compute_and_set_lwr(blo_sample);
-    filter(blo_sample, options);
+      // get the buffers for the candidate branches on their way while the placement starts up
+      auto prefetched = reference_tree.prefetch(work_nodes(blo_work, branches));
 
-    // pass the result chunk to the writer
-    jplace.write(blo_sample);
+      LOG_DBG << "BLO Placement." << std::endl;
+      place_thorough(blo_work, queries, reference_tree, branches, result, options, lookups,
+                     seq_id_offset);
+      prefetched.get();
+    }
+
+    // the queries known from earlier chunks come after the placed ones, with their final results
+    const auto num_placed = result.size();
+    if (options.dedup) {
+      dedup.expand(chunk, result, seq_id_offset);
+    }
+
+    // Output: LWR, filtering and serialization in one pass, passing the buffers to the writer
+    LOG_DBG << "Postprocessing." << std::endl;
+    jplace.write(postprocess(result, num_placed, options, reference_tree.mapper()));
+
+    if (options.dedup) {
+      const auto was_full = dedup.full();
+      Query_Dedup::fn_type add_to_cache;
+      if (cache) {
+        add_to_cache = [&cache](const Sequence_Hash& hash, const std::vector<Placement>& p) {
+          cache->add(hash, p);
+        };
+      }
+      dedup.record(result, seq_id_offset, add_to_cache);
+      if (dedup.full() and not was_full) {
+        LOG_INFO << "Kept the results of " << dedup.num_results()
+                 << " distinct queries, later ones are only recognized within their chunk";
+      }
+    }
+
+    if (cache) {
+      cache->flush();
+    }
 
     sequences_done += num_sequences;
     LOG_INFO << sequences_done << " Sequences done!";
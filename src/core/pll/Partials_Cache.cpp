@@ -0,0 +1,64 @@
+#include "core/pll/Partials_Cache.hpp"
+
+#include "core/pll/Partition_Slices.hpp"
+#include "core/pll/pll_util.hpp"
+
+Partials_Cache::Partials_Cache(pll_partition_t const* const partition)
+    : clv_stamp_(partition->tips + partition->clv_buffers, 0),
+      clv_owner_(partition->tips + partition->clv_buffers, nullptr),
+      pmatrix_stamp_(partition->prob_matrices, 0),
+      pmatrix_length_(partition->prob_matrices, 0.0) {}
+
+void Partials_Cache::update(pll_partition_t* const partition,
+                            pll_unode_t* const* const travbuffer,
+                            const unsigned int traversal_size, double const* const branch_lengths,
+                            unsigned int const* const matrix_indices,
+                            const unsigned int num_matrices, Partition_Slices* const slices) {
+  const auto stamp = ++now_;
+
+  lengths_.clear();
+  matrices_.clear();
+  for (size_t i = 0; i < num_matrices; ++i) {
+    const auto m = matrix_indices[i];
+    if (pmatrix_stamp_[m] <= valid_from_ or pmatrix_length_[m] != branch_lengths[i]) {
+      pmatrix_stamp_[m] = stamp;
+      pmatrix_length_[m] = branch_lengths[i];
+      matrices_.push_back(m);
+      lengths_.push_back(branch_lengths[i]);
+    }
+  }
+
+  // postorder, so any recomputed child is stamped before its parent is checked
+  operations_.clear();
+  for (size_t i = 0; i < traversal_size; ++i) {
+    auto const node = travbuffer[i];
+    if (not node->next) {
+      continue;
+    }
+    auto const left = node->next->back;
+    auto const right = node->next->next->back;
+    const auto own = clv_stamp_[node->clv_index];
+
+    if (clv_owner_[node->clv_index] != node or own <= valid_from_ or own < child_stamp(left) or
+        own < child_stamp(right)) {
+      clv_stamp_[node->clv_index] = stamp;
+      clv_owner_[node->clv_index] = node;
+
+      operations_.push_back(make_operation(node));
+    }
+  }
+
+  std::vector<unsigned int> param_indices(partition->rate_cats, 0);
+  if (not matrices_.empty()) {
+    pll_update_prob_matrices(partition, &param_indices[0], &matrices_[0], &lengths_[0],
+                             matrices_.size());
+  }
+  if (operations_.empty()) {
+    return;
+  }
+  if (slices) {
+    slices->update_partials(&operations_[0], operations_.size());
+  } else {
+    pll_update_partials(partition, &operations_[0], operations_.size());
+  }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "core/pll/pllhead.hpp"
+
+class Partition_Slices;
+
+/**
+  Bookkeeping of which CLVs and pmatrices are still up to date, such that consecutive traversals
+  only recompute what changed in between: pmatrices whose branch length changed, and the CLVs on
+  the path from such a branch (or from a stale CLV) toward the root of the traversal.
+
+  Anything that modifies the partition behind our back (model parameter changes, the pll-modules
+  branch length optimizers) has to be followed by a call to invalidate().
+*/
+class Partials_Cache {
+public:
+  Partials_Cache(pll_partition_t const* const partition);
+  ~Partials_Cache() = default;
+
+  void invalidate() { valid_from_ = ++now_; }
+
+  // record work done outside of update()
+  void computed_clv(pll_unode_t const* const node) {
+    clv_stamp_[node->clv_index] = ++now_;
+    clv_owner_[node->clv_index] = node;
+  }
+  void computed_pmatrix(const unsigned int index, const double length) {
+    pmatrix_stamp_[index] = ++now_;
+    pmatrix_length_[index] = length;
+  }
+
+  /**
+    Executes those of the pmatrix updates and operations of a full (postorder) traversal that are
+    not up to date, on the slices if given.
+  */
+  void update(pll_partition_t* const partition, pll_unode_t* const* const travbuffer,
+              const unsigned int traversal_size, double const* const branch_lengths,
+              unsigned int const* const matrix_indices, const unsigned int num_matrices,
+              Partition_Slices* const slices);
+
+private:
+  size_t child_stamp(pll_unode_t const* const child) const {
+    const auto matrix = pmatrix_stamp_[child->pmatrix_index];
+    return child->next ? std::max(clv_stamp_[child->clv_index], matrix) : matrix;
+  }
+
+  size_t now_ = 1;
+  size_t valid_from_ = 1;
+  std::vector<size_t> clv_stamp_;
+  std::vector<pll_unode_t const*> clv_owner_;
+  std::vector<size_t> pmatrix_stamp_;
+  std::vector<double> pmatrix_length_;
+  std::vector<pll_operation_t> operations_;
+  std::vector<unsigned int> matrices_;
+  std::vector<double> lengths_;
+};
@@ -0,0 +1,206 @@
+#include "core/pll/Partition_Slices.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+
+#ifdef __OMP
+#include <omp.h>
+#endif
+
+#include "core/pll/pll_util.hpp"
+#include "core/raxml/Model.hpp"
+
+static size_t scaler_stride(pll_partition_t const* const partition) {
+  return (partition->attributes & PLL_ATTRIB_RATE_SCALERS) ? partition->rate_cats : 1;
+}
+
+static pll_partition_t* make_slice(pll_partition_t* const partition, const size_t begin,
+                                   const unsigned int sites) {
+  auto slice = pll_partition_create(partition->tips, partition->clv_buffers, partition->states,
+                                    sites, partition->rate_matrices, partition->prob_matrices,
+                                    partition->rate_cats, partition->scale_buffers,
+                                    partition->attributes);
+
+  if (not slice) {
+    throw std::runtime_error{std::string(pll_errmsg)};
+  }
+
+  share_model_buffers(slice, partition);
+
+  free(slice->rate_weights);
+  slice->rate_weights = partition->rate_weights;
+
+  if (slice->pmatrix) {
+    pll_aligned_free(slice->pmatrix[0]);
+  }
+  free(slice->pmatrix);
+  slice->pmatrix = partition->pmatrix;
+
+  if (slice->invariant) {
+    free(slice->invariant);
+  }
+  slice->invariant = partition->invariant ? partition->invariant + begin : nullptr;
+
+  if (slice->pattern_weights) {
+    free(slice->pattern_weights);
+  }
+  slice->pattern_weights = partition->pattern_weights + begin;
+
+  // point the major buffers into those of the original partition
+  const size_t clv_offset = begin * partition->rate_cats * partition->states_padded;
+  for (size_t i = 0; i < partition->tips + partition->clv_buffers; ++i) {
+    pll_aligned_free(slice->clv[i]);
+    slice->clv[i] = partition->clv[i] ? partition->clv[i] + clv_offset : nullptr;
+  }
+
+  const size_t scaler_offset = begin * scaler_stride(partition);
+  for (size_t i = 0; i < partition->scale_buffers; ++i) {
+    free(slice->scale_buffer[i]);
+    slice->scale_buffer[i] =
+        partition->scale_buffer[i] ? partition->scale_buffer[i] + scaler_offset : nullptr;
+  }
+
+  if (partition->attributes & PLL_ATTRIB_PATTERN_TIP) {
+    // sets up the charmap and the slices own tip-tip lookup table
+    std::string sequence(slice->sites, 'A');
+    if (pll_set_tip_states(slice, 0, get_char_map(partition), sequence.c_str()) == PLL_FAILURE) {
+      throw std::runtime_error{"Error setting tip state"};
+    }
+    for (size_t i = 0; i < partition->tips; ++i) {
+      pll_aligned_free(slice->tipchars[i]);
+      slice->tipchars[i] = partition->tipchars[i] + begin;
+    }
+  }
+
+  return slice;
+}
+
+static void slice_destroy(pll_partition_t* slice) {
+  unshare_model_buffers(slice);
+  slice->rate_weights = nullptr;
+  slice->pmatrix = nullptr;
+  slice->invariant = nullptr;
+  slice->pattern_weights = nullptr;
+
+  for (size_t i = 0; i < slice->tips + slice->clv_buffers; ++i) {
+    slice->clv[i] = nullptr;
+  }
+  for (size_t i = 0; i < slice->scale_buffers; ++i) {
+    slice->scale_buffer[i] = nullptr;
+  }
+  if (slice->attributes & PLL_ATTRIB_PATTERN_TIP) {
+    for (size_t i = 0; i < slice->tips; ++i) {
+      slice->tipchars[i] = nullptr;
+    }
+  }
+
+  pll_partition_destroy(slice);
+}
+
+bool Partition_Slices::supports(pll_partition_t const* const partition) {
+  return not(partition->attributes & (PLL_ATTRIB_SITE_REPEATS | PLL_ATTRIB_AB_FLAG));
+}
+
+Partition_Slices::Partition_Slices(pll_partition_t* const partition,
+                                   const unsigned int num_slices)
+    : partition_(partition), param_indices_(partition->rate_cats, 0) {
+  if (partition->attributes & PLL_ATTRIB_SITE_REPEATS) {
+    throw std::runtime_error{"Partition slicing does not support site repeats"};
+  }
+  // the extra states of every slice would overlap the next slice, and each would add the
+  // correction once
+  if (partition->attributes & PLL_ATTRIB_AB_FLAG) {
+    throw std::runtime_error{"Partition slicing does not support ascertainment bias correction"};
+  }
+
+  const size_t num = std::max(1u, std::min(num_slices, partition->sites));
+
+  size_t begin = 0;
+  for (size_t i = 0; i < num; ++i) {
+    // spread the remainder over the first slices
+    const size_t span = partition->sites / num + (i < partition->sites % num ? 1 : 0);
+    slices_.push_back(make_slice(partition, begin, span));
+    begin += span;
+
+    // a slice only fills the sumtable for its own sites
+    auto sumtable = static_cast<double*>(
+        pll_aligned_alloc(span * partition->rate_cats * partition->states_padded * sizeof(double),
+                          partition->alignment));
+    if (not sumtable) {
+      throw std::runtime_error{"Cannot allocate memory for the sumtables"};
+    }
+    sumtables_.push_back(sumtable);
+  }
+}
+
+Partition_Slices::~Partition_Slices() {
+  for (auto slice : slices_) {
+    slice_destroy(slice);
+  }
+  for (auto sumtable : sumtables_) {
+    pll_aligned_free(sumtable);
+  }
+}
+
+void Partition_Slices::update_partials(pll_operation_t const* const operations,
+                                       const unsigned int count) {
+#ifdef __OMP
+#pragma omp parallel for schedule(static) num_threads(slices_.size())
+#endif
+  for (size_t i = 0; i < slices_.size(); ++i) {
+    pll_update_partials(slices_[i], operations, count);
+  }
+}
+
+double Partition_Slices::edge_loglikelihood(pll_unode_t const* const edge) {
+  std::vector<double> logl(slices_.size());
+
+#ifdef __OMP
+#pragma omp parallel for schedule(static) num_threads(slices_.size())
+#endif
+  for (size_t i = 0; i < slices_.size(); ++i) {
+    logl[i] = pll_compute_edge_loglikelihood(
+        slices_[i], edge->clv_index, edge->scaler_index, edge->back->clv_index,
+        edge->back->scaler_index, edge->pmatrix_index, &param_indices_[0], nullptr);
+  }
+
+  // reduce in fixed order to stay deterministic
+  double sum = 0.0;
+  for (auto const l : logl) {
+    sum += l;
+  }
+  return sum;
+}
+
+void Partition_Slices::update_sumtables(pll_unode_t const* const edge) {
+#ifdef __OMP
+#pragma omp parallel for schedule(static) num_threads(slices_.size())
+#endif
+  for (size_t i = 0; i < slices_.size(); ++i) {
+    pll_update_sumtable(slices_[i], edge->clv_index, edge->back->clv_index, edge->scaler_index,
+                        edge->back->scaler_index, &param_indices_[0], sumtables_[i]);
+  }
+}
+
+void Partition_Slices::derivatives(pll_unode_t const* const edge, const double length,
+                                   double* df, double* ddf) {
+  std::vector<double> first(slices_.size());
+  std::vector<double> second(slices_.size());
+
+#ifdef __OMP
+#pragma omp parallel for schedule(static) num_threads(slices_.size())
+#endif
+  for (size_t i = 0; i < slices_.size(); ++i) {
+    pll_compute_likelihood_derivatives(slices_[i], edge->scaler_index, edge->back->scaler_index,
+                                       length, &param_indices_[0], sumtables_[i], &first[i],
+                                       &second[i]);
+  }
+
+  *df = 0.0;
+  *ddf = 0.0;
+  for (size_t i = 0; i < slices_.size(); ++i) {
+    *df += first[i];
+    *ddf += second[i];
+  }
+}
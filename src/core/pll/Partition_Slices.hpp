@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "core/pll/pllhead.hpp"
+
+/**
+  Splits a partition into contiguous blocks of sites, one per thread.
+
+  Every slice is a partition of its own that shares the model parameters and pmatrices of the
+  original, and whose CLV, scaler and tipchar buffers point into those of the original at the
+  offset of its block. Partials computed via the slices are thus directly visible in the original
+  partition, while likelihoods and derivatives are reduced over the slices.
+
+  Pmatrices and model parameters are to be updated on the original partition. Site repeats and
+  the ascertainment bias correction are not supported: both keep data beyond the sites that
+  would have to be split up per slice as well.
+*/
+class Partition_Slices {
+public:
+  Partition_Slices(pll_partition_t* const partition, const unsigned int num_slices);
+  ~Partition_Slices();
+
+  Partition_Slices(Partition_Slices const& other) = delete;
+  Partition_Slices& operator=(Partition_Slices const& other) = delete;
+
+  static bool supports(pll_partition_t const* const partition);
+
+  size_t size() const { return slices_.size(); }
+
+  void update_partials(pll_operation_t const* const operations, const unsigned int count);
+  double edge_loglikelihood(pll_unode_t const* const edge);
+  void update_sumtables(pll_unode_t const* const edge);
+  void derivatives(pll_unode_t const* const edge, const double length, double* df, double* ddf);
+
+private:
+  pll_partition_t* partition_;
+  std::vector<pll_partition_t*> slices_;
+  std::vector<double*> sumtables_;
+  std::vector<unsigned int> param_indices_;
+};
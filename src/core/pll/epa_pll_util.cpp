@@ -2,6 +2,12 @@
 
 #include <unordered_map>
 #include <algorithm>
+#include <exception>
+#include <vector>
+
+#ifdef __OMP
+#include <omp.h>
+#endif
 
 #include "core/pll/pll_util.hpp"
 #include "core/pll/optimize.hpp"
@@ -59,8 +65,8 @@ void link_tree_msa(pll_utree_t* tree, pll_partition_t* partition, raxml::Model&
   raxml::assign(partition, model);
 }
 
-void precompute_clvs(pll_utree_t const* const tree, pll_partition_t* partition,
-                     const Tree_Numbers& nums) {
+static void precompute_clvs_serial(pll_utree_t const* const tree, pll_partition_t* partition,
+                                   const Tree_Numbers& nums, const clv_callback& on_computed) {
   /* various buffers for creating a postorder traversal and operations structures */
   std::vector<unsigned int> param_indices(partition->rate_cats, 0);
   std::vector<pll_unode_t*> travbuffer(nums.nodes);
@@ -102,10 +108,136 @@ void precompute_clvs(pll_utree_t const* const tree, pll_partition_t* partition,
     /* use the operations array to compute all num_ops inner CLVs. Operations
        will be carried out sequentially starting from operation 0 towrds num_ops-1 */
     pll_update_partials(partition, &operations[0], num_ops);
+
+    if (on_computed) {
+      for (size_t j = 0; j < num_ops; ++j) {
+        on_computed(operations[j].parent_clv_index);
+      }
+    }
   }
   utree_free_node_data(root);
 }
 
+/* arranges the operations for all directional inner CLVs into levels of a dependency DAG: every
+  operation of a level only depends on CLVs of lower levels (or tips) */
+static std::vector<std::vector<pll_operation_t>> operation_levels(pll_utree_t const* const tree,
+                                                                  const size_t num_clvs) {
+  std::vector<std::vector<pll_operation_t>> levels;
+
+  // number of yet uncomputed inner children, per directional CLV
+  std::vector<unsigned int> pending(num_clvs, 0);
+  std::vector<pll_unode_t*> frontier;
+
+  for (size_t i = tree->tip_count; i < tree->tip_count + tree->inner_count; ++i) {
+    auto node = tree->nodes[i];
+    for (size_t j = 0; j < 3; ++j, node = node->next) {
+      pending[node->clv_index] = (node->next->back->next != nullptr)
+                                 + (node->next->next->back->next != nullptr);
+      if (not pending[node->clv_index]) {
+        frontier.push_back(node);
+      }
+    }
+  }
+
+  while (not frontier.empty()) {
+    std::vector<pll_operation_t> ops;
+    std::vector<pll_unode_t*> next_frontier;
+    for (auto node : frontier) {
+      ops.push_back(make_operation(node));
+      // the CLVs depending on this one are those pointing away from it on the other side
+      auto const dependent = node->back;
+      if (dependent->next) {
+        for (auto d : {dependent->next, dependent->next->next}) {
+          if (not --pending[d->clv_index]) {
+            next_frontier.push_back(d);
+          }
+        }
+      }
+    }
+    levels.push_back(std::move(ops));
+    frontier.swap(next_frontier);
+  }
+
+  return levels;
+}
+
+void precompute_clvs(pll_utree_t const* const tree, pll_partition_t* partition,
+                     const Tree_Numbers& nums, const unsigned int num_threads,
+                     const clv_callback& on_computed) {
+#ifdef __OMP
+  const unsigned int threads = num_threads ? num_threads : omp_get_max_threads();
+#else
+  (void)num_threads;
+  const unsigned int threads = 1;
+#endif
+
+  // the site repeats bookkeeping is shared state of the partition, so only the serial path is safe
+  if (threads < 2 or (partition->attributes & PLL_ATTRIB_SITE_REPEATS)) {
+    precompute_clvs_serial(tree, partition, nums, on_computed);
+    return;
+  }
+
+  // every branch needs exactly one pmatrix update, regardless of direction
+  std::vector<unsigned int> param_indices(partition->rate_cats, 0);
+  std::vector<double> branch_lengths;
+  std::vector<unsigned int> matrix_indices;
+  std::vector<bool> seen(partition->prob_matrices, false);
+  for (size_t i = 0; i < tree->tip_count + tree->inner_count; ++i) {
+    auto node = tree->nodes[i];
+    do {
+      if (not seen[node->pmatrix_index]) {
+        seen[node->pmatrix_index] = true;
+        matrix_indices.push_back(node->pmatrix_index);
+        branch_lengths.push_back(node->length);
+      }
+      node = node->next;
+    } while (node and node != tree->nodes[i]);
+  }
+
+  if (not pll_update_prob_matrices(partition, &param_indices[0], &matrix_indices[0],
+                                   &branch_lengths[0], matrix_indices.size())) {
+    throw std::runtime_error{std::string(pll_errmsg)};
+  }
+
+  const auto levels = operation_levels(tree, partition->tips + partition->clv_buffers);
+
+  for (auto const& ops : levels) {
+    // tip-tip operations write to the partition-wide lookup table in pattern tip mode
+    if (&ops == &levels.front() and (partition->attributes & PLL_ATTRIB_PATTERN_TIP)) {
+      pll_update_partials(partition, &ops[0], ops.size());
+      if (on_computed) {
+        for (auto const& op : ops) {
+          on_computed(op.parent_clv_index);
+        }
+      }
+      continue;
+    }
+
+    // the callback may throw, which must not leave the parallel region
+    std::vector<std::exception_ptr> errors(ops.size());
+
+#ifdef __OMP
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+#endif
+    for (size_t i = 0; i < ops.size(); ++i) {
+      try {
+        pll_update_partials(partition, &ops[i], 1);
+        if (on_computed) {
+          on_computed(ops[i].parent_clv_index);
+        }
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+
+    for (auto& e : errors) {
+      if (e) {
+        std::rethrow_exception(e);
+      }
+    }
+  }
+}
+
 void split_combined_msa(MSA& source, MSA& target, Tree& tree) {
   std::vector<pll_unode_t*> tip_nodes(tree.nums().tip_nodes);
   tip_nodes.assign(tree.tree()->nodes, tree.tree()->nodes + tree.tree()->tip_count);
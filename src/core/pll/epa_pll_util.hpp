@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <functional>
 
 #include "core/pll/pllhead.hpp"
 #include "tree/Tree_Numbers.hpp"
@@ -13,8 +14,12 @@
 
 void link_tree_msa(pll_utree_t* tree, pll_partition_t* partition, raxml::Model& model,
                    const MSA& msa, const unsigned int num_tip_nodes);
+// called with the clv_index of every CLV as soon as it is final, possibly from several threads
+using clv_callback = std::function<void(const unsigned int)>;
+
 void precompute_clvs(pll_utree_t const* const tree, pll_partition_t* partition,
-                     const Tree_Numbers& nums);
+                     const Tree_Numbers& nums, const unsigned int num_threads = 0,
+                     const clv_callback& on_computed = nullptr);
 void split_combined_msa(MSA& source, MSA& target, Tree& tree);
 raxml::Model get_model(pll_partition_t* partition);
 
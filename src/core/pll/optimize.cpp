@@ -7,14 +7,21 @@
 #include <stdexcept>
 #include <limits>
 #include <algorithm>
+#include <numeric>
+
+#ifdef __OMP
+#include <omp.h>
+#endif
 
 #include "core/pll/pll_util.hpp"
+#include "core/pll/Partition_Slices.hpp"
 #include "util/constants.hpp"
 #include "util/logging.hpp"
 
-static void traverse_update_partials(pll_unode_t* root, pll_partition_t* partition,
-                                     pll_unode_t** travbuffer, double* branch_lengths,
-                                     unsigned int* matrix_indices, pll_operation_t* operations) {
+void traverse_update_partials(pll_unode_t* root, pll_partition_t* partition,
+                              pll_unode_t** travbuffer, double* branch_lengths,
+                              unsigned int* matrix_indices, pll_operation_t* operations,
+                              Partials_Cache* cache, Partition_Slices* slices) {
   unsigned int num_matrices, num_ops;
   std::vector<unsigned int> param_indices(partition->rate_cats, 0);
   /* perform a full traversal*/
@@ -27,10 +34,18 @@ static void traverse_update_partials(pll_unode_t* root, pll_partition_t* partiti
 
   /* given the computed traversal descriptor, generate the operations
      structure, and the corresponding probability matrix indices that
-     may need recomputing */
+     may need recomputing. These always describe the full traversal, as the pll-modules
+     optimizers recompute from them internally */
   pll_utree_create_operations(travbuffer, traversal_size, branch_lengths, matrix_indices,
                               operations, &num_matrices, &num_ops);
 
+  if (cache) {
+    // only recompute what was invalidated since the last traversal
+    cache->update(partition, travbuffer, traversal_size, branch_lengths, matrix_indices,
+                  num_matrices, slices);
+    return;
+  }
+
   pll_update_prob_matrices(partition, &param_indices[0],
                            matrix_indices,  // matrices to update
                            branch_lengths,
@@ -38,7 +53,11 @@ static void traverse_update_partials(pll_unode_t* root, pll_partition_t* partiti
 
   /* use the operations array to compute all num_ops inner CLVs. Operations
      will be carried out sequentially starting from operation 0 towrds num_ops-1 */
-  pll_update_partials(partition, operations, num_ops);
+  if (slices) {
+    slices->update_partials(operations, num_ops);
+  } else {
+    pll_update_partials(partition, operations, num_ops);
+  }
 }
 
 static void utree_derivative_func(void* parameters, double proposal, double* df, double* ddf) {
@@ -287,27 +306,26 @@ double optimize_branch_triplet(pll_partition_t* partition, pll_unode_t* root, co
 
 static double optimize_branch_lengths(pll_unode_t* root, pll_partition_t* partition,
                                       pll_optimize_options_t& params, pll_unode_t** travbuffer,
-                                      double cur_logl, double lnl_monitor, int* smoothings) {
+                                      const int smoothings, Partials_Cache& cache) {
   if (!root->next) {
     root = root->back;
   }
 
   traverse_update_partials(root, partition, travbuffer, params.lk_params.branch_lengths,
-                           params.lk_params.matrix_indices, params.lk_params.operations);
+                           params.lk_params.matrix_indices, params.lk_params.operations, &cache);
 
   pll_errno = 0;  // hotfix
 
   std::vector<unsigned int> param_indices(partition->rate_cats, 0);
 
-  cur_logl = -1 * pllmod_opt_optimize_branch_lengths_iterative(
-                      partition, root, &param_indices[0], PLLMOD_OPT_MIN_BRANCH_LEN,
-                      PLLMOD_OPT_MAX_BRANCH_LEN, OPT_BRANCH_EPSILON, *smoothings,
-                      1);  // keep updating BLs during call
+  pllmod_opt_optimize_branch_lengths_iterative(partition, root, &param_indices[0],
+                                               PLLMOD_OPT_MIN_BRANCH_LEN,
+                                               PLLMOD_OPT_MAX_BRANCH_LEN, OPT_BRANCH_EPSILON,
+                                               smoothings,
+                                               1);  // keep updating BLs during call
 
-  if (cur_logl + 1e-6 < lnl_monitor) {
-    throw std::runtime_error{std::string("cur_logl < lnl_monitor: ") + std::to_string(cur_logl) +
-                             std::string(" : ") + std::to_string(lnl_monitor)};
-  }
+  // the optimizer updated pmatrices and CLVs in whatever direction it needed
+  cache.invalidate();
 
   // reupdate the indices as they may have changed
   params.lk_params.where.unrooted_t.parent_clv_index = root->clv_index;
@@ -317,89 +335,329 @@ static double optimize_branch_lengths(pll_unode_t* root, pll_partition_t* partit
   params.lk_params.where.unrooted_t.edge_pmatrix_index = root->pmatrix_index;
 
   traverse_update_partials(root, partition, travbuffer, params.lk_params.branch_lengths,
-                           params.lk_params.matrix_indices, params.lk_params.operations);
+                           params.lk_params.matrix_indices, params.lk_params.operations, &cache);
 
-  cur_logl = pll_compute_edge_loglikelihood(partition, root->clv_index, root->scaler_index,
-                                            root->back->clv_index, root->back->scaler_index,
-                                            root->pmatrix_index, &param_indices[0], nullptr);
-
-  return cur_logl;
+  return pll_compute_edge_loglikelihood(partition, root->clv_index, root->scaler_index,
+                                        root->back->clv_index, root->back->scaler_index,
+                                        root->pmatrix_index, &param_indices[0], nullptr);
 }
 
-void optimize(raxml::Model& model, pll_utree_t* const tree, pll_partition_t* partition,
-              const Tree_Numbers& nums, const bool opt_branches, const bool opt_model) {
-  if (not opt_branches and not opt_model) {
-    return;
+/**
+  The steps of the optimization, run through the high-level pll-modules optimizers on the
+  partition.
+*/
+class Serial_Steps {
+public:
+  Serial_Steps(raxml::Model& model, pll_partition_t* partition, const Tree_Numbers& nums)
+      : partition_(partition),
+        symmetries_(model.submodel(0).rate_sym()),
+        param_indices_(model.num_ratecats(), 0),
+        travbuffer_(nums.nodes),
+        branch_lengths_(nums.branches),
+        matrix_indices_(nums.branches),
+        operations_(nums.nodes),
+        cache_(partition),
+        min_rates_(model.subst_rates(0).size(), OPT_RATE_MIN),
+        max_rates_(model.subst_rates(0).size(), OPT_RATE_MAX) {
+    // set up high level options structure
+    params_.lk_params.partition = partition;
+    params_.lk_params.operations = &operations_[0];
+    params_.lk_params.branch_lengths = &branch_lengths_[0];
+    params_.lk_params.matrix_indices = &matrix_indices_[0];
+    params_.lk_params.params_indices = &param_indices_[0];
+    params_.lk_params.alpha_value = model.alpha();
+    params_.lk_params.rooted = 0;
+
+    /* optimization parameters */
+    params_.params_index = 0;
+    params_.subst_params_symmetries = symmetries_.empty() ? nullptr : &symmetries_[0];
+    params_.factr = OPT_FACTR;
+    params_.pgtol = OPT_PARAM_EPSILON;
   }
 
-  const auto root = get_root(tree);
+  double logl(pll_unode_t* root) {
+    if (!root->next) {
+      root = root->back;
+    }
 
-  if (opt_branches) {
-    set_branch_lengths(tree, DEFAULT_BRANCH_LENGTH);
+    params_.lk_params.where.unrooted_t.parent_clv_index = root->clv_index;
+    params_.lk_params.where.unrooted_t.parent_scaler_index = root->scaler_index;
+    params_.lk_params.where.unrooted_t.child_clv_index = root->back->clv_index;
+    params_.lk_params.where.unrooted_t.child_scaler_index = root->back->scaler_index;
+    params_.lk_params.where.unrooted_t.edge_pmatrix_index = root->pmatrix_index;
+
+    traverse_update_partials(root, partition_, &travbuffer_[0], &branch_lengths_[0],
+                             &matrix_indices_[0], &operations_[0], &cache_);
+
+    return pll_compute_edge_loglikelihood(partition_, root->clv_index, root->scaler_index,
+                                          root->back->clv_index, root->back->scaler_index,
+                                          root->pmatrix_index, &param_indices_[0], nullptr);
   }
 
-  compute_and_set_empirical_frequencies(partition, model);
+  double branch_lengths(pll_unode_t* root, const int smoothings) {
+    return optimize_branch_lengths(root, partition_, params_, &travbuffer_[0], smoothings,
+                                   cache_);
+  }
+
+  double subst_rates() {
+    params_.which_parameters = PLLMOD_OPT_PARAM_SUBST_RATES;
+    const auto logl = -pllmod_opt_optimize_multidim(&params_, &min_rates_[0], &max_rates_[0]);
+    cache_.invalidate();
+    return logl;
+  }
 
-  std::vector<int> symmetries = model.submodel(0).rate_sym();
-  std::vector<unsigned int> param_indices(model.num_ratecats(), 0);
+  double alpha() {
+    params_.which_parameters = PLLMOD_OPT_PARAM_ALPHA;
+    const auto logl = -pllmod_opt_optimize_onedim(&params_, OPT_ALPHA_MIN, OPT_ALPHA_MAX);
+    cache_.invalidate();
+    return logl;
+  }
 
+private:
+  pll_partition_t* partition_;
+  std::vector<int> symmetries_;
+  std::vector<unsigned int> param_indices_;
   // sadly we explicitly need these buffers here and in the params structure
-  std::vector<pll_unode_t*> travbuffer(nums.nodes);
-  std::vector<double> branch_lengths(nums.branches);
-  std::vector<unsigned int> matrix_indices(nums.branches);
-  std::vector<pll_operation_t> operations(nums.nodes);
+  std::vector<pll_unode_t*> travbuffer_;
+  std::vector<double> branch_lengths_;
+  std::vector<unsigned int> matrix_indices_;
+  std::vector<pll_operation_t> operations_;
+  Partials_Cache cache_;
+  std::vector<double> min_rates_;
+  std::vector<double> max_rates_;
+  pll_optimize_options_t params_;
+};
 
-  traverse_update_partials(root, partition, &travbuffer[0], &branch_lengths[0], &matrix_indices[0],
-                           &operations[0]);
+/**
+  The same steps, run through the pll-modules minimizers that the high-level optimizers use
+  internally, with the same settings. Only the callbacks differ: they compute the likelihoods and
+  derivatives on slices of the partition, reduced over the slices, while the model parameters and
+  pmatrices are set once on the original partition.
+*/
+class Sliced_Steps {
+public:
+  Sliced_Steps(raxml::Model& model, pll_partition_t* partition, const Tree_Numbers& nums,
+               const unsigned int num_threads)
+      : partition_(partition),
+        symmetries_(model.submodel(0).rate_sym()),
+        alpha_(model.alpha()),
+        param_indices_(partition->rate_cats, 0),
+        travbuffer_(nums.nodes),
+        branch_lengths_(nums.branches),
+        matrix_indices_(nums.branches),
+        operations_(nums.nodes),
+        slices_(partition, num_threads),
+        cache_(partition) {
+    // without symmetries, every rate is free besides the last one
+    if (symmetries_.empty()) {
+      symmetries_.resize(model.subst_rates(0).size());
+      std::iota(symmetries_.begin(), symmetries_.end(), 0);
+    }
+    LOG_DBG << "Optimizing on " << slices_.size() << " site slices";
+  }
 
-  // compute logl once to give us a logl starting point
-  auto cur_logl = pll_compute_edge_loglikelihood(partition, root->clv_index, root->scaler_index,
-                                                 root->back->clv_index, root->back->scaler_index,
-                                                 root->pmatrix_index, &param_indices[0], nullptr);
-
-  // double cur_logl = -numeric_limits<double>::infinity();
-  int smoothings;
-  double lnl_monitor = cur_logl;
-
-  // set up high level options structure
-  pll_optimize_options_t params;
-  params.lk_params.partition = partition;
-  params.lk_params.operations = &operations[0];
-  params.lk_params.branch_lengths = &branch_lengths[0];
-  params.lk_params.matrix_indices = &matrix_indices[0];
-  params.lk_params.params_indices = &param_indices[0];
-  params.lk_params.alpha_value = model.alpha();
-  params.lk_params.rooted = 0;
-  params.lk_params.where.unrooted_t.parent_clv_index = root->clv_index;
-  params.lk_params.where.unrooted_t.parent_scaler_index = root->scaler_index;
-  params.lk_params.where.unrooted_t.child_clv_index = root->back->clv_index;
-  params.lk_params.where.unrooted_t.child_scaler_index = root->back->scaler_index;
-  params.lk_params.where.unrooted_t.edge_pmatrix_index = root->pmatrix_index;
+  double logl(pll_unode_t* root) {
+    if (!root->next) {
+      root = root->back;
+    }
+    root_ = root;
+    return update_logl();
+  }
+
+  // as pllmod_opt_optimize_branch_lengths_iterative, followed by a fresh traversal
+  double branch_lengths(pll_unode_t* root, const int smoothings) {
+    auto lnl = logl(root);
+
+    auto iters = smoothings;
+    while (iters) {
+      recomp_iterative(root_);
+      recomp_iterative(root_->back);
+      --iters;
+
+      const auto new_lnl = slices_.edge_loglikelihood(root_);
+      if (fabs(new_lnl - lnl) < OPT_BRANCH_EPSILON) {
+        iters = 0;
+      }
+      lnl = new_lnl;
+    }
+
+    return update_logl();
+  }
+
+  // as pllmod_opt_optimize_multidim for the substitution rates
+  double subst_rates() {
+    // one free parameter per symmetry class, besides that of the last rate, which is fixed to 1
+    const auto fixed = symmetries_.back();
+    const auto num_classes = *std::max_element(symmetries_.begin(), symmetries_.end()) + 1;
+    auto const current = partition_->subst_params[0];
+
+    std::vector<double> x;
+    free_classes_.clear();
+    for (int c = 0; c < num_classes; ++c) {
+      const auto first = std::find(symmetries_.begin(), symmetries_.end(), c);
+      if (c != fixed and first != symmetries_.end()) {
+        free_classes_.push_back(c);
+        x.push_back(current[std::distance(symmetries_.begin(), first)]);
+      }
+    }
+    if (x.empty()) {
+      return update_logl();
+    }
+
+    std::vector<double> min_rates(x.size(), OPT_RATE_MIN);
+    std::vector<double> max_rates(x.size(), OPT_RATE_MAX);
+    std::vector<int> bound(x.size(), PLLMOD_OPT_LBFGSB_BOUND_BOTH);
+
+    return -pllmod_opt_minimize_lbfgsb(&x[0], &min_rates[0], &max_rates[0], &bound[0], x.size(),
+                                       OPT_FACTR, OPT_PARAM_EPSILON, this, subst_rates_target);
+  }
+
+  // as pllmod_opt_optimize_onedim for alpha
+  double alpha() {
+    const auto xguess = std::min(std::max(alpha_, OPT_ALPHA_MIN), OPT_ALPHA_MAX);
+    double fx, f2x;
+    const auto xres = pllmod_opt_minimize_brent(OPT_ALPHA_MIN, xguess, OPT_ALPHA_MAX,
+                                                OPT_PARAM_EPSILON, &fx, &f2x, this, alpha_target);
+    return -alpha_target(this, xres);
+  }
+
+private:
+  double update_logl() {
+    traverse_update_partials(root_, partition_, &travbuffer_[0], &branch_lengths_[0],
+                             &matrix_indices_[0], &operations_[0], &cache_, &slices_);
+    return slices_.edge_loglikelihood(root_);
+  }
 
-  /* optimization parameters */
-  params.params_index = 0;
-  params.subst_params_symmetries = &symmetries[0];
-  params.factr = OPT_FACTR;
-  params.pgtol = OPT_PARAM_EPSILON;
+  void update_clv(pll_unode_t const* const node) {
+    const auto op = make_operation(node);
+    slices_.update_partials(&op, 1);
+    cache_.computed_clv(node);
+  }
+
+  static void derivative_func(void* parameters, double proposal, double* df, double* ddf) {
+    auto self = static_cast<Sliced_Steps*>(parameters);
+    self->slices_.derivatives(self->edge_, proposal, df, ddf);
+  }
+
+  void optimize_edge(pll_unode_t* const edge) {
+    const unsigned int max_iters = 30;
+    slices_.update_sumtables(edge);
+    edge_ = edge;
+
+    auto xguess = edge->length;
+    if ((xguess < OPT_BRLEN_MIN) or (xguess > OPT_BRLEN_MAX)) {
+      xguess = PLLMOD_OPT_DEFAULT_BRANCH_LEN;
+    }
+
+    const auto xres = pllmod_opt_minimize_newton(OPT_BRLEN_MIN, xguess, OPT_BRLEN_MAX,
+                                                 OPT_BRLEN_MIN / 10.0, max_iters, this,
+                                                 derivative_func);
+    pll_errno = 0;
+
+    if (xres >= OPT_BRLEN_MIN and xres <= OPT_BRLEN_MAX) {
+      edge->length = edge->back->length = xres;
+      pll_update_prob_matrices(partition_, &param_indices_[0], &edge->pmatrix_index, &xres, 1);
+      cache_.computed_pmatrix(edge->pmatrix_index, xres);
+    }
+  }
+
+  /* optimizes <edge>, then recursively the edges behind <edge>, reorienting the CLVs of the node
+    of <edge> toward each of them in turn, the way the pll-modules smoothing does */
+  void recomp_iterative(pll_unode_t* const edge) {
+    optimize_edge(edge);
+    if (not edge->next) {
+      return;
+    }
+
+    auto const q = edge->next;
+    auto const z = q->next;
+    update_clv(q);
+    recomp_iterative(q->back);
+    update_clv(z);
+    recomp_iterative(z->back);
+    // reset to the initial orientation
+    update_clv(edge);
+  }
+
+  static double subst_rates_target(void* parameters, double* x) {
+    auto self = static_cast<Sliced_Steps*>(parameters);
+    auto& symmetries = self->symmetries_;
+
+    std::vector<double> rates(symmetries.size(), 1.0);
+    for (size_t k = 0; k < self->free_classes_.size(); ++k) {
+      for (size_t i = 0; i < symmetries.size(); ++i) {
+        if (symmetries[i] == self->free_classes_[k]) {
+          rates[i] = x[k];
+        }
+      }
+    }
+    pll_set_subst_params(self->partition_, 0, &rates[0]);
+    self->cache_.invalidate();
+
+    return -self->update_logl();
+  }
+
+  static double alpha_target(void* parameters, double alpha) {
+    auto self = static_cast<Sliced_Steps*>(parameters);
+    std::vector<double> rates(self->partition_->rate_cats);
+    pll_compute_gamma_cats(alpha, rates.size(), &rates[0], PLL_GAMMA_RATES_MEAN);
+    pll_set_category_rates(self->partition_, &rates[0]);
+    self->alpha_ = alpha;
+    self->cache_.invalidate();
+
+    return -self->update_logl();
+  }
+
+  pll_partition_t* partition_;
+  std::vector<int> symmetries_;
+  std::vector<int> free_classes_;
+  double alpha_;
+  std::vector<unsigned int> param_indices_;
+  std::vector<pll_unode_t*> travbuffer_;
+  std::vector<double> branch_lengths_;
+  std::vector<unsigned int> matrix_indices_;
+  std::vector<pll_operation_t> operations_;
+  Partition_Slices slices_;
+  Partials_Cache cache_;
+  pll_unode_t* root_ = nullptr;
+  pll_unode_t const* edge_ = nullptr;
+};
+
+static void check_lnl_monitor(const double cur_logl, const double lnl_monitor) {
+  if (cur_logl + 1e-6 < lnl_monitor) {
+    throw std::runtime_error{std::string("cur_logl < lnl_monitor: ") + std::to_string(cur_logl) +
+                             std::string(" : ") + std::to_string(lnl_monitor)};
+  }
+}
+
+/**
+  The optimization procedure, over the steps of either Serial_Steps or Sliced_Steps. Both run the
+  same optimizers with the same settings, so the result does not depend on the number of threads
+  beyond the order of floating point summation.
+*/
+template <class Steps>
+static void optimize_(Steps& steps, pll_utree_t* const tree, const Tree_Numbers& nums,
+                      const bool opt_branches, const bool opt_model) {
+  // compute logl once to give us a logl starting point
+  auto cur_logl = steps.logl(get_root(tree));
+  const double lnl_monitor = cur_logl;
 
   std::vector<pll_unode_t*> branches(nums.branches);
   auto num_traversed = utree_query_branches(tree, &branches[0]);
   assert(num_traversed == nums.branches);
   unsigned int branch_index = 0;
 
+  auto optimize_branches = [&](const int smoothings) {
+    cur_logl = steps.branch_lengths(branches[branch_index], smoothings);
+    check_lnl_monitor(cur_logl, lnl_monitor);
+  };
+
   double logl = cur_logl;
 
   if (opt_branches) {
-    smoothings = 8;
-    cur_logl = optimize_branch_lengths(branches[branch_index], partition, params, &travbuffer[0],
-                                       cur_logl, lnl_monitor, &smoothings);
+    optimize_branches(8);
   }
 
-  const auto rates_size = model.subst_rates(0).size();
-
-  std::vector<double> min_rates(rates_size, OPT_RATE_MIN);
-  std::vector<double> max_rates(rates_size, OPT_RATE_MAX);
-
   do {
     branch_index = rand() % num_traversed;
 
@@ -407,46 +665,57 @@ void optimize(raxml::Model& model, pll_utree_t* const tree, pll_partition_t* par
     logl = cur_logl;
 
     if (opt_model) {
-      params.which_parameters = PLLMOD_OPT_PARAM_SUBST_RATES;
-      cur_logl = -pllmod_opt_optimize_multidim(&params, &min_rates[0], &max_rates[0]);
-
-      // LOG_INFO << "after rates: " << to_string(cur_logl) << "\n";
+      cur_logl = steps.subst_rates();
 
       if (opt_branches) {
-        smoothings = 2;
-        cur_logl = optimize_branch_lengths(branches[branch_index], partition, params,
-                                           &travbuffer[0], cur_logl, lnl_monitor, &smoothings);
-
-        // LOG_INFO << "after blo 1: " << to_string(cur_logl) << "\n";
+        optimize_branches(2);
       }
 
       // params.which_parameters = PLL_PARAMETER_FREQUENCIES;
       // pll_optimize_parameters_multidim(&params, nullptr, nullptr);
 
       if (opt_branches) {
-        smoothings = 2;
-        cur_logl = optimize_branch_lengths(branches[branch_index], partition, params,
-                                           &travbuffer[0], cur_logl, lnl_monitor, &smoothings);
-
-        // LOG_INFO << "after blo 2: " << to_string(cur_logl) << "\n";
+        optimize_branches(2);
       }
 
       // params.which_parameters = PLL_PARAMETER_PINV;
       // cur_logl = -1 * pll_optimize_parameters_brent(&params);
-      params.which_parameters = PLLMOD_OPT_PARAM_ALPHA;
-      cur_logl = -pllmod_opt_optimize_onedim(&params, 0.02, 10000.);
-
-      // LOG_INFO << "after alpha: " << to_string(cur_logl) << "\n";
+      cur_logl = steps.alpha();
     }
 
     if (opt_branches) {
-      smoothings = 3;
-      cur_logl = optimize_branch_lengths(branches[branch_index], partition, params, &travbuffer[0],
-                                         cur_logl, lnl_monitor, &smoothings);
-
-      // LOG_INFO << "after blo 3: " << to_string(cur_logl) << "\n";
+      optimize_branches(3);
     }
   } while (fabs(cur_logl - logl) > OPT_EPSILON);
+}
+
+void optimize(raxml::Model& model, pll_utree_t* const tree, pll_partition_t* partition,
+              const Tree_Numbers& nums, const bool opt_branches, const bool opt_model,
+              const unsigned int num_threads) {
+  if (not opt_branches and not opt_model) {
+    return;
+  }
+
+#ifdef __OMP
+  const unsigned int threads = num_threads ? num_threads : omp_get_max_threads();
+#else
+  (void)num_threads;
+  const unsigned int threads = 1;
+#endif
+
+  if (opt_branches) {
+    set_branch_lengths(tree, DEFAULT_BRANCH_LENGTH);
+  }
+
+  compute_and_set_empirical_frequencies(partition, model);
+
+  if (threads > 1 and Partition_Slices::supports(partition)) {
+    Sliced_Steps steps(model, partition, nums, threads);
+    optimize_(steps, tree, nums, opt_branches, opt_model);
+  } else {
+    Serial_Steps steps(model, partition, nums);
+    optimize_(steps, tree, nums, opt_branches, opt_model);
+  }
 
   if (opt_model) {
     // update epa model object as well
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "core/pll/pllhead.hpp"
+#include "core/pll/Partials_Cache.hpp"
 #include "core/raxml/Model.hpp"
 #include "tree/Tree_Numbers.hpp"
 
+class Partition_Slices;
+
 constexpr double OPT_EPSILON = 1.0;
 constexpr double OPT_PARAM_EPSILON = 1e-4;
 constexpr double OPT_BRANCH_EPSILON = 1e-1;
@@ -12,10 +15,25 @@ constexpr double OPT_BRLEN_MIN = PLLMOD_OPT_MIN_BRANCH_LEN;
 constexpr double OPT_BRLEN_MAX = PLLMOD_OPT_MAX_BRANCH_LEN;
 constexpr double OPT_RATE_MIN = 1e-4;
 constexpr double OPT_RATE_MAX = 1e6;
+constexpr double OPT_ALPHA_MIN = 0.02;
+constexpr double OPT_ALPHA_MAX = 10000.;
 
 // interface
+// num_threads as in Options, 0 meaning as many as OpenMP provides
 void optimize(raxml::Model& model, pll_utree_t* const tree, pll_partition_t* partition,
-              const Tree_Numbers& nums, const bool opt_branches, const bool opt_model);
+              const Tree_Numbers& nums, const bool opt_branches, const bool opt_model,
+              const unsigned int num_threads = 0);
+
+/**
+  Brings the CLVs of a full traversal from root up to date, along with the pmatrices of its
+  branches. With a cache, only those that are out of date are recomputed. As every pll-modules
+  optimizer step invalidates the cache, this only saves work between consecutive calls with no
+  such step in between. The traversal and its operations are still built in full on every call.
+*/
+void traverse_update_partials(pll_unode_t* root, pll_partition_t* partition,
+                              pll_unode_t** travbuffer, double* branch_lengths,
+                              unsigned int* matrix_indices, pll_operation_t* operations,
+                              Partials_Cache* cache = nullptr, Partition_Slices* slices = nullptr);
 
 void compute_and_set_empirical_frequencies(pll_partition_t* partition, raxml::Model& model);
 
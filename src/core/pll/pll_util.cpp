@@ -1,5 +1,6 @@
 #include "core/pll/pll_util.hpp"
 
+#include <cassert>
 #include <iomanip>
 #include <stdexcept>
 #include <vector>
@@ -417,6 +418,84 @@ void shift_partition_focus(pll_partition_t* partition, const int offset, const u
   partition->sites = span;
 }
 
+/* Creates the operation that computes the CLV of <node>, pointing toward <node->back>. The layout
+  is the same as produced by pll_utree_create_operations. */
+pll_operation_t make_operation(pll_unode_t const* const node) {
+  assert(node->next);
+  pll_operation_t op;
+  op.parent_clv_index = node->clv_index;
+  op.parent_scaler_index = node->scaler_index;
+  op.child1_clv_index = node->next->back->clv_index;
+  op.child1_scaler_index = node->next->back->scaler_index;
+  op.child1_matrix_index = node->next->back->pmatrix_index;
+  op.child2_clv_index = node->next->next->back->clv_index;
+  op.child2_scaler_index = node->next->next->back->scaler_index;
+  op.child2_matrix_index = node->next->next->back->pmatrix_index;
+  return op;
+}
+
+/* Frees the model parameter buffers of <dest> and instead points them to those of <src>. Must be
+  undone via unshare_model_buffers before destroying <dest>. */
+void share_model_buffers(pll_partition_t* dest, pll_partition_t const* const src) {
+  unsigned int i;
+  free(dest->rates);
+  dest->rates = src->rates;
+  if (dest->subst_params) {
+    for (i = 0; i < dest->rate_matrices; ++i) {
+      pll_aligned_free(dest->subst_params[i]);
+    }
+  }
+  free(dest->subst_params);
+  dest->subst_params = src->subst_params;
+  if (dest->frequencies) {
+    for (i = 0; i < dest->rate_matrices; ++i) {
+      pll_aligned_free(dest->frequencies[i]);
+    }
+  }
+  free(dest->frequencies);
+  dest->frequencies = src->frequencies;
+  if (dest->eigenvecs) {
+    for (i = 0; i < dest->rate_matrices; ++i) {
+      pll_aligned_free(dest->eigenvecs[i]);
+    }
+  }
+  free(dest->eigenvecs);
+  dest->eigenvecs = src->eigenvecs;
+  if (dest->inv_eigenvecs) {
+    for (i = 0; i < dest->rate_matrices; ++i) {
+      pll_aligned_free(dest->inv_eigenvecs[i]);
+    }
+  }
+  free(dest->inv_eigenvecs);
+  dest->inv_eigenvecs = src->inv_eigenvecs;
+  if (dest->eigenvals) {
+    for (i = 0; i < dest->rate_matrices; ++i) {
+      pll_aligned_free(dest->eigenvals[i]);
+    }
+  }
+  free(dest->eigenvals);
+  dest->eigenvals = src->eigenvals;
+
+  if (dest->prop_invar) {
+    free(dest->prop_invar);
+  }
+  dest->prop_invar = src->prop_invar;
+
+  free(dest->eigen_decomp_valid);
+  dest->eigen_decomp_valid = src->eigen_decomp_valid;
+}
+
+void unshare_model_buffers(pll_partition_t* partition) {
+  partition->rates = nullptr;
+  partition->subst_params = nullptr;
+  partition->frequencies = nullptr;
+  partition->eigenvecs = nullptr;
+  partition->inv_eigenvecs = nullptr;
+  partition->eigenvals = nullptr;
+  partition->prop_invar = nullptr;
+  partition->eigen_decomp_valid = nullptr;
+}
+
 /* Function to return the tip node if either <node> or <node->back> is one. Otherwise
   returns null. */
 pll_unode_t* get_tip_node(pll_unode_t* node) {
@@ -46,6 +46,12 @@ pll_unode_t* get_root(pll_utree_t const* const tree);
 
 pll_utree_t* make_utree_struct(pll_unode_t* root, const unsigned int num_nodes);
 
+pll_operation_t make_operation(pll_unode_t const* const node);
+
+// partitions sharing buffers with another partition
+void share_model_buffers(pll_partition_t* dest, pll_partition_t const* const src);
+void unshare_model_buffers(pll_partition_t* partition);
+
 // deprecated
 void shift_partition_focus(pll_partition_t* partition, const int offset, const unsigned int span);
 
@@ -0,0 +1,68 @@
+#include "core/postprocess.hpp"
+
+#include <cstdint>
+
+#ifdef __OMP
+#include <omp.h>
+#endif
+
+#include "io/jplace_util.hpp"
+#include "set_manipulators.hpp"
+
+std::vector<std::string> postprocess(Columnar_Sample& sample, const size_t num_placed,
+                                     const Options& options, rtree_mapper const& mapper) {
+#ifdef __OMP
+  const size_t num_threads = options.num_threads ? options.num_threads : omp_get_max_threads();
+#else
+  const size_t num_threads = 1;
+#endif
+
+  check_filter(options);
+
+  std::vector<std::string> buffers(num_threads);
+  std::vector<uint32_t> selection(sample.num_placements());
+  std::vector<size_t> counts(sample.size());
+
+  auto const logl = sample.likelihoods().data();
+  auto const lwrs = sample.lwrs().data();
+
+#ifdef __OMP
+#pragma omp parallel num_threads(num_threads)
+#endif
+  {
+#ifdef __OMP
+    auto& out = buffers[omp_get_thread_num()];
+#else
+    auto& out = buffers[0];
+#endif
+
+// a static schedule without chunk size hands each thread one contiguous range, in thread order
+#ifdef __OMP
+#pragma omp for schedule(static)
+#endif
+    for (size_t q = 0; q < sample.size(); ++q) {
+      const auto begin = sample.begin(q);
+      const auto n = sample.num_placements(q);
+      auto const order = selection.data() + begin;
+      for (size_t i = 0; i < n; ++i) {
+        order[i] = static_cast<uint32_t>(i);
+      }
+
+      if (q < num_placed) {
+        compute_lwr(logl + begin, lwrs + begin, n);
+        counts[q] = select_by_filter(lwrs + begin, order, n, options);
+      } else {
+        counts[q] = n;
+      }
+
+      pquery_to_jplace_string(sample, q, order, counts[q], out, mapper, options.precision);
+      if (q + 1 < sample.size()) {
+        out += ",";
+      }
+      out += NEWL;
+    }
+  }
+
+  sample.select(selection, counts);
+  return buffers;
+}
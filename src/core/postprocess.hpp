@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "sample/Columnar_Sample.hpp"
+#include "core/pll/rtree_mapper.hpp"
+#include "util/Options.hpp"
+
+/**
+  Everything that happens to the placement results of a chunk before they are written, in one
+  pass over its queries: computes the LWRs of the placements, filters them, and serializes the
+  pquerys to jplace.
+
+  The first num_placed queries come straight from the placement. Those after them (as added by the
+  deduplication) are final already, and are only serialized.
+
+  Every thread serializes its contiguous range of the queries into its own buffer, so the buffers
+  in order make up the chunk, ready to be moved to the jplace_writer. The sample is left with the
+  kept placements only.
+*/
+std::vector<std::string> postprocess(Columnar_Sample& sample, const size_t num_placed,
+                                     const Options& options, rtree_mapper const& mapper);
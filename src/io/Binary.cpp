@@ -2,23 +2,79 @@
 
 #include <stdexcept>
 #include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <exception>
 
+#ifdef __OMP
+#include <omp.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io/store_encoding.hpp"
 #include "util/constants.hpp"
 #include "tree/Tree.hpp"
 
+/*
+  The store appends a data section to the pllmod binary file, which only holds the tree,
+  partition and repeats blocks. The data section holds every tipchar, CLV and scaler buffer at an
+  aligned offset, followed by an index of Store_Entry (ordered like the pllmod block ids: tipchars
+  or CLVs by clv_index, then scalers by scaler_index) and a trailer that locates the index.
+
+  Version 1 stores all buffers as they are in memory. Version 2 may store CLVs in reduced
+  precision and scalers run-length encoded (see io/store_encoding.hpp), which are expanded on load.
+*/
+static constexpr uint32_t STORE_VERSION_RAW = 1;
+static constexpr uint32_t STORE_VERSION_COMPACT = 2;
+static constexpr uint32_t STORE_ENCODING_RAW = 0;
+static constexpr uint32_t STORE_ENCODING_FLOAT32 = 1;
+static constexpr uint32_t STORE_ENCODING_SCALED16 = 2;
+static constexpr uint32_t STORE_ENCODING_RLE = 3;
+static constexpr size_t STORE_ALIGNMENT = 64;
+static const char STORE_MAGIC[] = "EPASTORE";
+
+struct Store_Trailer {
+  uint64_t index_offset;
+  uint64_t num_entries;
+  uint32_t version;
+  uint32_t reserved;
+  char magic[8];
+};
+
 int safe_fclose(FILE* fptr) { return fptr ? fclose(fptr) : 0; }
 
 Binary::Binary(Binary&& other) : bin_fptr_(nullptr, safe_fclose) {
   std::swap(bin_fptr_, other.bin_fptr_);
-  std::swap(map_, other.map_);
+  std::swap(offsets_, other.offsets_);
+  std::swap(min_block_id_, other.min_block_id_);
+  std::swap(map_base_, other.map_base_);
+  std::swap(map_size_, other.map_size_);
+  std::swap(entries_, other.entries_);
+  std::swap(zero_copy_, other.zero_copy_);
 }
 
 Binary& Binary::operator=(Binary&& other) {
   bin_fptr_ = std::move(other.bin_fptr_);
-  map_ = std::move(other.map_);
+  offsets_ = std::move(other.offsets_);
+  min_block_id_ = other.min_block_id_;
+  // hand our mapping to other, so it is released along with it
+  std::swap(map_base_, other.map_base_);
+  std::swap(map_size_, other.map_size_);
+  std::swap(entries_, other.entries_);
+  std::swap(zero_copy_, other.zero_copy_);
   return *this;
 }
 
+Binary::~Binary() {
+  if (map_base_) {
+    munmap(map_base_, map_size_);
+  }
+}
+
 Binary::Binary(const std::string& binary_file_path) : bin_fptr_(nullptr, safe_fclose) {
   // open the binary file
   pll_binary_header_t header;
@@ -46,30 +102,317 @@ Binary::Binary(const std::string& binary_file_path) : bin_fptr_(nullptr, safe_fc
   assert(block_map);
   assert(n_blocks);
 
+  // index the offsets by block id, such that lookups are constant time
+  auto const id_less = [](pll_block_map_t const& a, pll_block_map_t const& b) {
+    return a.block_id < b.block_id;
+  };
+  auto const min_max = std::minmax_element(block_map, block_map + n_blocks, id_less);
+  min_block_id_ = min_max.first->block_id;
+  offsets_.assign(min_max.second->block_id - min_block_id_ + 1, -1);
+
   for (size_t i = 0; i < n_blocks; i++) {
-    map_.push_back(block_map[i]);
+    offsets_[block_map[i].block_id - min_block_id_] = block_map[i].block_offset;
   }
 
   free(block_map);
+
+  map_store(binary_file_path);
+}
+
+/**
+  Maps the data section of the file into memory, if it has one. Files without it (written by
+  older versions) are read block by block through pllmod instead.
+*/
+void Binary::map_store(const std::string& bin_file_path) {
+  const int fd = open(bin_file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error{"Could not open binary file for mapping."};
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 or
+      static_cast<size_t>(file_stat.st_size) < sizeof(Store_Trailer)) {
+    close(fd);
+    return;
+  }
+
+  const size_t size = file_stat.st_size;
+  auto base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping stays valid after the descriptor is closed
+  close(fd);
+
+  if (base == MAP_FAILED) {
+    return;
+  }
+
+  auto const data = static_cast<char*>(base);
+
+  Store_Trailer trailer;
+  std::memcpy(&trailer, data + size - sizeof(Store_Trailer), sizeof(Store_Trailer));
+
+  if (std::memcmp(trailer.magic, STORE_MAGIC, sizeof(trailer.magic)) != 0) {
+    munmap(base, size);
+    return;
+  }
+
+  if (trailer.version != STORE_VERSION_RAW and trailer.version != STORE_VERSION_COMPACT) {
+    munmap(base, size);
+    throw std::runtime_error{std::string("Unsupported binary store version: ") +
+                             std::to_string(trailer.version)};
+  }
+
+  const size_t index_end = trailer.index_offset + trailer.num_entries * sizeof(Store_Entry);
+  if (trailer.index_offset > size or index_end > size - sizeof(Store_Trailer)) {
+    munmap(base, size);
+    throw std::runtime_error{"Binary store index is out of bounds."};
+  }
+
+  entries_.resize(trailer.num_entries);
+  std::memcpy(entries_.data(), data + trailer.index_offset,
+              trailer.num_entries * sizeof(Store_Entry));
+
+  for (auto const& entry : entries_) {
+    if (entry.offset + entry.size > trailer.index_offset) {
+      munmap(base, size);
+      entries_.clear();
+      throw std::runtime_error{"Binary store entry is out of bounds."};
+    }
+  }
+
+  // placement touches the CLVs in no particular order
+  madvise(base, size, MADV_RANDOM);
+
+  zero_copy_ = std::all_of(entries_.begin(), entries_.end(), [](Store_Entry const& entry) {
+    return entry.encoding == STORE_ENCODING_RAW;
+  });
+
+  map_base_ = data;
+  map_size_ = size;
+}
+
+/**
+  Asks the kernel to read the mapped buffers of the given nodes ahead of their use, in file order.
+*/
+void Binary::prefetch(pll_partition_t const* partition,
+                      std::vector<pll_unode_t const*> const& nodes) {
+  if (not mapped()) {
+    return;
+  }
+
+  const size_t scaler_offset = partition->tips + partition->clv_buffers;
+  std::vector<size_t> indices;
+  for (auto const node : nodes) {
+    indices.push_back(node->clv_index);
+    if (node->scaler_index != PLL_SCALE_BUFFER_NONE) {
+      indices.push_back(scaler_offset + node->scaler_index);
+    }
+  }
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+  const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  for (auto const i : indices) {
+    if (i >= entries_.size() or entries_[i].size == 0) {
+      continue;
+    }
+    const size_t begin = (entries_[i].offset / page_size) * page_size;
+    const size_t end = entries_[i].offset + entries_[i].size;
+    madvise(map_base_ + begin, end - begin, MADV_WILLNEED);
+  }
+}
+
+/**
+  Lets the kernel drop the pages of a mapped CLV (or tipchar) buffer and its scaler. They are read
+  back in from the file when next accessed.
+*/
+void Binary::discard(pll_partition_t const* partition, const unsigned int clv_index,
+                     const unsigned int scaler_index) {
+  if (not mapped()) {
+    return;
+  }
+
+  const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  auto const discard_entry = [&](const size_t i) {
+    // only drop the pages that lie entirely within the entry
+    const size_t begin = ((entries_[i].offset + page_size - 1) / page_size) * page_size;
+    const size_t end = ((entries_[i].offset + entries_[i].size) / page_size) * page_size;
+    if (begin < end) {
+      madvise(map_base_ + begin, end - begin, MADV_DONTNEED);
+    }
+  };
+
+  discard_entry(clv_index);
+  if (scaler_index != PLL_SCALE_BUFFER_NONE) {
+    discard_entry(partition->tips + partition->clv_buffers + scaler_index);
+  }
+}
+
+void* Binary::mapped_entry(const size_t index, const size_t expected_size) {
+  assert(mapped());
+
+  if (index >= entries_.size()) {
+    throw std::runtime_error{std::string("Binary store does not contain entry: ") +
+                             std::to_string(index)};
+  }
+
+  auto const& entry = entries_[index];
+  if (entry.encoding != STORE_ENCODING_RAW or entry.size < expected_size) {
+    throw std::runtime_error{std::string("Binary store entry has unexpected format: ") +
+                             std::to_string(index)};
+  }
+
+  return map_base_ + entry.offset;
+}
+
+bool Binary::is_raw(const size_t index) const {
+  return index < entries_.size() and entries_[index].encoding == STORE_ENCODING_RAW;
+}
+
+/**
+  Expands a CLV stored in reduced precision into newly allocated memory.
+*/
+void Binary::decode_clv(pll_partition_t* partition, const unsigned int clv_index) {
+  auto const& entry = entries_.at(clv_index);
+  const size_t clv_size = pll_get_clv_size(partition, clv_index);
+
+  if (!(partition->clv[clv_index])) {
+    partition->clv[clv_index] = static_cast<double*>(
+        pll_aligned_alloc(clv_size * sizeof(double), partition->alignment));
+    if (!partition->clv[clv_index]) {
+      throw std::runtime_error{"Could not allocate CLV memory"};
+    }
+  }
+
+  auto const data = map_base_ + entry.offset;
+  if (entry.encoding == STORE_ENCODING_FLOAT32) {
+    decode_float32(data, entry.size, partition->clv[clv_index], clv_size,
+                   partition->rate_cats * partition->states_padded);
+  } else if (entry.encoding == STORE_ENCODING_SCALED16) {
+    decode_scaled16(data, entry.size, partition->clv[clv_index], clv_size,
+                    partition->rate_cats * partition->states_padded);
+  } else {
+    throw std::runtime_error{std::string("Unknown CLV encoding in binary store: ") +
+                             std::to_string(entry.encoding)};
+  }
+}
+
+/**
+  Expands a run-length encoded scaler into newly allocated memory.
+*/
+void Binary::decode_scaler(pll_partition_t* partition, const unsigned int scaler_index) {
+  auto const& entry = entries_.at(partition->tips + partition->clv_buffers + scaler_index);
+  if (entry.encoding != STORE_ENCODING_RLE) {
+    throw std::runtime_error{std::string("Unknown scaler encoding in binary store: ") +
+                             std::to_string(entry.encoding)};
+  }
+
+  auto const data = map_base_ + entry.offset;
+  const auto size = decoded_rle_size(data, entry.size);
+  auto scaler = static_cast<unsigned int*>(malloc(std::max<size_t>(size, 1) * sizeof(unsigned int)));
+  if (!scaler) {
+    throw std::runtime_error{"Could not allocate scaler memory"};
+  }
+  decode_rle(data, entry.size, scaler, size);
+  partition->scale_buffer[scaler_index] = scaler;
+}
+
+/**
+  Points all tipchar, CLV and scaler buffers of the partition into the mapping. From here on the
+  buffers are only ever read, so no synchronization is needed.
+  Buffers stored in a compact encoding are left to be expanded on demand by the load functions.
+*/
+void Binary::map_partition(pll_partition_t* partition) {
+  const size_t max_clv_index = partition->tips + partition->clv_buffers;
+  const bool use_tipchars = partition->attributes & PLL_ATTRIB_PATTERN_TIP;
+  const bool use_repeats = partition->attributes & PLL_ATTRIB_SITE_REPEATS;
+
+  if (entries_.size() != max_clv_index + partition->scale_buffers) {
+    throw std::runtime_error{"Binary store index does not match the partition."};
+  }
+
+  for (size_t i = 0; i < max_clv_index; ++i) {
+    if (not is_raw(i)) {
+      continue;
+    }
+    if (use_tipchars and i < partition->tips) {
+      partition->tipchars[i] =
+          static_cast<unsigned char*>(mapped_entry(i, partition->sites * sizeof(unsigned char)));
+    } else {
+      partition->clv[i] =
+          static_cast<double*>(mapped_entry(i, pll_get_clv_size(partition, i) * sizeof(double)));
+    }
+  }
+
+  // with repeats the scaler size depends on its node, which the partition does not know about
+  const size_t scaler_size = use_repeats ? 0 : partition->sites * sizeof(unsigned int);
+  for (size_t i = 0; i < partition->scale_buffers; ++i) {
+    if (is_raw(max_clv_index + i)) {
+      partition->scale_buffer[i] =
+          static_cast<unsigned int*>(mapped_entry(max_clv_index + i, scaler_size));
+    }
+  }
+}
+
+static bool is_within(void const* const ptr, char const* const base, const size_t size) {
+  const auto address = reinterpret_cast<uintptr_t>(ptr);
+  const auto begin = reinterpret_cast<uintptr_t>(base);
+  return address >= begin and address < begin + size;
 }
 
-static long int get_offset(std::vector<pll_block_map_t>& map, const int block_id) {
-  auto item = map.begin();
-  while (item != map.end()) {
-    if (item->block_id == block_id) {
-      break;
+bool Binary::contains(void const* const ptr) const {
+  return mapped() and is_within(ptr, map_base_, map_size_);
+}
+
+/**
+  Detaches the partition from the mapping, such that destroying the partition does not attempt to
+  free mapped memory. Must be called before the partition is destroyed.
+*/
+void Binary::unmap_partition(pll_partition_t* partition) {
+  if (not mapped() or not partition) {
+    return;
+  }
+
+  for (size_t i = 0; i < partition->tips + partition->clv_buffers; ++i) {
+    if (is_within(partition->clv[i], map_base_, map_size_)) {
+      partition->clv[i] = nullptr;
+    }
+  }
+
+  if (partition->attributes & PLL_ATTRIB_PATTERN_TIP) {
+    for (size_t i = 0; i < partition->tips; ++i) {
+      if (is_within(partition->tipchars[i], map_base_, map_size_)) {
+        partition->tipchars[i] = nullptr;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < partition->scale_buffers; ++i) {
+    if (is_within(partition->scale_buffer[i], map_base_, map_size_)) {
+      partition->scale_buffer[i] = nullptr;
     }
-    item++;
   }
+}
 
-  if (item == map.end()) {
+long int Binary::get_offset(const int block_id) const {
+  const auto index = static_cast<long int>(block_id) - min_block_id_;
+
+  if (index < 0 or static_cast<size_t>(index) >= offsets_.size() or offsets_[index] < 0) {
     throw std::runtime_error{std::string("Map does not contain block_id: ") +
                              std::to_string(block_id)};
   }
-  return item->block_offset;
+  return offsets_[index];
 }
 
 void Binary::load_clv(pll_partition_t* partition, const unsigned int clv_index) {
+  if (mapped() and is_raw(clv_index)) {
+    partition->clv[clv_index] = static_cast<double*>(
+        mapped_entry(clv_index, pll_get_clv_size(partition, clv_index) * sizeof(double)));
+    return;
+  } else if (mapped()) {
+    decode_clv(partition, clv_index);
+    return;
+  }
+
   assert(bin_fptr_);
   assert(clv_index < partition->clv_buffers + partition->tips);
   if (partition->attributes & PLL_ATTRIB_PATTERN_TIP) {
@@ -90,7 +433,7 @@ void Binary::load_clv(pll_partition_t* partition, const unsigned int clv_index)
     unsigned int attributes;
     std::lock_guard<std::mutex> lock(file_mutex_);
     auto err = pllmod_binary_clv_load(bin_fptr_.get(), 0, partition, clv_index, &attributes,
-                                      get_offset(map_, clv_index));
+                                      get_offset(clv_index));
     if (err != PLL_SUCCESS) {
       throw std::runtime_error{std::string("Loading CLV failed: ") + pll_errmsg +
                                std::string(". CLV index: ") + std::to_string(clv_index)};
@@ -99,6 +442,12 @@ void Binary::load_clv(pll_partition_t* partition, const unsigned int clv_index)
 }
 
 void Binary::load_tipchars(pll_partition_t* partition, const unsigned int tipchars_index) {
+  if (mapped()) {
+    partition->tipchars[tipchars_index] = static_cast<unsigned char*>(
+        mapped_entry(tipchars_index, partition->sites * sizeof(unsigned char)));
+    return;
+  }
+
   assert(bin_fptr_);
   assert(tipchars_index < partition->tips);
   assert(partition->attributes & PLL_ATTRIB_PATTERN_TIP);
@@ -110,7 +459,7 @@ void Binary::load_tipchars(pll_partition_t* partition, const unsigned int tipcha
   {
     std::lock_guard<std::mutex> lock(file_mutex_);
     auto ptr = pllmod_binary_custom_load(bin_fptr_.get(), 0, &size, &type, &attributes,
-                                         get_offset(map_, tipchars_index));
+                                         get_offset(tipchars_index));
     if (!ptr) {
       throw std::runtime_error{std::string("Loading tipchar failed: ") + pll_errmsg};
     }
@@ -119,18 +468,28 @@ void Binary::load_tipchars(pll_partition_t* partition, const unsigned int tipcha
 }
 
 void Binary::load_scaler(pll_partition_t* partition, const unsigned int scaler_index) {
-  assert(bin_fptr_);
   assert(scaler_index < partition->scale_buffers);
 
   auto block_offset = partition->clv_buffers + partition->tips;
 
+  if (mapped() and is_raw(block_offset + scaler_index)) {
+    partition->scale_buffer[scaler_index] =
+        static_cast<unsigned int*>(mapped_entry(block_offset + scaler_index, 0));
+    return;
+  } else if (mapped()) {
+    decode_scaler(partition, scaler_index);
+    return;
+  }
+
+  assert(bin_fptr_);
+
   unsigned int type, attributes;
   size_t size;
 
   {
     std::lock_guard<std::mutex> lock(file_mutex_);
     auto ptr = pllmod_binary_custom_load(bin_fptr_.get(), 0, &size, &type, &attributes,
-                                         get_offset(map_, block_offset + scaler_index));
+                                         get_offset(block_offset + scaler_index));
     if (!ptr) {
       throw std::runtime_error{std::string("Loading scaler failed: ") + pll_errmsg};
     }
@@ -144,7 +503,7 @@ pll_partition_t* Binary::load_partition() {
   // make skeleton partition that only allocates the pointers to the clv/tipchar buffers
   unsigned int part_attribs = PLLMOD_BIN_ATTRIB_PARTITION_LOAD_SKELETON;
   auto partition = pllmod_binary_partition_load(bin_fptr_.get(), 0, nullptr, &part_attribs,
-                                                get_offset(map_, -1));
+                                                get_offset(-1));
 
   if (!partition) {
     throw std::runtime_error{std::string("Error loading partition: ") + pll_errmsg};
@@ -153,18 +512,22 @@ pll_partition_t* Binary::load_partition() {
   if (partition->attributes & PLL_ATTRIB_SITE_REPEATS) {
     unsigned int repeats_attribs = 0;
     if (pllmod_binary_repeats_load(bin_fptr_.get(), 0, partition, &repeats_attribs,
-                                   get_offset(map_, -3)) != PLL_SUCCESS) {
+                                   get_offset(-3)) != PLL_SUCCESS) {
       throw std::runtime_error{std::string("Error loading repeats: ") + pll_errmsg};
     }
   }
 
+  if (mapped()) {
+    map_partition(partition);
+  }
+
   return partition;
 }
 
 pll_utree_t* Binary::load_utree(const unsigned int num_tips) {
   std::lock_guard<std::mutex> lock(file_mutex_);
   unsigned int attributes = 0;
-  auto root = pllmod_binary_utree_load(bin_fptr_.get(), 0, &attributes, get_offset(map_, -2));
+  auto root = pllmod_binary_utree_load(bin_fptr_.get(), 0, &attributes, get_offset(-2));
   if (!root) {
     throw std::runtime_error{std::string("Loading tree: ") + pll_errmsg};
   }
@@ -204,22 +567,20 @@ static auto create_scaler_to_clv_map(Tree& tree) {
   return map;
 }
 
+static size_t align_up(const size_t offset, const size_t alignment) {
+  return ((offset + alignment - 1) / alignment) * alignment;
+}
+
 /**
-  Writes the structures and data encapsulated in Tree to the specified file in the binary format.
-  Writes them in such a way that the Binary class can read them.
+  Writes the tree, partition and (if used) repeats as pllmod blocks, which make up the head of
+  the store.
 */
-void dump_to_binary(Tree& tree, const std::string& file) {
-  const auto num_clvs = tree.partition()->clv_buffers;
-  const auto num_tips = tree.partition()->tips;
-  const auto num_scalers = tree.partition()->scale_buffers;
-  const auto max_clv_index = num_clvs + num_tips;
-
-  const bool use_tipchars = tree.partition()->attributes & PLL_ATTRIB_PATTERN_TIP;
-  const bool use_repeats = tree.partition()->attributes & PLL_ATTRIB_SITE_REPEATS;
+static void dump_metadata(pll_utree_t* tree, pll_partition_t* partition, const std::string& file) {
+  const bool use_repeats = partition->attributes & PLL_ATTRIB_SITE_REPEATS;
 
   int block_id = use_repeats ? -3 : -2;
 
-  const unsigned int num_blocks = abs(block_id) + num_clvs + num_tips + num_scalers;
+  const unsigned int num_blocks = abs(block_id);
 
   pll_binary_header_t header;
   auto fptr = pllmod_binary_create(file.c_str(), &header, PLLMOD_BIN_ACCESS_RANDOM, num_blocks);
@@ -230,58 +591,254 @@ void dump_to_binary(Tree& tree, const std::string& file) {
 
   const auto attributes = PLLMOD_BIN_ATTRIB_UPDATE_MAP | PLLMOD_BIN_ATTRIB_PARTITION_DUMP_WGT;
 
-  if (use_repeats and
-      not pllmod_binary_repeats_dump(fptr, block_id++, tree.partition(), attributes)) {
+  if (use_repeats and not pllmod_binary_repeats_dump(fptr, block_id++, partition, attributes)) {
     throw std::runtime_error{std::string("Error dumping the repeats: ") + pll_errmsg};
   }
 
   // dump the utree structure
-  if (!pllmod_binary_utree_dump(fptr, block_id++, get_root(tree.tree()), num_tips, attributes)) {
+  if (!pllmod_binary_utree_dump(fptr, block_id++, get_root(tree), partition->tips, attributes)) {
     throw std::runtime_error{std::string("Error dumping the utree to binary: ") + pll_errmsg};
   }
 
   // dump the partition
-  if (!pllmod_binary_partition_dump(fptr, block_id++, tree.partition(), attributes)) {
+  if (!pllmod_binary_partition_dump(fptr, block_id++, partition, attributes)) {
     throw std::runtime_error{std::string("Error dumping partition to binary: ") + pll_errmsg};
   }
 
-  // dump the tipchars, but only if partition uses them
-  size_t tip_index = 0;
-  if (use_tipchars) {
-    for (tip_index = 0; tip_index < num_tips; tip_index++) {
-      if (!pllmod_binary_custom_dump(fptr, block_id++, tree.partition()->tipchars[tip_index],
-                                     tree.partition()->sites * sizeof(unsigned char), attributes)) {
-        throw std::runtime_error{std::string("Error dumping tipchars to binary: ") + pll_errmsg};
+  fclose(fptr);
+}
+
+static void rethrow_any(std::vector<std::exception_ptr> const& errors) {
+  for (auto const& e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+}
+
+Store_Writer::Store_Writer(const std::string& file, const Options::StorePrecision precision)
+    : file_(file), precision_(precision) {}
+
+Store_Writer::~Store_Writer() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void Store_Writer::begin(pll_utree_t* tree, pll_partition_t* partition) {
+  if (partition->attributes & PLL_ATTRIB_SITE_REPEATS) {
+    return;
+  }
+  lay_out(tree, partition);
+}
+
+/**
+  Writes the metadata blocks and computes the offsets of the tipchar and CLV entries that follow
+  them.
+*/
+void Store_Writer::lay_out(pll_utree_t* tree, pll_partition_t* partition) {
+  dump_metadata(tree, partition, file_);
+
+  fd_ = open(file_.c_str(), O_WRONLY);
+  struct stat info;
+  if (fd_ < 0 or fstat(fd_, &info) != 0) {
+    throw std::runtime_error{std::string("Error opening binary file for writing: ") + file_};
+  }
+
+  end_ = info.st_size;
+  alignment_ = std::max(STORE_ALIGNMENT, static_cast<size_t>(partition->alignment));
+
+  const size_t max_clv_index = partition->tips + partition->clv_buffers;
+  const bool use_tipchars = partition->attributes & PLL_ATTRIB_PATTERN_TIP;
+  const size_t span = partition->rate_cats * partition->states_padded;
+
+  entries_.clear();
+  for (size_t i = 0; i < max_clv_index; ++i) {
+    size_t size = partition->sites * sizeof(unsigned char);
+    uint32_t encoding = STORE_ENCODING_RAW;
+
+    if (not use_tipchars or i >= partition->tips) {
+      const auto clv_size = pll_get_clv_size(partition, i);
+      if (precision_ == Options::StorePrecision::kSingle) {
+        size = encoded_float32_size(clv_size, span);
+        encoding = STORE_ENCODING_FLOAT32;
+      } else if (precision_ == Options::StorePrecision::kScaled16) {
+        size = encoded_scaled16_size(clv_size, span);
+        encoding = STORE_ENCODING_SCALED16;
+      } else {
+        size = clv_size * sizeof(double);
       }
     }
+
+    entries_.push_back({align_up(end_, alignment_), size, encoding, 0});
+    end_ = entries_.back().offset + size;
   }
 
-  // dump the clvs
-  for (size_t clv_index = tip_index; clv_index < max_clv_index; clv_index++) {
-    if (!pllmod_binary_clv_dump(fptr, block_id++, tree.partition(), clv_index, attributes)) {
-      throw std::runtime_error{std::string("Error dumping clvs to binary: ") + pll_errmsg};
+  written_.assign(max_clv_index, false);
+}
+
+void Store_Writer::write_at(void const* const data, const size_t size, const size_t offset) {
+  auto const bytes = static_cast<char const*>(data);
+  for (size_t done = 0; done < size;) {
+    const auto result = pwrite(fd_, bytes + done, size - done, offset + done);
+    if (result < 0 and errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      throw std::runtime_error{std::string("Error writing the binary store: ") + file_};
     }
+    done += result;
   }
+}
 
-  const auto scaler_to_clv = create_scaler_to_clv_map(tree);
+void Store_Writer::write_buffer(pll_partition_t* partition, const unsigned int clv_index) {
+  auto const& entry = entries_[clv_index];
+
+  if (partition->attributes & PLL_ATTRIB_PATTERN_TIP and clv_index < partition->tips) {
+    write_at(partition->tipchars[clv_index], entry.size, entry.offset);
+    return;
+  }
 
-  const auto scaler_ptr = tree.partition()->scale_buffer;
+  const auto clv_size = pll_get_clv_size(partition, clv_index);
+  const size_t span = partition->rate_cats * partition->states_padded;
+  std::vector<char> encoded;
+
+  if (entry.encoding == STORE_ENCODING_FLOAT32) {
+    encoded = encode_float32(partition->clv[clv_index], clv_size, span);
+  } else if (entry.encoding == STORE_ENCODING_SCALED16) {
+    encoded = encode_scaled16(partition->clv[clv_index], clv_size, span);
+  } else {
+    write_at(partition->clv[clv_index], entry.size, entry.offset);
+    return;
+  }
+  write_at(encoded.data(), encoded.size(), entry.offset);
+}
 
-  for (size_t scaler_index = 0; scaler_index < num_scalers; scaler_index++) {
-    const auto scaler_size = pll_get_sites_number(tree.partition(), scaler_to_clv[scaler_index]);
+/**
+  Writes the CLV with the given index, which must be final. Safe to call concurrently for
+  distinct indices. Does nothing if the layout is not known yet.
+*/
+void Store_Writer::write_clv(pll_partition_t* partition, const unsigned int clv_index) {
+  if (fd_ < 0 or clv_index >= written_.size()) {
+    return;
+  }
+  write_buffer(partition, clv_index);
+  written_[clv_index] = true;
+}
 
-    // with the repeats the scale buffers might not be allocated. dirty fix:
-    // allocate them in this case, just so they can be written and later used
-    if (scaler_ptr[scaler_index] == nullptr) {
-      scaler_ptr[scaler_index] =
-          static_cast<unsigned int*>(calloc(scaler_size, sizeof(unsigned int)));
+/**
+  Writes all tipchars and CLVs that have not been streamed yet, then the scalers, the index and
+  the trailer. The scalers go last as their encoded size is only known once they are final.
+*/
+void Store_Writer::finish(Tree& tree) {
+  auto partition = tree.partition();
+  if (fd_ < 0) {
+    lay_out(tree.tree(), partition);
+  }
+
+#ifdef __OMP
+  const unsigned int num_threads =
+      tree.options().num_threads ? tree.options().num_threads : omp_get_max_threads();
+#endif
+
+  // errors may not leave the parallel regions, so they are passed on after them
+  std::vector<std::exception_ptr> errors(written_.size());
+
+#ifdef __OMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+#endif
+  for (size_t i = 0; i < written_.size(); ++i) {
+    try {
+      if (not written_[i]) {
+        write_buffer(partition, i);
+        written_[i] = true;
+      }
+    } catch (...) {
+      errors[i] = std::current_exception();
     }
+  }
+  rethrow_any(errors);
+
+  const bool compact = precision_ != Options::StorePrecision::kDouble;
+  const auto scaler_to_clv = create_scaler_to_clv_map(tree);
+  const size_t num_scalers = partition->scale_buffers;
+
+  // with the repeats the scale buffers might not be allocated, in which case they are all zero
+  std::vector<std::vector<char>> encoded(num_scalers);
+  std::vector<size_t> sizes(num_scalers);
+  errors.assign(num_scalers, nullptr);
+
+#ifdef __OMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+#endif
+  for (size_t i = 0; i < num_scalers; ++i) {
+    try {
+      const auto scaler_size = pll_get_sites_number(partition, scaler_to_clv[i]);
+      sizes[i] = scaler_size * sizeof(unsigned int);
+
+      auto scaler = partition->scale_buffer[i];
+      std::vector<unsigned int> zeros;
+      if (scaler == nullptr) {
+        zeros.assign(scaler_size, 0);
+        scaler = zeros.data();
+      }
 
-    if (!pllmod_binary_custom_dump(fptr, block_id++, scaler_ptr[scaler_index],
-                                   scaler_size * sizeof(unsigned int), attributes)) {
-      throw std::runtime_error{std::string("Error dumping scalers to binary: ") + pll_errmsg};
+      if (compact) {
+        encoded[i] = encode_rle(scaler, scaler_size);
+        sizes[i] = encoded[i].size();
+      } else if (not zeros.empty()) {
+        encoded[i].assign(sizes[i], 0);
+      }
+    } catch (...) {
+      errors[i] = std::current_exception();
     }
   }
+  rethrow_any(errors);
 
-  fclose(fptr);
+  const size_t first_scaler = entries_.size();
+  for (size_t i = 0; i < num_scalers; ++i) {
+    entries_.push_back({align_up(end_, alignment_), sizes[i],
+                        compact ? STORE_ENCODING_RLE : STORE_ENCODING_RAW, 0});
+    end_ = entries_.back().offset + sizes[i];
+  }
+
+#ifdef __OMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+#endif
+  for (size_t i = 0; i < num_scalers; ++i) {
+    try {
+      auto const data = encoded[i].empty() ? static_cast<void const*>(partition->scale_buffer[i])
+                                           : encoded[i].data();
+      write_at(data, sizes[i], entries_[first_scaler + i].offset);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  }
+  rethrow_any(errors);
+
+  Store_Trailer trailer;
+  trailer.index_offset = align_up(end_, alignof(Store_Entry));
+  trailer.num_entries = entries_.size();
+  trailer.version = compact ? STORE_VERSION_COMPACT : STORE_VERSION_RAW;
+  trailer.reserved = 0;
+  std::memcpy(trailer.magic, STORE_MAGIC, sizeof(trailer.magic));
+
+  const size_t index_size = entries_.size() * sizeof(Store_Entry);
+  write_at(entries_.data(), index_size, trailer.index_offset);
+  write_at(&trailer, sizeof(Store_Trailer), trailer.index_offset + index_size);
+
+  if (close(fd_) != 0) {
+    throw std::runtime_error{std::string("Error closing the binary store: ") + file_};
+  }
+  fd_ = -1;
+}
+
+/**
+  Writes the structures and data encapsulated in Tree to the specified file in the binary format.
+  Writes them in such a way that the Binary class can read them: the tree, partition and repeats
+  go into pllmod blocks, the buffers into the memory mappable data section that follows them.
+*/
+void dump_to_binary(Tree& tree, const std::string& file) {
+  Store_Writer writer(file, tree.options().store_precision);
+  writer.finish(tree);
 }
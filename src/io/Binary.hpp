@@ -2,15 +2,28 @@
 
 #include <string>
 #include <cstdio>
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <mutex>
 
 #include "core/pll/pllhead.hpp"
+#include "util/Options.hpp"
 
 // custom deleter
 int safe_fclose(FILE* fptr);
 
+/**
+  Describes where one tipchar, CLV or scaler buffer lies within the data section of the store.
+  Offsets are absolute file offsets, sizes are in bytes.
+*/
+struct Store_Entry {
+  uint64_t offset;
+  uint64_t size;
+  uint32_t encoding;
+  uint32_t reserved;
+};
+
 class Binary {
 public:
   using file_ptr_type = std::unique_ptr<FILE, int (*)(FILE*)>;
@@ -18,7 +31,7 @@ public:
   explicit Binary(const std::string& bin_file_path);
   Binary() : bin_fptr_(nullptr, safe_fclose) {}
   Binary(Binary&& other);
-  ~Binary() = default;
+  ~Binary();
 
   Binary& operator=(Binary&& other);
 
@@ -29,12 +42,74 @@ public:
   pll_partition_t* load_partition();
   pll_utree_t* load_utree(const unsigned int num_tips);
 
+  // true if the buffers are served straight from a memory mapping of the file
+  bool mapped() const { return map_base_ != nullptr; }
+  // true if all buffers are served from the mapping as they are, without expanding them
+  bool zero_copy() const { return mapped() and zero_copy_; }
+  bool contains(void const* const ptr) const;
+  void unmap_partition(pll_partition_t* partition);
+  void prefetch(pll_partition_t const* partition, std::vector<pll_unode_t const*> const& nodes);
+  void discard(pll_partition_t const* partition, const unsigned int clv_index,
+               const unsigned int scaler_index);
+
 private:
+  void map_store(const std::string& bin_file_path);
+  void map_partition(pll_partition_t* partition);
+  void* mapped_entry(const size_t index, const size_t expected_size);
+  bool is_raw(const size_t index) const;
+  void decode_clv(pll_partition_t* partition, const unsigned int clv_index);
+  void decode_scaler(pll_partition_t* partition, const unsigned int scaler_index);
+  long int get_offset(const int block_id) const;
+
   std::mutex file_mutex_;
   file_ptr_type bin_fptr_;
-  std::vector<pll_block_map_t> map_;
+  // file offsets of the pllmod blocks, indexed by block_id - min_block_id_
+  std::vector<long int> offsets_;
+  int min_block_id_ = 0;
+
+  // memory mapped data section, if the file has one
+  char* map_base_ = nullptr;
+  size_t map_size_ = 0;
+  bool zero_copy_ = false;
+  std::vector<Store_Entry> entries_;
 };
 
 class Tree;
 
+/**
+  Writes the binary store. The offset of every CLV and tipchar entry is known as soon as the
+  partition exists, so they are written with pwrite at their final offset, concurrently and in any
+  order. That allows writing each CLV as soon as precompute_clvs has computed it (via write_clv),
+  while finish writes whatever is left, followed by the scalers, the index and the trailer.
+
+  With site repeats the CLV sizes are only known after the precomputation, so nothing is streamed
+  and finish does all the work.
+*/
+class Store_Writer {
+public:
+  Store_Writer(const std::string& file, const Options::StorePrecision precision);
+  ~Store_Writer();
+
+  Store_Writer(Store_Writer const& other) = delete;
+  Store_Writer& operator=(Store_Writer const& other) = delete;
+
+  void begin(pll_utree_t* tree, pll_partition_t* partition);
+  void write_clv(pll_partition_t* partition, const unsigned int clv_index);
+  void finish(Tree& tree);
+
+private:
+  void lay_out(pll_utree_t* tree, pll_partition_t* partition);
+  void write_buffer(pll_partition_t* partition, const unsigned int clv_index);
+  void write_at(void const* const data, const size_t size, const size_t offset);
+
+  std::string file_;
+  Options::StorePrecision precision_;
+  int fd_ = -1;
+  size_t alignment_ = 0;
+  size_t end_ = 0;
+  std::vector<Store_Entry> entries_;
+  // per CLV entry, whether it has been written yet. not vector<bool>: set from several threads
+  std::vector<char> written_;
+};
+
 void dump_to_binary(Tree& tree, const std::string& file);
@@ -4,13 +4,29 @@
 #include <limits>
 #include <memory>
 #include <sstream>
+#include <fstream>
+#include <cstring>
+
+#include <exception>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __OMP
+#include <omp.h>
+#endif
 
 #include "seq/MSA.hpp"
 #include "seq/MSA_Info.hpp"
 #include "io/encoding.hpp"
+#include "io/Mapped_File.hpp"
+#include "io/fasta_blocks.hpp"
 #include "util/template_magic.hpp"
 #include "util/stringify.hpp"
 #include "util/logging.hpp"
+#include "util/Range.hpp"
 
 #include "genesis/utils/io/serializer.hpp"
 #include "genesis/utils/io/deserializer.hpp"
@@ -18,8 +34,25 @@
 #include "genesis/sequence/functions/functions.hpp"
 #include "genesis/sequence/sequence.hpp"
 
+/*
+  Layout of a bfast file:
+  <magic><num_sequences>[<flags>]<mask><offset table><entries>
+
+  Version 1 (magic "BFAST") has no flags, and every entry is
+  <label><sequence_length><4 bit encoded sequence>
+
+  Version 2 (magic "BFAST2") adds the flags, and every entry is
+  <label><valid range begin><valid range span><sequence_length><encoded sequence>
+  where the encoding is 5 bit for amino acids and 4 bit otherwise. If the file is premasked, the
+  sequences are stored with the sites of the mask removed, and the valid range refers to that.
+*/
 constexpr char MAGIC[] = "BFAST\0";
+constexpr char MAGIC_V2[] = "BFAST2";
 constexpr size_t MAGIC_SIZE = array_size(MAGIC);
+static_assert(MAGIC_SIZE == array_size(MAGIC_V2), "Magic strings need to be of the same size");
+
+constexpr uint64_t BFAST_PREMASKED = 1;
+constexpr uint64_t BFAST_AMINO = 2;
 
 using mask_type = MSA_Info::mask_type;
 
@@ -30,19 +63,45 @@ static FourBit& code_() {
   return obj;
 }
 
+static FiveBit& aa_code_() {
+  static FiveBit obj;
+  return obj;
+}
+
+struct Bfast_Header {
+  unsigned int version = 2;
+  uint64_t flags = 0;
+  mask_type mask;
+  std::vector<uint64_t> offsets;
+};
+
+static inline size_t packed_size(const uint64_t flags, const size_t size) {
+  return (flags & BFAST_AMINO) ? aa_code_().packed_size(size) : code_().packed_size(size);
+}
+
+// bytes of an entry besides its label and sequence
+static inline size_t entry_overhead(const unsigned int version) {
+  return sizeof(uint64_t) * (version == 1 ? 2 : 4);
+}
+
 static inline size_t data_section_offset(const size_t num_sequences, const size_t mask_size) {
-  return MAGIC_SIZE + sizeof(num_sequences) + (num_sequences * sizeof(uint64_t) * 2) + mask_size +
-         sizeof(uint64_t);
+  return MAGIC_SIZE + sizeof(num_sequences) + sizeof(uint64_t) +
+         (num_sequences * sizeof(uint64_t) * 2) + mask_size + sizeof(uint64_t);
 }
 
+/**
+  Writes the header of a (version 2) bfast file. The entry sizes are those of the labels plus the
+  encoded sequences.
+*/
 static inline void write_header(utils::Serializer& ser, const std::vector<size_t>& entry_sizes,
-                                const mask_type& mask) {
+                                const mask_type& mask, const uint64_t flags) {
   const uint64_t num_sequences = entry_sizes.size();
 
   // First part:
-  // <magic string><num_sequences>
-  ser.put_raw(MAGIC, MAGIC_SIZE);
+  // <magic string><num_sequences><flags>
+  ser.put_raw(MAGIC_V2, MAGIC_SIZE);
   ser.put_int(num_sequences);
+  ser.put_int(flags);
 
   // Second part: the gap mask
   // <mask_width><mask_string>
@@ -58,98 +117,103 @@ static inline void write_header(utils::Serializer& ser, const std::vector<size_t
     ser.put_int(offset);
 
     // precompute offset of next entry
-    const uint64_t sizeof_entry = sizeof(uint64_t) * 2  // header_length and seq_length
-                                  + static_cast<uint64_t>(entry_sizes[i]);
-    offset += sizeof_entry;
+    offset += entry_overhead(2) + static_cast<uint64_t>(entry_sizes[i]);
   }
 }
 
-static inline std::vector<size_t> get_entry_sizes(const MSA& msa) {
-  std::vector<size_t> res;
-  for (const auto& s : msa) {
-    res.push_back(code_().packed_size(s.sequence().size()) + s.header().size());
+/**
+  Probes a sequence for the encoding it needs: the 5 bit one if it has any character outside of
+  NT_MAP. As the encoding holds for the whole file, the flags of all sequences are to be combined.
+*/
+static inline uint64_t sequence_flags(const std::string& seq) {
+  uint64_t flags = 0;
+  for (const auto& s : seq) {
+    if (code_().valid(s)) {
+      continue;
+    }
+    if (not aa_code_().valid(s)) {
+      throw std::runtime_error{std::string("Unsupported character for conversion to bfast: ") + s};
+    }
+    flags = BFAST_AMINO;
   }
-  return res;
+  return flags;
 }
 
-static inline void put_encoded(utils::Serializer& ser, const std::string& seq) {
-  const auto encoded_seq = code_().to_fourbit(seq);
-  // put the size of actual characters
-  ser.put_int<uint64_t>(seq.size());
-  // pack characters into encoding, write them out
-  ser.put_raw_string(encoded_seq);
+template <class T>
+static inline void append_int(std::string& out, const T value) {
+  out.append(reinterpret_cast<char const*>(&value), sizeof(T));
 }
 
-static std::string get_decoded(utils::Deserializer& des) {
-  // get the size of characters that were packed
-  const auto decoded_size = des.get_int<uint64_t>();
+/**
+  Appends an entry, serialized like utils::Serializer would, to the buffer.
+*/
+static inline void append_entry(std::string& out, const uint64_t flags, const std::string& label,
+                                const std::string& seq) {
+  append_int<size_t>(out, label.size());
+  out.append(label);
 
-  // figure out how much that is in bytes
-  // (decoded_size = 3 would mean 2 bytes, one for the first two, one for the third plus padding)
-  const auto coded_size = code_().packed_size(decoded_size);
+  const auto range = seq.empty() ? Range(0, 0) : get_valid_range(seq);
+  append_int<uint64_t>(out, range.begin);
+  append_int<uint64_t>(out, range.span);
 
-  // get the bytes
-  auto coded_str = des.get_raw_string(coded_size);
+  // put the size of actual characters
+  append_int<uint64_t>(out, seq.size());
+  // pack characters into encoding, write them out
+  out.append((flags & BFAST_AMINO) ? aa_code_().to_fivebit(seq) : code_().to_fourbit(seq));
+}
 
-  // decode and return
-  return code_().from_fourbit(coded_str, decoded_size);
+static inline void write_at(const int fd, const std::string& data, const size_t offset) {
+  for (size_t done = 0; done < data.size();) {
+    const auto result = pwrite(fd, data.data() + done, data.size() - done, offset + done);
+    if (result < 0 and errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      throw std::runtime_error{"Error writing the bfast file"};
+    }
+    done += result;
+  }
 }
 
-static void read_header(utils::Deserializer& des, std::vector<uint64_t>& offset, mask_type& mask) {
+static Bfast_Header read_header(utils::Deserializer& des) {
+  Bfast_Header header;
+
   // read the header info
   char magic[MAGIC_SIZE];
   des.get_raw(magic, MAGIC_SIZE);
 
-  if (strcmp(magic, MAGIC)) {
+  if (not strcmp(magic, MAGIC)) {
+    header.version = 1;
+  } else if (strcmp(magic, MAGIC_V2)) {
     throw std::runtime_error{std::string("File is not an epa::Binary_Fasta file")};
   }
 
   const uint64_t num_sequences = des.get_int<uint64_t>();
 
+  if (header.version > 1) {
+    header.flags = des.get_int<uint64_t>();
+  }
+
   // retrieve the mask
-  mask = mask_type();
   std::stringstream mask_str(des.get_string());
-  mask_str >> mask;
+  mask_str >> header.mask;
 
-  offset = std::vector<uint64_t>(num_sequences);
+  header.offsets = std::vector<uint64_t>(num_sequences);
   // read the random access table
   for (size_t i = 0; i < num_sequences; ++i) {
     // sequence id
     const auto idx = des.get_int<uint64_t>();
     // offset
-    offset[idx] = des.get_int<uint64_t>();
+    header.offsets[idx] = des.get_int<uint64_t>();
   }
-}
-
-static MSA read_sequences(utils::Deserializer& des, const mask_type& mask, const size_t number,
-                          const size_t sites = 0) {
-  MSA msa(sites);
-
-  for (size_t i = 0; i < number; ++i) {
-    auto label = des.get_string();
-    auto sequence = get_decoded(des);
 
-    if (mask.count()) {
-      sequence = subset_sequence(sequence, mask);
-    }
-
-    msa.append(label, sequence);
-  }
-
-  return msa;
+  return header;
 }
 
-static void ensure_dna(const std::string& seq) {
-  for (const auto& s : seq) {
-    bool found = false;
-    for (size_t i = 0; i < NT_MAP_SIZE and not found; ++i) {
-      found = (s == NT_MAP[i]);
-    }
-    if (not found) {
-      throw std::runtime_error{std::string("AA DATA NOT SUPPORTED for conversion to bfast!") +
-                               " Sorry! Offending char: " + s};
-    }
-  }
+static inline Bfast_Header read_header(const std::string& file_name) {
+  std::ifstream istream(file_name);
+  utils::Deserializer des(istream);
+  return read_header(des);
 }
 
 class Binary_Fasta {
@@ -159,88 +223,210 @@ private:
 
 public:
   static MSA_Info get_info(const std::string& file) {
-    utils::Deserializer des(file);
-
-    std::vector<uint64_t> offset;
-    mask_type mask;
-    read_header(des, offset, mask);
-
-    const auto sequences = offset.size();
+    const auto header = read_header(file);
 
-    return MSA_Info(file, sequences, mask, mask.size());
+    return MSA_Info(file, header.offsets.size(), header.mask, header.mask.size());
   }
 
-  static void save(const MSA& msa, const std::string& file_name) {
+  /**
+    Writes the MSA to a bfast file. If a reference mask is given, the sequences are stored masked
+    with it, combined with the gap mask of the MSA.
+  */
+  static void save(const MSA& msa, const std::string& file_name,
+                   const mask_type& reference_mask = mask_type()) {
     // get the gap mask for the MSA
-    mask_type gap_mask(msa.num_sites(), true);
+    Site_Mask site_mask(msa.num_sites(), true);
     for (const auto& s : msa) {
-      const genesis::sequence::Sequence seq("", s.sequence());
-      // get the mask of the current sequence
-      auto cur_mask = genesis::sequence::gap_sites(seq);
-      // adjust global mask accordingly
-      gap_mask &= cur_mask;
+      site_mask.and_gap_sites(s.sequence());
     }
 
+    uint64_t flags = 0;
+    for (const auto& s : msa) {
+      flags |= sequence_flags(s.sequence());
+    }
+    if (reference_mask.size()) {
+      site_mask |= Site_Mask(reference_mask);
+      flags |= BFAST_PREMASKED;
+    }
+    const auto gap_mask = site_mask.to_bitvector();
+    const size_t width =
+        (flags & BFAST_PREMASKED) ? gap_mask.size() - gap_mask.count() : msa.num_sites();
+
     utils::Serializer ser(file_name);
 
     // Write the header
-    auto sizes = get_entry_sizes(msa);
-    write_header(ser, sizes, gap_mask);
+    std::vector<size_t> sizes;
+    for (const auto& s : msa) {
+      sizes.push_back(packed_size(flags, width) + s.header().size());
+    }
+    write_header(ser, sizes, gap_mask, flags);
 
-    // Write the data. Every entry:
-    // <header_length (bytes/chars)><header string><sequence_length><encoded sequence padded to next
-    // byte> (note: the sequence_length is in number of encoded characters, so for 4bit the number
-    // of bytes to be read is sequence_length * 2)
+    // Write the data
+    std::string entry;
     for (const auto& s : msa) {
-      ser.put_string(s.header());
-      put_encoded(ser, s.sequence());
+      entry.clear();
+      append_entry(entry, flags, s.header(),
+                   (flags & BFAST_PREMASKED) ? subset_sequence(s.sequence(), site_mask)
+                                             : s.sequence());
+      ser.put_raw_string(entry);
     }
   }
 
-  static MSA load(const std::string& file_name, const bool premasking = false) {
-    utils::Deserializer des(file_name);
+  static MSA load(const std::string& file_name, const bool premasking = false);
 
-    std::vector<uint64_t> offset;
-    mask_type mask;
-    read_header(des, offset, mask);
+  /**
+    Converts a fasta file to bfast. If a reference mask is given, the sequences are stored masked
+    with it, combined with the gap mask of the fasta file.
 
-    if (not premasking) {
-      mask = mask_type();
-    }
-
-    return read_sequences(des, mask, offset.size());
-  }
-
-  static std::string fasta_to_bfast(const std::string& fasta_file, std::string out_dir) {
+    The file is split into blocks of whole records, which are parsed in parallel twice: once to
+    get the sizes of the entries and the gap mask, and once more to encode the entries and write
+    them straight to their final offset in the output file.
+  */
+  static std::string fasta_to_bfast(const std::string& fasta_file, std::string out_dir,
+                                    const mask_type& reference_mask = mask_type(),
+                                    const unsigned int num_threads = 0) {
     auto parts = split_by_delimiter(fasta_file, "/");
 
     out_dir += parts.back() + ".bfast";
 
-    // specific, per sequence sizes
-    std::vector<size_t> entry_sizes;
-    // and a function to get it during msa info fetch
-    auto get_sizes = [&](const genesis::sequence::Sequence& s) {
-      entry_sizes.push_back(s.label().size() + code_().packed_size(s.sites().size()));
+#ifdef __OMP
+    const unsigned int threads = num_threads ? num_threads : omp_get_max_threads();
+#else
+    (void)num_threads;
+    const unsigned int threads = 1;
+#endif
+
+    Mapped_File fasta(fasta_file);
+    fasta.advise(MADV_SEQUENTIAL);
+
+    // a few blocks per thread evens out blocks that take longer than others
+    const auto blocks = split_fasta(fasta.data(), fasta.size(), threads * 4);
+
+    struct Block_Info {
+      std::vector<size_t> label_sizes;
+      size_t sites = 0;
+      Site_Mask gap_mask;
+      uint64_t flags = 0;
+      std::exception_ptr error;
     };
+    std::vector<Block_Info> block_info(blocks.size());
+
+    // first pass: sizes and gap mask of every block
+#ifdef __OMP
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+#endif
+    for (size_t b = 0; b < blocks.size(); ++b) {
+      auto& block = block_info[b];
+      try {
+        parse_fasta_block(fasta.data(), blocks[b], [&](std::string& label, std::string& sites) {
+          if (block.label_sizes.empty()) {
+            block.sites = sites.size();
+            block.gap_mask = Site_Mask(sites.size(), true);
+          } else if (block.sites != sites.size()) {
+            throw std::runtime_error{fasta_file +
+                                     " does not contain equal size sequences! First offending "
+                                     "sequence: " + label};
+          }
+          block.label_sizes.push_back(label.size());
+          block.gap_mask.and_gap_sites(sites);
+          block.flags |= sequence_flags(sites);
+        });
+      } catch (...) {
+        block.error = std::current_exception();
+      }
+    }
+
+    // combine the blocks
+    size_t num_sequences = 0;
+    size_t sites = 0;
+    Site_Mask site_mask;
+    uint64_t flags = 0;
+    for (auto& block : block_info) {
+      if (block.error) {
+        std::rethrow_exception(block.error);
+      }
+      if (block.label_sizes.empty()) {
+        continue;
+      }
+      if (not num_sequences) {
+        sites = block.sites;
+        site_mask = block.gap_mask;
+      } else if (block.sites != sites) {
+        throw std::runtime_error{fasta_file + " does not contain equal size sequences!"};
+      } else {
+        site_mask &= block.gap_mask;
+      }
+      // any amino acid character anywhere makes it AA data
+      flags |= block.flags;
+      num_sequences += block.label_sizes.size();
+    }
+
+    LOG_DBG << MSA_Info(fasta_file, num_sequences, site_mask.to_bitvector(), sites);
 
-    MSA_Info info(fasta_file, get_sizes);
+    if (reference_mask.size()) {
+      if (reference_mask.size() != site_mask.size()) {
+        throw std::runtime_error{"The reference and query alignments differ in width!"};
+      }
+      site_mask |= Site_Mask(reference_mask);
+      flags |= BFAST_PREMASKED;
+    }
+    const auto mask = site_mask.to_bitvector();
+    const size_t width = (flags & BFAST_PREMASKED) ? mask.size() - mask.count() : sites;
+    const size_t packed = packed_size(flags, width);
 
-    LOG_DBG << info;
+    // the entries of every block are contiguous, starting at the offset of its first one
+    std::vector<size_t> entry_sizes;
+    std::vector<size_t> block_offsets;
+    size_t offset = data_section_offset(num_sequences, mask.size());
+    for (auto const& block : block_info) {
+      block_offsets.push_back(offset);
+      for (auto const label_size : block.label_sizes) {
+        entry_sizes.push_back(label_size + packed);
+        offset += entry_overhead(2) + entry_sizes.back();
+      }
+    }
 
     // write the header
-    utils::Serializer ser(out_dir);
-    write_header(ser, entry_sizes, info.gap_mask());
+    {
+      utils::Serializer ser(out_dir);
+      write_header(ser, entry_sizes, mask, flags);
+    }
 
-    // write the data
-    auto it = sequence::FastaInputIterator(utils::from_file(fasta_file));
+    const int fd = open(out_dir.c_str(), O_WRONLY);
+    if (fd < 0) {
+      throw std::runtime_error{"Could not open bfast file for writing: " + out_dir};
+    }
 
-    // probe first seq to see if this might be AA data
-    ensure_dna(it->sites());
+    // second pass: encode and write the entries of every block
+    static constexpr size_t FLUSH_SIZE = 1 << 22;
+#ifdef __OMP
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+#endif
+    for (size_t b = 0; b < blocks.size(); ++b) {
+      try {
+        std::string buffer;
+        size_t position = block_offsets[b];
+        parse_fasta_block(fasta.data(), blocks[b], [&](std::string& label, std::string& sites) {
+          append_entry(buffer, flags, label,
+                       (flags & BFAST_PREMASKED) ? subset_sequence(sites, site_mask) : sites);
+          if (buffer.size() >= FLUSH_SIZE) {
+            write_at(fd, buffer, position);
+            position += buffer.size();
+            buffer.clear();
+          }
+        });
+        write_at(fd, buffer, position);
+      } catch (...) {
+        block_info[b].error = std::current_exception();
+      }
+    }
 
-    while (it) {
-      ser.put_string(it->label());
-      put_encoded(ser, it->sites());
-      ++it;
+    close(fd);
+
+    for (auto const& block : block_info) {
+      if (block.error) {
+        std::rethrow_exception(block.error);
+      }
     }
     return out_dir;
   }
@@ -249,28 +435,34 @@ public:
 #include "io/msa_reader_interface.hpp"
 #include "net/epa_mpi_util.hpp"
 
+/**
+  Reads a bfast file through a read-only memory mapping of it. Every sequence is decoded straight
+  from the mapping into its final string, with the mask applied during decoding, so the only
+  allocations per sequence are its label and its sequence.
+
+  Premasked files can only be read with premasking, with a mask that contains the one the file
+  was written with (as MSA_Info::or_mask ensures).
+*/
 class Binary_Fasta_Reader : public msa_reader {
 public:
   Binary_Fasta_Reader(std::string const& file_name, MSA_Info const& info,
                       bool const premasking = false, bool const split = false)
-      : istream_(file_name), des_(istream_), mask_(info.gap_mask()) {
-    mask_type dummy_mask;
-    read_header(des_, seq_offsets_, dummy_mask);
+      : file_name_(file_name), file_(file_name) {
+    auto header = read_header(file_name);
+    version_ = header.version;
+    flags_ = header.flags;
+    seq_offsets_ = std::move(header.offsets);
 
     assert(seq_offsets_.size() == info.sequences());
 
+    file_.advise(MADV_SEQUENTIAL);
+
 // if we are under MPI, skip to this ranks assigned part of the input file
 #ifdef __MPI
     if (split) {
-      // get info about to which sequence to skip to and how much this rank should read
-      std::tie(local_seq_offset_, max_read_) = local_seq_package(info.sequences());
-
-      // skip to that offset in the underlying istream
-      istream_ = std::ifstream(file_name);
-      istream_.seekg(seq_offsets_[local_seq_offset_], istream_.beg);
-
-      // rebuild the deserializer, starting from the desired sequence
-      des_ = utils::Deserializer(istream_);
+      // get info about to which sequence to skip to and how much this rank should read, such
+      // that every rank gets about the same amount of work
+      std::tie(local_seq_offset_, max_read_) = local_seq_package(work_estimates());
     }
 #else
     static_cast<void>(split);
@@ -278,17 +470,65 @@ public:
 
     max_read_ = std::min(seq_offsets_.size(), max_read_);
 
-    if (not premasking) {
-      mask_ = mask_type();
+    if (max_read_ > 0) {
+      position_ = seq_offsets_[local_seq_offset_];
+    }
+
+    if (flags_ & BFAST_PREMASKED) {
+      if (not premasking) {
+        throw std::runtime_error{"The bfast file " + file_name +
+                                 " is premasked and can only be used with premasking"};
+      }
+      select_sites(header.mask, info.gap_mask());
+    } else if (premasking and info.gap_mask().count()) {
+      select_sites(mask_type(info.gap_mask().size(), false), info.gap_mask());
     }
   }
 
   ~Binary_Fasta_Reader() = default;
 
-  virtual size_t read_next(MSA& result, const size_t number) override {
+  Binary_Fasta_Reader(Binary_Fasta_Reader const& other) = delete;
+  Binary_Fasta_Reader& operator=(Binary_Fasta_Reader const& other) = delete;
+
+  virtual size_t read_next(MSA_Chunk& result, const size_t number) override {
     const auto to_read = std::min(number, max_read_ - num_read_);
 
-    result = read_sequences(des_, mask_, to_read);
+    result.clear();
+
+    for (size_t i = 0; i < to_read; ++i) {
+      const auto label_size = get_size();
+      auto const label = get_bytes(label_size);
+
+      Range range(0, 0);
+      if (version_ > 1) {
+        range.begin = get_size();
+        range.span = get_size();
+      }
+
+      const auto num_chars = get_size();
+      auto const packed = get_bytes(packed_size(flags_, num_chars));
+
+      if (width_) {
+        if (num_chars != width_) {
+          throw std::runtime_error{"In Binary_Fasta_Reader: mask and sequence incompatible: " +
+                                   std::string(label, label_size)};
+        }
+        // the stored range does not apply to the subset
+        auto const sequence = result.append(label, label_size, sites_.size());
+        if (flags_ & BFAST_AMINO) {
+          aa_code_().from_fivebit(packed, sites_, sequence);
+        } else {
+          code_().from_fourbit(packed, sites_, sequence);
+        }
+      } else {
+        auto const sequence = result.append(label, label_size, num_chars, range);
+        if (flags_ & BFAST_AMINO) {
+          aa_code_().from_fivebit(packed, num_chars, sequence);
+        } else {
+          code_().from_fourbit(packed, num_chars, sequence);
+        }
+      }
+    }
 
     num_read_ += result.size();
 
@@ -300,11 +540,109 @@ public:
   virtual size_t local_seq_offset() const override { return local_seq_offset_; }
 
 private:
-  std::ifstream istream_;
-  utils::Deserializer des_;
-  mask_type mask_;
+  /**
+    Selects the sites of the stored sequences, which were stored with the sites of stored_mask
+    removed, that are not part of the mask to apply.
+  */
+  void select_sites(const mask_type& stored_mask, const mask_type& mask) {
+    if (stored_mask.size() != mask.size()) {
+      throw std::runtime_error{"The mask of the bfast file " + file_name_ +
+                               " differs in width from the one to apply"};
+    }
+
+    size_t stored = 0;
+    for (size_t i = 0; i < mask.size(); ++i) {
+      if (stored_mask[i]) {
+        if (not mask[i]) {
+          throw std::runtime_error{"The bfast file " + file_name_ +
+                                   " was premasked with sites that are not masked now"};
+        }
+        continue;
+      }
+      if (not mask[i]) {
+        sites_.push_back(stored);
+      }
+      ++stored;
+    }
+
+    // no need to subset if all stored sites are kept
+    if (sites_.size() == stored) {
+      sites_.clear();
+    } else {
+      width_ = stored;
+    }
+  }
+
+  /**
+    Estimates the work per sequence: the span of its valid range for version 2 files, as that
+    bounds the sites that need to be computed for it, and otherwise the size of its entry
+    according to the offset table.
+  */
+  std::vector<double> work_estimates() const {
+    std::vector<double> weights(seq_offsets_.size());
+    for (size_t i = 0; i < seq_offsets_.size(); ++i) {
+      const auto end = (i + 1 < seq_offsets_.size()) ? seq_offsets_[i + 1] : file_.size();
+      weights[i] = static_cast<double>(end - seq_offsets_[i]);
+    }
+
+    if (version_ < 2) {
+      return weights;
+    }
+
+    // <label_size><label><range begin><range span>
+    for (size_t i = 0; i < seq_offsets_.size(); ++i) {
+      uint64_t label_size;
+      uint64_t span;
+      const auto offset = seq_offsets_[i];
+      if (offset + sizeof(uint64_t) > file_.size()) {
+        break;
+      }
+      std::memcpy(&label_size, file_.data() + offset, sizeof(uint64_t));
+      const auto span_offset = offset + label_size + 2 * sizeof(uint64_t);
+      if (span_offset + sizeof(uint64_t) > file_.size()) {
+        break;
+      }
+      std::memcpy(&span, file_.data() + span_offset, sizeof(uint64_t));
+      // empty sequences still cost something
+      weights[i] = static_cast<double>(span) + 1.0;
+    }
+    return weights;
+  }
+
+  char const* get_bytes(const size_t size) {
+    if (position_ + size > file_.size()) {
+      throw std::runtime_error{"Unexpected end of bfast file: " + file_name_};
+    }
+    auto const bytes = file_.data() + position_;
+    position_ += size;
+    return bytes;
+  }
+
+  size_t get_size() {
+    uint64_t size;
+    std::memcpy(&size, get_bytes(sizeof(uint64_t)), sizeof(uint64_t));
+    return size;
+  }
+
+  std::string file_name_;
+  unsigned int version_ = 2;
+  uint64_t flags_ = 0;
+  Mapped_File file_;
+  size_t position_ = 0;
   std::vector<uint64_t> seq_offsets_;
+  // sites of the stored sequences kept by the mask, and their stored width (0 if not masking)
+  std::vector<size_t> sites_;
+  size_t width_ = 0;
   size_t num_read_ = 0;
   size_t max_read_ = std::numeric_limits<size_t>::max();
   size_t local_seq_offset_ = 0;
 };
+
+inline MSA Binary_Fasta::load(const std::string& file_name, const bool premasking) {
+  const auto info = Binary_Fasta::get_info(file_name);
+  Binary_Fasta_Reader reader(file_name, info, premasking);
+
+  MSA_Chunk chunk;
+  reader.read_next(chunk, info.sequences());
+  return chunk.to_msa();
+}
@@ -0,0 +1,271 @@
+#include "io/Gzip_Stream.hpp"
+
+#include <stdexcept>
+#include <exception>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+
+#ifdef __OMP
+#include <omp.h>
+#endif
+
+// compressed bytes read from the file at a time
+constexpr size_t READ_SIZE = 1ul << 22;
+// decompressed bytes produced at a time when decompressing sequentially
+constexpr size_t OUT_SIZE = 1ul << 20;
+
+bool is_gzip_file(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  unsigned char magic[2] = {0, 0};
+  file.read(reinterpret_cast<char*>(magic), 2);
+  return file and magic[0] == 0x1F and magic[1] == 0x8B;
+}
+
+std::unique_ptr<std::istream> open_input(const std::string& file_name, const size_t num_threads) {
+  if (file_name == "-") {
+    return std::make_unique<std::istream>(std::cin.rdbuf());
+  }
+  if (is_gzip_file(file_name)) {
+#ifdef __ZLIB
+    return std::make_unique<Gzip_Stream>(file_name, num_threads);
+#else
+    static_cast<void>(num_threads);
+    throw std::runtime_error{"Reading the compressed file " + file_name +
+                             " requires a build with zlib"};
+#endif
+  }
+  return std::make_unique<std::ifstream>(file_name, std::ios::binary);
+}
+
+#ifdef __ZLIB
+
+static uint16_t get_uint16(char const* const p) {
+  auto const b = reinterpret_cast<unsigned char const*>(p);
+  return static_cast<uint16_t>(b[0] | (b[1] << 8));
+}
+
+static uint32_t get_uint32(char const* const p) {
+  auto const b = reinterpret_cast<unsigned char const*>(p);
+  return static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8) |
+         (static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24);
+}
+
+/**
+  Returns the total size of the BGZF block at p, 0 if there is not enough data to tell, or -1 if
+  it is not a BGZF block, or one whose size cannot be right.
+*/
+static long bgzf_block_size(char const* const p, const size_t size) {
+  // <magic><method><flags><mtime><xflags><os><xlen><extra subfields...>
+  constexpr size_t HEADER = 12;
+  if (size < HEADER) {
+    return 0;
+  }
+  auto const b = reinterpret_cast<unsigned char const*>(p);
+  if (b[0] != 0x1F or b[1] != 0x8B or b[2] != 8 or not(b[3] & 4)) {
+    return -1;
+  }
+  const size_t xlen = get_uint16(p + 10);
+  if (size < HEADER + xlen) {
+    return 0;
+  }
+  // find the BC subfield holding the block size
+  for (size_t i = HEADER; i + 4 <= HEADER + xlen;) {
+    const size_t slen = get_uint16(p + i + 2);
+    if (b[i] == 'B' and b[i + 1] == 'C' and slen == 2 and i + 6 <= HEADER + xlen) {
+      const size_t block_size = get_uint16(p + i + 4) + 1ul;
+      // the block holds at least the header and the CRC32 and ISIZE trailer
+      if (block_size < HEADER + xlen + 8) {
+        return -1;
+      }
+      return static_cast<long>(block_size);
+    }
+    i += 4 + slen;
+  }
+  return -1;
+}
+
+Gzip_Streambuf::Gzip_Streambuf(const std::string& file_name, const size_t num_threads)
+    : file_name_(file_name), file_(file_name, std::ios::binary) {
+  if (not file_) {
+    throw std::runtime_error{"Cannot open file: " + file_name};
+  }
+#ifdef __OMP
+  num_threads_ = num_threads ? num_threads : omp_get_max_threads();
+#else
+  static_cast<void>(num_threads);
+  num_threads_ = 1;
+#endif
+
+  fill_input(READ_SIZE);
+  bgzf_ = bgzf_block_size(in_.data(), in_.size()) > 0;
+
+  setg(nullptr, nullptr, nullptr);
+}
+
+Gzip_Streambuf::~Gzip_Streambuf() {
+  if (zs_) {
+    inflateEnd(zs_.get());
+  }
+}
+
+/**
+  Makes sure there are at least size bytes of compressed input, unless the file ends first.
+  Returns whether there is any input left.
+*/
+bool Gzip_Streambuf::fill_input(const size_t size) {
+  if (in_pos_) {
+    in_.erase(in_.begin(), in_.begin() + in_pos_);
+    in_pos_ = 0;
+  }
+  while (in_.size() < size and file_) {
+    const auto old_size = in_.size();
+    in_.resize(std::max(size, old_size + READ_SIZE));
+    file_.read(in_.data() + old_size, in_.size() - old_size);
+    in_.resize(old_size + file_.gcount());
+  }
+  return not in_.empty();
+}
+
+void Gzip_Streambuf::fill_bgzf() {
+  // a batch of blocks per thread, blocks being at most 64KB
+  fill_input(num_threads_ * 16 * (1ul << 16));
+
+  std::vector<size_t> begin;
+  std::vector<size_t> out_offset{0};
+  size_t pos = 0;
+  while (pos < in_.size()) {
+    const auto block_size = bgzf_block_size(in_.data() + pos, in_.size() - pos);
+    if (block_size < 0) {
+      // not BGZF after all, continue sequentially from here
+      bgzf_ = false;
+      break;
+    }
+    if (block_size == 0 or pos + block_size > in_.size()) {
+      break;
+    }
+    begin.push_back(pos);
+    pos += block_size;
+    out_offset.push_back(out_offset.back() + get_uint32(in_.data() + pos - 4));
+  }
+
+  if (begin.empty() and bgzf_ and not in_.empty()) {
+    throw std::runtime_error{"Unexpected end of compressed file: " + file_name_};
+  }
+
+  out_.resize(out_offset.back());
+  std::vector<std::exception_ptr> errors(begin.size());
+
+#ifdef __OMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads_)
+#endif
+  for (size_t i = 0; i < begin.size(); ++i) {
+    try {
+      auto const block = in_.data() + begin[i];
+      const size_t end = (i + 1 < begin.size()) ? begin[i + 1] : pos;
+      const size_t header_size = 12 + get_uint16(block + 10);
+      const size_t out_size = out_offset[i + 1] - out_offset[i];
+      // such as the end of file block, which may be all there is, leaving out_ without storage
+      if (out_size == 0) {
+        continue;
+      }
+
+      z_stream zs;
+      std::memset(&zs, 0, sizeof(zs));
+      if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+        throw std::runtime_error{"Cannot initialize zlib"};
+      }
+      zs.next_in = reinterpret_cast<Bytef*>(block + header_size);
+      zs.avail_in = static_cast<uInt>(end - begin[i] - header_size - 8);
+      zs.next_out = reinterpret_cast<Bytef*>(out_.data() + out_offset[i]);
+      zs.avail_out = static_cast<uInt>(out_size);
+      const auto ret = inflate(&zs, Z_FINISH);
+      inflateEnd(&zs);
+
+      const auto crc = crc32(0L, reinterpret_cast<const Bytef*>(out_.data() + out_offset[i]),
+                             static_cast<uInt>(out_size));
+      if (ret != Z_STREAM_END or zs.avail_out != 0 or
+          crc != get_uint32(in_.data() + end - 8)) {
+        throw std::runtime_error{"Corrupt BGZF block in file: " + file_name_};
+      }
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  }
+
+  for (auto& e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+
+  in_pos_ = pos;
+}
+
+void Gzip_Streambuf::fill_gzip() {
+  if (not zs_) {
+    zs_ = std::make_unique<z_stream>();
+    std::memset(zs_.get(), 0, sizeof(z_stream));
+    // window bits plus 16 for the gzip wrapper
+    if (inflateInit2(zs_.get(), MAX_WBITS + 16) != Z_OK) {
+      throw std::runtime_error{"Cannot initialize zlib"};
+    }
+  }
+
+  out_.resize(OUT_SIZE);
+  size_t produced = 0;
+  while (produced == 0) {
+    if (in_pos_ == in_.size()) {
+      fill_input(READ_SIZE);
+    }
+    const bool no_input = (in_pos_ == in_.size());
+
+    if (stream_end_) {
+      if (no_input) {
+        break;
+      }
+      // another gzip member follows
+      inflateReset(zs_.get());
+      stream_end_ = false;
+    }
+
+    zs_->next_in = reinterpret_cast<Bytef*>(in_.data() + in_pos_);
+    zs_->avail_in = static_cast<uInt>(in_.size() - in_pos_);
+    zs_->next_out = reinterpret_cast<Bytef*>(out_.data());
+    zs_->avail_out = static_cast<uInt>(out_.size());
+
+    const auto ret = inflate(zs_.get(), Z_NO_FLUSH);
+    if (ret == Z_BUF_ERROR and no_input) {
+      throw std::runtime_error{"Unexpected end of compressed file: " + file_name_};
+    }
+    if (ret != Z_OK and ret != Z_STREAM_END and ret != Z_BUF_ERROR) {
+      throw std::runtime_error{"Corrupt compressed file: " + file_name_};
+    }
+    stream_end_ = (ret == Z_STREAM_END);
+
+    in_pos_ = in_.size() - zs_->avail_in;
+    produced = out_.size() - zs_->avail_out;
+  }
+  out_.resize(produced);
+}
+
+Gzip_Streambuf::int_type Gzip_Streambuf::underflow() {
+  while (gptr() == egptr()) {
+    if (bgzf_) {
+      if (in_pos_ == in_.size() and not fill_input(1)) {
+        return traits_type::eof();
+      }
+      fill_bgzf();
+    } else {
+      fill_gzip();
+      if (out_.empty()) {
+        return traits_type::eof();
+      }
+    }
+    setg(out_.data(), out_.data(), out_.data() + out_.size());
+  }
+  return traits_type::to_int_type(*gptr());
+}
+
+#endif
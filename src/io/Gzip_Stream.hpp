@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <istream>
+#include <streambuf>
+
+#ifdef __ZLIB
+#include <zlib.h>
+#endif
+
+/**
+  Returns true if the file starts with the gzip magic bytes.
+*/
+bool is_gzip_file(const std::string& file_name);
+
+/**
+  Opens the file for reading, transparently decompressing it if it is gzip compressed. The file
+  name "-" stands for the standard input, which is read as is.
+*/
+std::unique_ptr<std::istream> open_input(const std::string& file_name,
+                                         const size_t num_threads = 1);
+
+#ifdef __ZLIB
+
+/**
+  Stream buffer over a gzip compressed file.
+
+  BGZF files (as written by bgzip) consist of independent blocks that each carry their compressed
+  size in the gzip header, so a batch of them is decompressed in parallel. Any other gzip file,
+  or the remainder of a file once a block is found that is not BGZF, is decompressed
+  sequentially. Files of several concatenated gzip members are read as one.
+*/
+class Gzip_Streambuf : public std::streambuf {
+public:
+  Gzip_Streambuf(const std::string& file_name, const size_t num_threads);
+  ~Gzip_Streambuf();
+
+  Gzip_Streambuf(Gzip_Streambuf const& other) = delete;
+  Gzip_Streambuf& operator=(Gzip_Streambuf const& other) = delete;
+
+  bool is_bgzf() const { return bgzf_; }
+
+protected:
+  int_type underflow() override;
+
+private:
+  bool fill_input(const size_t size);
+  void fill_bgzf();
+  void fill_gzip();
+
+  std::string file_name_;
+  std::ifstream file_;
+  size_t num_threads_;
+  bool bgzf_ = false;
+  bool stream_end_ = false;
+  // compressed input that is yet to be decompressed
+  std::vector<char> in_;
+  size_t in_pos_ = 0;
+  // decompressed output, handed out via the get area
+  std::vector<char> out_;
+  std::unique_ptr<z_stream> zs_;
+};
+
+class Gzip_Stream : public std::istream {
+public:
+  Gzip_Stream(const std::string& file_name, const size_t num_threads)
+      : std::istream(nullptr), buffer_(file_name, num_threads) {
+    rdbuf(&buffer_);
+    // pass errors of the decompression on, rather than just ending the stream
+    exceptions(std::ios::badbit);
+  }
+
+  bool is_bgzf() const { return buffer_.is_bgzf(); }
+
+private:
+  Gzip_Streambuf buffer_;
+};
+
+#endif
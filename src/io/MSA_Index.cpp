@@ -0,0 +1,232 @@
+#include "io/MSA_Index.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <exception>
+#include <cstring>
+#include <cstdio>
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __OMP
+#include <omp.h>
+#endif
+
+#include "io/Mapped_File.hpp"
+#include "io/fasta_blocks.hpp"
+#include "io/Gzip_Stream.hpp"
+#include "util/logging.hpp"
+
+#include "genesis/utils/io/serializer.hpp"
+#include "genesis/utils/io/deserializer.hpp"
+
+/*
+  Layout of an index file:
+  <magic><file size><mtime seconds><mtime nanoseconds><sites><mask><num_sequences><offsets>
+*/
+constexpr char INDEX_MAGIC[] = "EPAIDX1";
+constexpr size_t INDEX_MAGIC_SIZE = sizeof(INDEX_MAGIC);
+
+using mask_type = MSA_Info::mask_type;
+
+namespace {
+struct File_Stamp {
+  uint64_t size = 0;
+  int64_t seconds = 0;
+  int64_t nanoseconds = 0;
+
+  bool operator==(File_Stamp const& other) const {
+    return size == other.size and seconds == other.seconds and
+           nanoseconds == other.nanoseconds;
+  }
+};
+}  // namespace
+
+static File_Stamp file_stamp(const std::string& file) {
+  struct stat st;
+  if (stat(file.c_str(), &st)) {
+    throw std::runtime_error{"Cannot stat file: " + file};
+  }
+  File_Stamp stamp;
+  stamp.size = static_cast<uint64_t>(st.st_size);
+  stamp.seconds = static_cast<int64_t>(st.st_mtim.tv_sec);
+  stamp.nanoseconds = static_cast<int64_t>(st.st_mtim.tv_nsec);
+  return stamp;
+}
+
+std::string index_file_name(const std::string& msa_file) { return msa_file + ".epaidx"; }
+
+bool can_index(const std::string& msa_file) {
+  return msa_file != "-" and not is_gzip_file(msa_file);
+}
+
+bool load_msa_index(const std::string& msa_file, MSA_Index& index) {
+  std::ifstream file(index_file_name(msa_file), std::ios::binary);
+  if (not file) {
+    return false;
+  }
+
+  try {
+    genesis::utils::Deserializer des(file);
+
+    char magic[INDEX_MAGIC_SIZE];
+    des.get_raw(magic, INDEX_MAGIC_SIZE);
+    if (std::memcmp(magic, INDEX_MAGIC, INDEX_MAGIC_SIZE)) {
+      return false;
+    }
+
+    File_Stamp stamp;
+    stamp.size = des.get_int<uint64_t>();
+    stamp.seconds = des.get_int<int64_t>();
+    stamp.nanoseconds = des.get_int<int64_t>();
+    if (not(stamp == file_stamp(msa_file))) {
+      LOG_DBG << "Ignoring outdated index of " << msa_file;
+      return false;
+    }
+
+    const auto sites = des.get_int<uint64_t>();
+    mask_type mask;
+    std::stringstream mask_str(des.get_string());
+    mask_str >> mask;
+
+    const auto num_sequences = des.get_int<uint64_t>();
+    index.offsets.resize(num_sequences);
+    for (auto& offset : index.offsets) {
+      offset = des.get_int<uint64_t>();
+    }
+
+    if (mask.size() != sites) {
+      return false;
+    }
+    for (size_t i = 0; i < index.offsets.size(); ++i) {
+      if (index.offsets[i] >= stamp.size or (i and index.offsets[i] <= index.offsets[i - 1])) {
+        return false;
+      }
+    }
+
+    index.info = MSA_Info(msa_file, num_sequences, mask, sites);
+  } catch (const std::exception& e) {
+    LOG_DBG << "Ignoring unreadable index of " << msa_file << ": " << e.what();
+    return false;
+  }
+  return true;
+}
+
+void save_msa_index(const std::string& msa_file, const MSA_Index& index) {
+  // written under a temporary name first, so that concurrent writers (like several MPI ranks)
+  // and readers never see a partial index
+  const auto file_name = index_file_name(msa_file);
+  const auto tmp_name = file_name + "." + std::to_string(getpid()) + ".tmp";
+
+  try {
+    const auto stamp = file_stamp(msa_file);
+    {
+      genesis::utils::Serializer ser(tmp_name);
+      ser.put_raw(INDEX_MAGIC, INDEX_MAGIC_SIZE);
+      ser.put_int<uint64_t>(stamp.size);
+      ser.put_int<int64_t>(stamp.seconds);
+      ser.put_int<int64_t>(stamp.nanoseconds);
+
+      ser.put_int<uint64_t>(index.info.sites());
+      std::stringstream ss;
+      ss << index.info.gap_mask();
+      ser.put_string(ss.str());
+
+      ser.put_int<uint64_t>(index.offsets.size());
+      for (auto const offset : index.offsets) {
+        ser.put_int<uint64_t>(offset);
+      }
+    }
+
+    if (std::rename(tmp_name.c_str(), file_name.c_str())) {
+      throw std::runtime_error{"Cannot rename " + tmp_name};
+    }
+  } catch (const std::exception& e) {
+    std::remove(tmp_name.c_str());
+    LOG_DBG << "Could not write the index of " << msa_file << ": " << e.what();
+  }
+}
+
+MSA_Index build_msa_index(const std::string& msa_file, const size_t num_threads) {
+#ifdef __OMP
+  const size_t threads = num_threads ? num_threads : omp_get_max_threads();
+#else
+  static_cast<void>(num_threads);
+  const size_t threads = 1;
+#endif
+
+  Mapped_File fasta(msa_file);
+  fasta.advise(MADV_SEQUENTIAL);
+  const auto blocks = split_fasta(fasta.data(), fasta.size(), threads * 4);
+
+  struct Block_Info {
+    std::vector<uint64_t> offsets;
+    size_t sites = 0;
+    Site_Mask gap_mask;
+    std::exception_ptr error;
+  };
+  std::vector<Block_Info> block_info(blocks.size());
+
+#ifdef __OMP
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+#endif
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    auto& block = block_info[b];
+    try {
+      parse_fasta_records(
+          fasta.data(), blocks[b], [&](size_t offset, std::string& label, std::string& sites) {
+            if (block.offsets.empty()) {
+              block.sites = sites.size();
+              block.gap_mask = Site_Mask(sites.size(), true);
+            } else if (block.sites != sites.size()) {
+              throw std::runtime_error{
+                  msa_file + " does not contain equal size sequences! First offending sequence: " +
+                  label};
+            }
+            block.offsets.push_back(offset);
+            block.gap_mask.and_gap_sites(sites);
+          });
+    } catch (...) {
+      block.error = std::current_exception();
+    }
+  }
+
+  MSA_Index index;
+  size_t sites = 0;
+  Site_Mask mask;
+  for (auto& block : block_info) {
+    if (block.error) {
+      std::rethrow_exception(block.error);
+    }
+    if (block.offsets.empty()) {
+      continue;
+    }
+    if (index.offsets.empty()) {
+      sites = block.sites;
+      mask = block.gap_mask;
+    } else if (block.sites != sites) {
+      throw std::runtime_error{msa_file + " does not contain equal size sequences!"};
+    } else {
+      mask &= block.gap_mask;
+    }
+    index.offsets.insert(index.offsets.end(), block.offsets.begin(), block.offsets.end());
+  }
+
+  index.info = MSA_Info(msa_file, index.offsets.size(), mask.to_bitvector(), sites);
+  return index;
+}
+
+MSA_Index get_msa_index(const std::string& msa_file, const size_t num_threads) {
+  MSA_Index index;
+  if (load_msa_index(msa_file, index)) {
+    LOG_DBG << "Using the index of " << msa_file;
+    return index;
+  }
+
+  index = build_msa_index(msa_file, num_threads);
+  save_msa_index(msa_file, index);
+  return index;
+}
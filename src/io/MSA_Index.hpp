@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "seq/MSA_Info.hpp"
+
+/**
+  Index of a FASTA file: its MSA_Info plus the byte offset of every record.
+
+  The index is kept in a sidecar file next to the FASTA file (<file>.epaidx), and is only used as
+  long as the FASTA file keeps the size and modification time it had when the index was built.
+  It saves later runs the pass over the file, and lets MPI ranks seek straight to their part of
+  it. Compressed files and the standard input are not indexed.
+*/
+struct MSA_Index {
+  MSA_Info info;
+  std::vector<uint64_t> offsets;
+};
+
+std::string index_file_name(const std::string& msa_file);
+bool can_index(const std::string& msa_file);
+
+// returns false if there is no valid index for the file
+bool load_msa_index(const std::string& msa_file, MSA_Index& index);
+// writing the sidecar is best effort, failing to do so is not an error
+void save_msa_index(const std::string& msa_file, const MSA_Index& index);
+MSA_Index build_msa_index(const std::string& msa_file, const size_t num_threads = 0);
+
+/**
+  Loads the index of the file, or builds and saves it if there is no valid one.
+*/
+MSA_Index get_msa_index(const std::string& msa_file, const size_t num_threads = 0);
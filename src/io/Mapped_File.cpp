@@ -0,0 +1,45 @@
+#include "io/Mapped_File.hpp"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Mapped_File::Mapped_File(const std::string& file_path) : path_(file_path) {
+  const int fd = open(file_path.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd < 0 or fstat(fd, &info) != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    throw std::runtime_error{"Could not open file for reading: " + file_path};
+  }
+
+  size_ = info.st_size;
+  if (size_ == 0) {
+    close(fd);
+    return;
+  }
+
+  auto const base = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (base == MAP_FAILED) {
+    throw std::runtime_error{"Could not map file: " + file_path};
+  }
+  data_ = static_cast<char*>(base);
+}
+
+Mapped_File::~Mapped_File() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+}
+
+void Mapped_File::advise(const int advice) const {
+  if (data_) {
+    madvise(data_, size_, advice);
+  }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+/**
+  Read-only memory mapping of a whole file. Empty files map to no data at all.
+*/
+class Mapped_File {
+public:
+  explicit Mapped_File(const std::string& file_path);
+  ~Mapped_File();
+
+  Mapped_File(Mapped_File const& other) = delete;
+  Mapped_File& operator=(Mapped_File const& other) = delete;
+
+  char const* data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::string& path() const { return path_; }
+
+  // passes the access pattern hint (MADV_*) on to the kernel
+  void advise(const int advice) const;
+
+private:
+  std::string path_;
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
@@ -0,0 +1,230 @@
+#include "io/Placement_Cache.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io/Mapped_File.hpp"
+#include "util/logging.hpp"
+
+constexpr char CACHE_MAGIC[8] = {'E', 'P', 'A', 'P', 'C', 'C', '1', '\0'};
+constexpr size_t CACHE_MAGIC_SIZE = sizeof(CACHE_MAGIC);
+constexpr size_t ENTRY_HEAD_WORDS = 5;
+constexpr size_t PLACEMENT_WORDS = 5;
+
+static uint64_t to_word(const double value) {
+  uint64_t word;
+  std::memcpy(&word, &value, sizeof(word));
+  return word;
+}
+
+static double to_double(const uint64_t word) {
+  double value;
+  std::memcpy(&value, &word, sizeof(value));
+  return value;
+}
+
+/**
+  Goes through the complete entries in the words, calling fn for those of the key (if there is a
+  fn). Returns the number of words they span.
+*/
+static size_t scan_entries(uint64_t const* const words, const size_t num_words,
+                           const Sequence_Hash& key, const Placement_Cache::fn_type* fn,
+                           size_t& num_entries) {
+  size_t pos = 0;
+  std::vector<Placement> placements;
+  while (num_words - pos >= ENTRY_HEAD_WORDS) {
+    auto const entry = words + pos;
+    const auto num_placements = entry[4];
+    if (num_placements > (num_words - pos - ENTRY_HEAD_WORDS) / PLACEMENT_WORDS) {
+      break;
+    }
+    const size_t entry_words = ENTRY_HEAD_WORDS + num_placements * PLACEMENT_WORDS;
+
+    if (fn and entry[0] == key.first and entry[1] == key.second) {
+      Sequence_Hash hash;
+      hash.first = entry[2];
+      hash.second = entry[3];
+
+      placements.clear();
+      for (size_t i = 0; i < num_placements; ++i) {
+        auto const p = entry + ENTRY_HEAD_WORDS + i * PLACEMENT_WORDS;
+        placements.emplace_back(p[0], to_double(p[1]), to_double(p[3]), to_double(p[4]));
+        placements.back().lwr(to_double(p[2]));
+      }
+      (*fn)(hash, placements);
+      ++num_entries;
+    }
+    pos += entry_words;
+  }
+  return pos;
+}
+
+namespace {
+// closing the descriptor also releases the lock
+struct Locked_File {
+  int fd = -1;
+  ~Locked_File() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+};
+}  // namespace
+
+static bool lock_file(const int fd, const int operation) {
+  while (flock(fd, operation)) {
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Placement_Cache::Placement_Cache(std::string file_path, const Sequence_Hash& key)
+    : path_(std::move(file_path)), key_(key) {}
+
+size_t Placement_Cache::load(const fn_type& fn) {
+  checked_size_ = 0;
+
+  // the shared lock keeps writers from cutting off the end of the file while it is mapped
+  Locked_File lock;
+  lock.fd = open(path_.c_str(), O_RDONLY);
+  if (lock.fd < 0) {
+    if (errno == ENOENT) {
+      return 0;
+    }
+    throw std::runtime_error{"Cannot open the placement cache " + path_ + ": " +
+                             std::strerror(errno)};
+  }
+  if (not lock_file(lock.fd, LOCK_SH)) {
+    throw std::runtime_error{"Cannot lock the placement cache " + path_};
+  }
+
+  Mapped_File file(path_);
+  if (file.size() == 0) {
+    return 0;
+  }
+  if (file.size() < CACHE_MAGIC_SIZE or std::memcmp(file.data(), CACHE_MAGIC, CACHE_MAGIC_SIZE)) {
+    throw std::runtime_error{"Not a placement cache file: " + path_};
+  }
+
+  // the mapping is page aligned, so the words can be read in place
+  auto const words = reinterpret_cast<uint64_t const*>(file.data() + CACHE_MAGIC_SIZE);
+  const auto num_words = (file.size() - CACHE_MAGIC_SIZE) / sizeof(uint64_t);
+
+  size_t num_entries = 0;
+  const auto valid_words = scan_entries(words, num_words, key_, &fn, num_entries);
+  checked_size_ = CACHE_MAGIC_SIZE + valid_words * sizeof(uint64_t);
+  if (checked_size_ != file.size()) {
+    LOG_DBG << "Ignoring the incomplete entry at the end of " << path_;
+  }
+  return num_entries;
+}
+
+void Placement_Cache::add(const Sequence_Hash& hash, const std::vector<Placement>& placements) {
+  buffer_.push_back(key_.first);
+  buffer_.push_back(key_.second);
+  buffer_.push_back(hash.first);
+  buffer_.push_back(hash.second);
+  buffer_.push_back(placements.size());
+  for (auto const& p : placements) {
+    buffer_.push_back(p.branch_id());
+    buffer_.push_back(to_word(p.likelihood()));
+    buffer_.push_back(to_word(p.lwr()));
+    buffer_.push_back(to_word(p.pendant_length()));
+    buffer_.push_back(to_word(p.distal_length()));
+  }
+}
+
+static void write_all(const int fd, char const* data, size_t size) {
+  while (size) {
+    const auto written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error{std::strerror(errno)};
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+}
+
+void Placement_Cache::flush() {
+  if (buffer_.empty()) {
+    return;
+  }
+
+  uint64_t valid_size = 0;
+  Locked_File file;
+  try {
+    file.fd = open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (file.fd < 0) {
+      throw std::runtime_error{"cannot open the file"};
+    }
+    if (not lock_file(file.fd, LOCK_EX)) {
+      throw std::runtime_error{"cannot lock the file"};
+    }
+
+    struct stat info;
+    if (fstat(file.fd, &info)) {
+      throw std::runtime_error{"cannot stat the file"};
+    }
+    const auto size = static_cast<uint64_t>(info.st_size);
+
+    // check what other processes appended since, which also finds any incomplete entry left
+    // behind by a crashed run
+    if (size < checked_size_) {
+      checked_size_ = 0;
+    }
+    valid_size = checked_size_;
+    if (size and not valid_size) {
+      char magic[CACHE_MAGIC_SIZE] = {};
+      if (pread(file.fd, magic, CACHE_MAGIC_SIZE, 0) != CACHE_MAGIC_SIZE or
+          std::memcmp(magic, CACHE_MAGIC, CACHE_MAGIC_SIZE)) {
+        throw std::runtime_error{"not a placement cache file"};
+      }
+      valid_size = CACHE_MAGIC_SIZE;
+    }
+    if (size > valid_size) {
+      std::vector<uint64_t> words((size - valid_size) / sizeof(uint64_t));
+      const auto bytes = words.size() * sizeof(uint64_t);
+      if (pread(file.fd, words.data(), bytes, valid_size) != static_cast<ssize_t>(bytes)) {
+        throw std::runtime_error{"cannot read the file"};
+      }
+      size_t num_entries = 0;
+      valid_size += scan_entries(words.data(), words.size(), key_, nullptr, num_entries) *
+                    sizeof(uint64_t);
+      if (valid_size != size) {
+        LOG_DBG << "Cutting off the incomplete entry at the end of " << path_;
+        if (ftruncate(file.fd, valid_size)) {
+          throw std::runtime_error{"cannot truncate the file"};
+        }
+      }
+    }
+
+    if (not valid_size) {
+      write_all(file.fd, CACHE_MAGIC, CACHE_MAGIC_SIZE);
+      valid_size = CACHE_MAGIC_SIZE;
+    }
+    try {
+      write_all(file.fd, reinterpret_cast<char const*>(buffer_.data()),
+                buffer_.size() * sizeof(uint64_t));
+    } catch (...) {
+      // leave no partial entry behind
+      static_cast<void>(ftruncate(file.fd, valid_size));
+      throw;
+    }
+    checked_size_ = valid_size + buffer_.size() * sizeof(uint64_t);
+  } catch (const std::exception& e) {
+    // the results are in the output regardless, so this is not fatal
+    LOG_WARN << "Could not write to the placement cache " << path_ << ": " << e.what();
+  }
+  buffer_.clear();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "seq/Sequence_Hash.hpp"
+#include "sample/Placement.hpp"
+
+/**
+  On-disk cache of the final (filtered) placements of query sequences, shared across runs.
+
+  Entries are addressed by the key of the run, which covers the reference, the model and every
+  option that influences the placements, together with the hash of the masked query sequence. A
+  single file may hold the entries of any number of different keys.
+
+  The file is a sequence of 64 bit words in the byte order of the machine, so it can be read in
+  place from a mapping: after the magic, each entry is
+    <key (2)><sequence hash (2)><num placements (1)><num placements x (branch id, likelihood, lwr,
+    pendant length, distal length)>
+  New entries are only ever appended, under an exclusive lock of the file and with one write per
+  batch, so any number of processes can use the same cache at the same time. An incomplete entry
+  at the end of the file (for example from a crashed run) is ignored by readers, and cut off by the
+  next writer.
+*/
+class Placement_Cache {
+public:
+  using fn_type = std::function<void(const Sequence_Hash&, std::vector<Placement>&)>;
+
+  Placement_Cache(std::string file_path, const Sequence_Hash& key);
+  ~Placement_Cache() = default;
+
+  Placement_Cache(Placement_Cache const& other) = delete;
+  Placement_Cache& operator=(Placement_Cache const& other) = delete;
+
+  /**
+    Calls fn with every cached entry of the key, and returns their number. A missing file is an
+    empty cache. The file is read under a shared lock, so writers wait until load returns.
+  */
+  size_t load(const fn_type& fn);
+
+  // buffers an entry, to be written by the next flush
+  void add(const Sequence_Hash& hash, const std::vector<Placement>& placements);
+  // appends the buffered entries to the file
+  void flush();
+
+  const std::string& path() const { return path_; }
+  const Sequence_Hash& key() const { return key_; }
+
+private:
+  std::string path_;
+  Sequence_Hash key_;
+  // how much of the file is known to consist of complete entries
+  uint64_t checked_size_ = 0;
+  std::vector<uint64_t> buffer_;
+};
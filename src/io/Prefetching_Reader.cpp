@@ -0,0 +1,98 @@
+#include "io/Prefetching_Reader.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+Prefetching_Reader::Prefetching_Reader(std::unique_ptr<msa_reader> reader,
+                                       const size_t max_chunks, const size_t max_bytes)
+    : reader_(std::move(reader)), max_chunks_(std::max(size_t{1}, max_chunks)),
+      max_bytes_(max_bytes) {
+  if (not reader_) {
+    throw std::runtime_error{"Prefetching_Reader needs a reader to read from"};
+  }
+}
+
+Prefetching_Reader::~Prefetching_Reader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  not_full_.notify_all();
+
+  // avoid dangling threads
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void Prefetching_Reader::fill() {
+  try {
+    while (true) {
+      Chunk chunk;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] {
+          const bool full = queue_.size() >= max_chunks_ or
+                            (max_bytes_ and queued_bytes_ >= max_bytes_ and not queue_.empty());
+          return stop_ or not full;
+        });
+        if (stop_) {
+          return;
+        }
+        if (not spare_.empty()) {
+          std::swap(chunk.msa, spare_.back());
+          spare_.pop_back();
+        }
+      }
+
+      // the actual reading happens without holding the lock
+      const auto num_read = reader_->read_next(chunk.msa, chunk_size_);
+      chunk.bytes = chunk.msa.bytes();
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (num_read == 0) {
+        done_ = true;
+        not_empty_.notify_one();
+        return;
+      }
+      queued_bytes_ += chunk.bytes;
+      queue_.push_back(std::move(chunk));
+      not_empty_.notify_one();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    error_ = std::current_exception();
+    done_ = true;
+    not_empty_.notify_one();
+  }
+}
+
+size_t Prefetching_Reader::read_next(MSA_Chunk& result, const size_t number) {
+  if (not thread_.joinable()) {
+    chunk_size_ = number;
+    thread_ = std::thread(&Prefetching_Reader::fill, this);
+  } else if (number != chunk_size_) {
+    throw std::runtime_error{"Prefetching_Reader cannot change the chunk size while reading"};
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  not_empty_.wait(lock, [this] { return done_ or not queue_.empty(); });
+
+  if (queue_.empty()) {
+    result.clear();
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    return 0;
+  }
+
+  std::swap(result, queue_.front().msa);
+  queued_bytes_ -= queue_.front().bytes;
+  // the previous chunk of the caller
+  spare_.push_back(std::move(queue_.front().msa));
+  queue_.pop_front();
+  lock.unlock();
+  not_full_.notify_one();
+
+  return result.size();
+}
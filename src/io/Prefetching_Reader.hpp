@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "io/msa_reader_interface.hpp"
+#include "seq/MSA_Chunk.hpp"
+
+/**
+  Reads chunks ahead of time on a background thread, on top of any other reader.
+
+  Up to max_chunks chunks are kept in a queue. The reader thread stops reading ahead while the
+  queue is full or, given a memory cap, while the queued chunks take up more than max_bytes, so
+  that slow reads are absorbed by the queue without it growing without bounds. A single chunk is
+  always let through, regardless of the memory cap.
+
+  The chunk size is set by the first call to read_next and may not change afterwards. The chunks
+  handed back through read_next are reused for reading ahead, keeping their storage.
+*/
+class Prefetching_Reader : public msa_reader {
+public:
+  Prefetching_Reader(std::unique_ptr<msa_reader> reader, const size_t max_chunks,
+                     const size_t max_bytes = 0);
+  ~Prefetching_Reader();
+
+  Prefetching_Reader(Prefetching_Reader const& other) = delete;
+  Prefetching_Reader& operator=(Prefetching_Reader const& other) = delete;
+
+  size_t num_sequences() const override { return reader_->num_sequences(); }
+  size_t local_seq_offset() const override { return reader_->local_seq_offset(); }
+  size_t read_next(MSA_Chunk& result, const size_t number) override;
+
+private:
+  void fill();
+
+  struct Chunk {
+    MSA_Chunk msa;
+    size_t bytes = 0;
+  };
+
+  std::unique_ptr<msa_reader> reader_;
+  size_t max_chunks_;
+  size_t max_bytes_;
+  size_t chunk_size_ = 0;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<Chunk> queue_;
+  std::vector<MSA_Chunk> spare_;
+  size_t queued_bytes_ = 0;
+  bool done_ = false;
+  bool stop_ = false;
+  std::exception_ptr error_;
+};
@@ -0,0 +1,203 @@
+#include "io/encoding.hpp"
+
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define EPA_FOURBIT_X86
+#include <immintrin.h>
+#endif
+
+/*
+  Vectorized 4 bit packing and unpacking. Both directions boil down to byte shuffles: unpacking
+  looks the nibbles up in NT_MAP, packing looks the (case folded) characters up in two tables
+  indexed by their low nibble, one for 0x6_ and one for 0x7_ characters.
+
+  The kernels are compiled for SSSE3 and AVX2 via target attributes, so no special compiler flags
+  are needed, and are chosen once at runtime according to what the CPU supports.
+*/
+
+#ifdef EPA_FOURBIT_X86
+
+static constexpr char INVALID = static_cast<char>(0xFF);
+
+// codes of the lowercase letters 0x60 - 0x6F and 0x70 - 0x7F, INVALID for those not in NT_MAP
+// clang-format off
+static const char LOWER_6[16] = {
+  INVALID, 8,  7, 4, 11, INVALID, INVALID, 2,
+  13, INVALID, INVALID, 3, INVALID, 12, 15, INVALID};
+static const char LOWER_7[16] = {
+  INVALID, INVALID, 10, 6, 1, INVALID, 14, 9,
+  INVALID, 5, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID};
+// clang-format on
+
+__attribute__((target("ssse3"))) static inline __m128i codes_ssse3(const __m128i chars) {
+  const auto nibble = _mm_set1_epi8(0x0F);
+  const auto lo = _mm_and_si128(chars, nibble);
+  const auto hi = _mm_and_si128(_mm_srli_epi16(chars, 4), nibble);
+
+  const auto lower_6 =
+      _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(LOWER_6)), lo);
+  const auto lower_7 =
+      _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(LOWER_7)), lo);
+
+  // 0x4_ to 0x7_ are letters, odd high nibbles select the second table
+  const auto letter = _mm_cmpeq_epi8(_mm_and_si128(hi, _mm_set1_epi8(0x0C)), _mm_set1_epi8(0x04));
+  const auto odd = _mm_cmpeq_epi8(_mm_and_si128(hi, _mm_set1_epi8(0x01)), _mm_set1_epi8(0x01));
+  const auto dash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('-'));
+
+  const auto code = _mm_or_si128(_mm_and_si128(odd, lower_7), _mm_andnot_si128(odd, lower_6));
+  // the dash is code 0, anything else that is not a letter is invalid
+  return _mm_or_si128(_mm_and_si128(letter, code),
+                      _mm_andnot_si128(_mm_or_si128(letter, dash), _mm_set1_epi8(INVALID)));
+}
+
+__attribute__((target("ssse3"))) static size_t pack_ssse3(char const* const s, const size_t n,
+                                                          char* const out) {
+  // combines every pair of codes into (first << 4) | second
+  const auto weights = _mm_set1_epi16(0x0110);
+  const auto invalid = _mm_set1_epi8(INVALID);
+
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const auto first = codes_ssse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+    const auto second = codes_ssse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 16)));
+
+    if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(first, invalid),
+                                       _mm_cmpeq_epi8(second, invalid)))) {
+      break;
+    }
+
+    const auto packed = _mm_packus_epi16(_mm_maddubs_epi16(first, weights),
+                                         _mm_maddubs_epi16(second, weights));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i / 2), packed);
+  }
+  return i;
+}
+
+__attribute__((target("ssse3"))) static size_t unpack_ssse3(char const* const s, const size_t n,
+                                                            char* const out) {
+  const auto map = _mm_loadu_si128(reinterpret_cast<const __m128i*>(NT_MAP));
+  const auto nibble = _mm_set1_epi8(0x0F);
+
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const auto packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i / 2));
+    const auto first = _mm_shuffle_epi8(map, _mm_and_si128(_mm_srli_epi16(packed, 4), nibble));
+    const auto second = _mm_shuffle_epi8(map, _mm_and_si128(packed, nibble));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi8(first, second));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 16), _mm_unpackhi_epi8(first, second));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) static inline __m256i codes_avx2(const __m256i chars) {
+  const auto nibble = _mm256_set1_epi8(0x0F);
+  const auto lo = _mm256_and_si256(chars, nibble);
+  const auto hi = _mm256_and_si256(_mm256_srli_epi16(chars, 4), nibble);
+
+  const auto lower_6 = _mm256_shuffle_epi8(
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(LOWER_6))), lo);
+  const auto lower_7 = _mm256_shuffle_epi8(
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(LOWER_7))), lo);
+
+  const auto letter =
+      _mm256_cmpeq_epi8(_mm256_and_si256(hi, _mm256_set1_epi8(0x0C)), _mm256_set1_epi8(0x04));
+  const auto odd =
+      _mm256_cmpeq_epi8(_mm256_and_si256(hi, _mm256_set1_epi8(0x01)), _mm256_set1_epi8(0x01));
+  const auto dash = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('-'));
+
+  const auto code = _mm256_blendv_epi8(lower_6, lower_7, odd);
+  return _mm256_or_si256(
+      _mm256_and_si256(letter, code),
+      _mm256_andnot_si256(_mm256_or_si256(letter, dash), _mm256_set1_epi8(INVALID)));
+}
+
+__attribute__((target("avx2"))) static size_t pack_avx2(char const* const s, const size_t n,
+                                                        char* const out) {
+  const auto weights = _mm256_set1_epi16(0x0110);
+  const auto invalid = _mm256_set1_epi8(INVALID);
+
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    const auto first = codes_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i)));
+    const auto second =
+        codes_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 32)));
+
+    if (_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(first, invalid),
+                                             _mm256_cmpeq_epi8(second, invalid)))) {
+      break;
+    }
+
+    // packus works per 128 bit lane, so the 64 bit quarters need to be put back in order
+    const auto packed = _mm256_packus_epi16(_mm256_maddubs_epi16(first, weights),
+                                            _mm256_maddubs_epi16(second, weights));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i / 2),
+                        _mm256_permute4x64_epi64(packed, 0xD8));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) static size_t unpack_avx2(char const* const s, const size_t n,
+                                                          char* const out) {
+  const auto map =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(NT_MAP)));
+  const auto nibble = _mm256_set1_epi8(0x0F);
+
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    const auto packed = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i / 2));
+    const auto first =
+        _mm256_shuffle_epi8(map, _mm256_and_si256(_mm256_srli_epi16(packed, 4), nibble));
+    const auto second = _mm256_shuffle_epi8(map, _mm256_and_si256(packed, nibble));
+
+    // unpack works per 128 bit lane as well
+    const auto low = _mm256_unpacklo_epi8(first, second);
+    const auto high = _mm256_unpackhi_epi8(first, second);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        _mm256_permute2x128_si256(low, high, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 32),
+                        _mm256_permute2x128_si256(low, high, 0x31));
+  }
+  return i;
+}
+
+#endif
+
+static size_t none(char const* const, const size_t, char* const) { return 0; }
+
+using kernel_type = size_t (*)(char const* const, const size_t, char* const);
+
+static kernel_type select_pack() {
+#ifdef EPA_FOURBIT_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return pack_avx2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return pack_ssse3;
+  }
+#endif
+  return none;
+}
+
+static kernel_type select_unpack() {
+#ifdef EPA_FOURBIT_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return unpack_avx2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return unpack_ssse3;
+  }
+#endif
+  return none;
+}
+
+size_t fourbit_pack_blocks(char const* const s, const size_t n, char* const out) {
+  static const auto kernel = select_pack();
+  return kernel(s, n, out);
+}
+
+size_t fourbit_unpack_blocks(char const* const s, const size_t n, char* const out) {
+  static const auto kernel = select_unpack();
+  return kernel(s, n, out);
+}
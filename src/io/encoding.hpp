@@ -3,11 +3,24 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <cctype>
+#include <stdexcept>
 #include <array>
+#include <string>
+#include <vector>
 
 #include "util/Matrix.hpp"
 #include "util/maps.hpp"
 
+/*
+  Vectorized kernels for FourBit, defined in encoding.cpp. They only handle whole blocks of
+  characters and return how many they handled, leaving the rest to the scalar code. Packing also
+  stops at the first block containing a character outside of NT_MAP.
+*/
+size_t fourbit_pack_blocks(char const* const s, const size_t n, char* const out);
+size_t fourbit_unpack_blocks(char const* const s, const size_t n, char* const out);
+
 class FourBit {
   // shorthand
   using uchar = unsigned char;
@@ -26,14 +39,25 @@ private:
     return {(c & upper_mask) >> 4, c & lower_mask};
   }
 
+  // every code is a valid pair, so characters outside of NT_MAP have to be caught beforehand
+  inline void check_(const char c) const {
+    if (not valid(c)) {
+      throw std::runtime_error{std::string("Character not supported for the 4 bit encoding: ") +
+                               c};
+    }
+  }
+
 public:
   FourBit() : to_fourbit_(128, 128) {
     static_assert(NT_MAP_SIZE == 16, "Weird NT map size, go adjust encoder code!");
 
     // both chars are valid characters:
     const auto map_size = static_cast<uchar>(NT_MAP_SIZE);
+    valid_.fill(false);
     for (uchar i = 0; i < map_size; ++i) {
       assert(NT_MAP[i] == std::toupper(NT_MAP[i]));
+      valid_[NT_MAP[i]] = true;
+      valid_[std::tolower(NT_MAP[i])] = true;
       for (uchar j = 0; j < map_size; ++j) {
         uchar packed_char = pack_(i, j);
 
@@ -75,60 +99,151 @@ public:
   }
   ~FourBit() = default;
 
-  inline size_t packed_size(const size_t size) { return std::ceil(size / 2.0); }
+  inline size_t packed_size(const size_t size) const { return std::ceil(size / 2.0); }
+
+  bool valid(const char c) const { return valid_[static_cast<uchar>(c)]; }
 
   // conversion functions
   inline std::basic_string<char> to_fourbit(const std::string& s) {
-    const size_t p_size = packed_size(s.size());
-    std::basic_string<char> res;
-    res.reserve(p_size);
+    static constexpr size_t SCALAR_RUN = 64;
+    std::basic_string<char> res(packed_size(s.size()), '\0');
 
+    const size_t pairs_end = s.size() - (s.size() % 2);
     size_t i = 0;
-    for (; i + 1 < s.size(); i += 2) {
-      res.push_back(to_fourbit_.at(s[i], s[i + 1u]));
+    while (i < pairs_end) {
+      i += fourbit_pack_blocks(&s[i], pairs_end - i, &res[i / 2]);
+
+      // whatever the kernel left: the tail, or a block with characters it does not know
+      const size_t run_end = std::min(pairs_end, i + SCALAR_RUN);
+      for (; i < run_end; i += 2) {
+        check_(s[i]);
+        check_(s[i + 1u]);
+        res[i / 2] = to_fourbit_.at(s[i], s[i + 1u]);
+      }
     }
 
     // original string size not divisible by 2: trailing padding
     if (i < s.size()) {
-      res.push_back(to_fourbit_.at(s[i], NONE_CHAR));
+      check_(s[i]);
+      res[i / 2] = to_fourbit_.at(s[i], NONE_CHAR);
     }
 
     return res;
   }
 
-  std::string from_fourbit(const std::basic_string<char>& s, const size_t n) {
+  std::string from_fourbit(const std::basic_string<char>& s, const size_t n) const {
     assert(s.size() > 0);
     assert(n > 0);
+    assert(s.size() == packed_size(n));
 
-    // prepare the result string
-    std::string res;
-    res.resize(n);
+    std::string res(n, '\0');
+    from_fourbit(s.data(), n, &res[0]);
 
-    // determine whether the packed string has padding
-    const bool padded = (n % 2 == 1);
+    return res;
+  }
 
-    // unpack
-    size_t i = 0;
-    for (; i < s.size() - 1u; ++i) {
-      reinterpret_cast<char16_t*>(&res[0])[i] = from_fourbit_[static_cast<uchar>(s[i])];
+  // unpacks n characters from the packed buffer s into out, which must hold n characters
+  void from_fourbit(char const* const s, const size_t n, char* const out) const {
+    const size_t pairs = n / 2;
+    for (size_t i = fourbit_unpack_blocks(s, n - (n % 2), out) / 2; i < pairs; ++i) {
+      std::memcpy(out + i * 2, &from_fourbit_[static_cast<uchar>(s[i])], sizeof(char16_t));
     }
 
-    // last element is special
-    auto char_pair = unpack_(static_cast<uchar>(s[i]));
-    res[i * 2] = NT_MAP[char_pair.first];
+    // last element is special if the packed string has padding
+    if (n % 2 == 1) {
+      out[n - 1] = NT_MAP[unpack_(static_cast<uchar>(s[pairs])).first];
+    }
+  }
 
-    if (not padded) {
-      res[i * 2 + 1] = NT_MAP[char_pair.second];
-    } else {
-      assert(NT_MAP[char_pair.second] == NONE_CHAR);
+  // unpacks only the characters at the given (ascending) sites, which amounts to masking
+  void from_fourbit(char const* const s, const std::vector<size_t>& sites, char* const out) const {
+    for (size_t k = 0; k < sites.size(); ++k) {
+      const auto char_pair = unpack_(static_cast<uchar>(s[sites[k] / 2]));
+      out[k] = NT_MAP[sites[k] % 2 ? char_pair.second : char_pair.first];
     }
+  }
+
+private:
+  Matrix<char> to_fourbit_;
+  std::array<char16_t, 256> from_fourbit_;
+  std::array<bool, 256> valid_;
+};
 
-    assert(res.size() == n);
+/**
+  Packs amino acid characters (AA_MAP, case insensitive) into 5 bit codes, eight characters to
+  five bytes. Character i occupies bits 5i to 5i+4 of the packed buffer, lowest bits first.
+*/
+class FiveBit {
+  using uchar = unsigned char;
 
+private:
+  static constexpr uchar INVALID = 0xFF;
+
+  static inline uchar code_at_(char const* const s, const size_t i) {
+    const size_t bit = i * 5;
+    const size_t shift = bit % 8;
+    unsigned int bits = static_cast<uchar>(s[bit / 8]);
+    // only touch the next byte if the code reaches into it
+    if (shift > 3) {
+      bits |= static_cast<unsigned int>(static_cast<uchar>(s[bit / 8 + 1])) << 8;
+    }
+    return (bits >> shift) & 0x1F;
+  }
+
+public:
+  FiveBit() {
+    static_assert(AA_MAP_SIZE <= 32, "AA map does not fit into 5 bits, go adjust encoder code!");
+
+    to_fivebit_.fill(uchar{INVALID});
+    // codes that are never written decode to the undetermined character
+    from_fivebit_.fill('X');
+    for (uchar i = 0; i < AA_MAP_SIZE; ++i) {
+      to_fivebit_[AA_MAP[i]] = i;
+      to_fivebit_[std::tolower(AA_MAP[i])] = i;
+      from_fivebit_[i] = AA_MAP[i];
+    }
+  }
+  ~FiveBit() = default;
+
+  inline size_t packed_size(const size_t size) const { return (size * 5 + 7) / 8; }
+
+  bool valid(const char c) const { return to_fivebit_[static_cast<uchar>(c)] != INVALID; }
+
+  std::basic_string<char> to_fivebit(const std::string& s) const {
+    std::basic_string<char> res(packed_size(s.size()), '\0');
+
+    for (size_t i = 0; i < s.size(); ++i) {
+      const unsigned int code = to_fivebit_[static_cast<uchar>(s[i])];
+      if (code == INVALID) {
+        throw std::runtime_error{std::string("Character not supported for the 5 bit encoding: ") +
+                                 s[i]};
+      }
+
+      const size_t bit = i * 5;
+      const size_t shift = bit % 8;
+      res[bit / 8] |= static_cast<char>(code << shift);
+      if (shift > 3) {
+        res[bit / 8 + 1] |= static_cast<char>(code >> (8 - shift));
+      }
+    }
     return res;
   }
 
+  // unpacks n characters from the packed buffer s into out, which must hold n characters
+  void from_fivebit(char const* const s, const size_t n, char* const out) const {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = from_fivebit_[code_at_(s, i)];
+    }
+  }
+
+  // unpacks only the characters at the given (ascending) sites
+  void from_fivebit(char const* const s, const std::vector<size_t>& sites, char* const out) const {
+    for (size_t k = 0; k < sites.size(); ++k) {
+      out[k] = from_fivebit_[code_at_(s, sites[k])];
+    }
+  }
+
 private:
-  Matrix<char> to_fourbit_;
-  std::array<char16_t, 256> from_fourbit_;
+  std::array<uchar, 256> to_fivebit_;
+  std::array<char, 32> from_fivebit_;
 };
@@ -0,0 +1,104 @@
+#include "io/fasta_blocks.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+
+static bool is_space(const char c) {
+  return c == '\n' or c == '\r' or c == ' ' or c == '\t';
+}
+
+std::vector<Byte_Range> split_fasta(char const* const data, const size_t size,
+                                    const size_t num_blocks) {
+  std::vector<Byte_Range> blocks;
+
+  size_t begin = 0;
+  for (size_t i = 1; i <= num_blocks and begin < size; ++i) {
+    size_t end = size;
+    if (i < num_blocks) {
+      // the next record starting at or after the even split point
+      end = std::max(begin + 1, size / num_blocks * i);
+      while (end < size and not (data[end] == '>' and data[end - 1] == '\n')) {
+        auto const next = static_cast<char const*>(std::memchr(data + end, '\n', size - end));
+        end = next ? next - data + 1 : size;
+      }
+    }
+    blocks.emplace_back(begin, end);
+    begin = end;
+  }
+
+  return blocks;
+}
+
+void parse_fasta_block(char const* const data, const Byte_Range range,
+                       const std::function<void(std::string&, std::string&)>& fn) {
+  parse_fasta_records(data, range, [&fn](size_t, std::string& label, std::string& sites) {
+    fn(label, sites);
+  });
+}
+
+void parse_fasta_records(char const* const data, const Byte_Range range,
+                         const std::function<void(size_t, std::string&, std::string&)>& fn) {
+  std::string label;
+  std::string sites;
+
+  size_t pos = range.first;
+  // skip leading empty lines
+  while (pos < range.second and is_space(data[pos])) {
+    ++pos;
+  }
+
+  while (pos < range.second) {
+    if (data[pos] != '>') {
+      throw std::runtime_error{"Malformed FASTA: expected '>' at byte " + std::to_string(pos)};
+    }
+
+    // the label is the rest of the line
+    const size_t record_begin = pos;
+    const size_t label_begin = pos + 1;
+    auto const line_end =
+        static_cast<char const*>(std::memchr(data + pos, '\n', range.second - pos));
+    size_t label_end = line_end ? line_end - data : range.second;
+    pos = line_end ? label_end + 1 : range.second;
+    while (label_end > label_begin and data[label_end - 1] == '\r') {
+      --label_end;
+    }
+    label.assign(data + label_begin, label_end - label_begin);
+    sites.clear();
+
+    // the sites are all lines up to the next record
+    while (pos < range.second and data[pos] != '>') {
+      auto const next = static_cast<char const*>(std::memchr(data + pos, '\n', range.second - pos));
+      auto const first = data + pos;
+      auto const last = next ? next : data + range.second;
+      if (std::find_if(first, last, is_space) == last) {
+        sites.append(first, last);
+      } else {
+        std::copy_if(first, last, std::back_inserter(sites), [](const char c) {
+          return not is_space(c);
+        });
+      }
+      pos = next ? next - data + 1 : range.second;
+    }
+
+    fn(record_begin, label, sites);
+  }
+}
+
+size_t count_fasta_records(std::istream& in) {
+  std::vector<char> buffer(1ul << 20);
+  size_t count = 0;
+  // whether the next byte starts a line
+  bool line_start = true;
+  while (in.read(buffer.data(), buffer.size()) or in.gcount()) {
+    const auto size = static_cast<size_t>(in.gcount());
+    for (size_t i = 0; i < size; ++i) {
+      if (buffer[i] == '>' and line_start) {
+        ++count;
+      }
+      line_start = (buffer[i] == '\n');
+    }
+  }
+  return count;
+}
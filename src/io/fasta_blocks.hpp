@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <istream>
+
+/*
+  Helpers to parse an in-memory FASTA file in independent blocks, so that several threads can
+  work on it at once.
+*/
+
+// [begin, end) byte offsets of a block of whole records
+using Byte_Range = std::pair<size_t, size_t>;
+
+/**
+  Splits the data into up to num_blocks ranges of roughly equal size, each starting at a record
+  (a '>' at the beginning of a line). Ranges are in file order and cover all of the data.
+*/
+std::vector<Byte_Range> split_fasta(char const* const data, const size_t size,
+                                    const size_t num_blocks);
+
+/**
+  Calls fn(label, sites) for every record of the range, in order. The sites have all whitespace
+  removed. Both strings are reused for the next record, so fn may move from them.
+*/
+void parse_fasta_block(char const* const data, const Byte_Range range,
+                       const std::function<void(std::string&, std::string&)>& fn);
+
+/**
+  Like parse_fasta_block, but also passes the byte offset of the '>' of every record.
+*/
+void parse_fasta_records(char const* const data, const Byte_Range range,
+                         const std::function<void(size_t, std::string&, std::string&)>& fn);
+
+/**
+  Counts the records of the FASTA input without parsing them, reading it to its end.
+*/
+size_t count_fasta_records(std::istream& in);
@@ -34,11 +34,11 @@ int pll_fasta_fseek(pll_fasta_t* fd, const long int offset, const int whence) {
 }
 
 MSA build_MSA_from_file(const std::string& msa_file, const MSA_Info& info, const bool premasking) {
-  MSA msa;
+  MSA_Chunk chunk;
   auto reader = make_msa_reader(msa_file, info, premasking, false);
-  reader->read_next(msa, std::numeric_limits<size_t>::max());
+  reader->read_next(chunk, std::numeric_limits<size_t>::max());
 
-  return msa;
+  return chunk.to_msa();
 }
 
 static void recurse_post_order(pll_unode_t const* const node,
@@ -2,6 +2,7 @@
 
 #include <sstream>
 #include <tuple>
+#include <cstdio>
 
 void merge_into(std::ofstream& dest, const std::vector<std::string>& sources) {
   size_t i = 0;
@@ -17,18 +18,24 @@ void merge_into(std::ofstream& dest, const std::vector<std::string>& sources) {
   }
 }
 
-void placement_to_jplace_string(Placement const& p, std::ostream& os, rtree_mapper const& mapper) {
-  auto branch_id = p.branch_id();
-  auto distal_length = p.distal_length();
+static void placement_to_jplace_string(size_t branch_id, const double likelihood,
+                                       const double lwr, double distal_length,
+                                       const double pendant_length, std::ostream& os,
+                                       rtree_mapper const& mapper) {
   if (mapper) {
     std::tie(branch_id, distal_length) = mapper.in_rtree(branch_id, distal_length);
   }
 
   os << "[" << branch_id << ", ";
-  os << p.likelihood() << ", ";
-  os << p.lwr() << ", ";
+  os << likelihood << ", ";
+  os << lwr << ", ";
   os << distal_length << ", ";
-  os << p.pendant_length() << "]";
+  os << pendant_length << "]";
+}
+
+void placement_to_jplace_string(Placement const& p, std::ostream& os, rtree_mapper const& mapper) {
+  placement_to_jplace_string(p.branch_id(), p.likelihood(), p.lwr(), p.distal_length(),
+                             p.pendant_length(), os, mapper);
 }
 
 void pquery_to_jplace_string(PQuery<Placement> const& pquery, std::ostream& os,
@@ -54,9 +61,12 @@ void pquery_to_jplace_string(PQuery<Placement> const& pquery, std::ostream& os,
   // start of name column
   os << "    \"n\": [";
 
-  // sequence header
+  // sequence header, and those of its duplicates
   const auto& header = pquery.header();
   os << "\"" << header.c_str() << "\"";
+  for (auto const& duplicate : pquery.duplicate_headers()) {
+    os << ", \"" << duplicate.c_str() << "\"";
+  }
 
   os << "]" << NEWL;  // close name bracket
 
@@ -97,6 +107,105 @@ void sample_to_jplace_string(Sample<Placement> const& sample, std::ostream& os,
   }
 }
 
+static void append_number(std::string& out, const size_t value) {
+  char buffer[32];
+  const auto size = std::snprintf(buffer, sizeof(buffer), "%zu", value);
+  out.append(buffer, size);
+}
+
+// the same as writing to a std::ostream set to fixed notation
+static void append_number(std::string& out, const double value, const int precision) {
+  char buffer[64];
+  const auto size = std::snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+  if (size < static_cast<int>(sizeof(buffer))) {
+    out.append(buffer, size);
+    return;
+  }
+  const auto old_size = out.size();
+  out.resize(old_size + size + 1);
+  std::snprintf(&out[old_size], size + 1, "%.*f", precision, value);
+  out.resize(old_size + size);
+}
+
+void pquery_to_jplace_string(Columnar_Sample const& sample, const size_t q,
+                             uint32_t const* const order, const size_t count, std::string& out,
+                             rtree_mapper const& mapper, const unsigned int precision) {
+  const auto begin = sample.begin(q);
+  auto const& branch_ids = sample.branch_ids();
+  auto const& likelihoods = sample.likelihoods();
+  auto const& lwrs = sample.lwrs();
+  auto const& distal_lengths = sample.distal_lengths();
+  auto const& pendant_lengths = sample.pendant_lengths();
+
+  out += "    {\"p\": [";
+  out += NEWL;
+
+  for (size_t k = 0; k < count; ++k) {
+    const auto i = begin + order[k];
+    size_t branch_id = branch_ids[i];
+    auto distal_length = distal_lengths[i];
+    if (mapper) {
+      std::tie(branch_id, distal_length) = mapper.in_rtree(branch_id, distal_length);
+    }
+
+    out += "      [";
+    append_number(out, branch_id);
+    out += ", ";
+    append_number(out, likelihoods[i], precision);
+    out += ", ";
+    append_number(out, lwrs[i], precision);
+    out += ", ";
+    append_number(out, distal_length, precision);
+    out += ", ";
+    append_number(out, pendant_lengths[i], precision);
+    out += "]";
+    if (k + 1 < count) {
+      out += ",";
+    }
+    out += NEWL;
+  }
+
+  out += "      ],";
+  out += NEWL;
+
+  out += "    \"n\": [";
+  bool first = true;
+  sample.for_each_name(q, [&](char const* const name, const size_t size) {
+    if (not first) {
+      out += ", ";
+    }
+    first = false;
+    out += "\"";
+    out.append(name, size);
+    out += "\"";
+  });
+  out += "]";
+  out += NEWL;
+
+  out += "    }";
+}
+
+void sample_to_jplace_string(Columnar_Sample const& sample, std::ostream& os,
+                             rtree_mapper const& mapper) {
+  std::vector<uint32_t> order;
+  std::string buffer;
+  for (size_t q = 0; q < sample.size(); ++q) {
+    const auto n = sample.num_placements(q);
+    order.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      order[i] = static_cast<uint32_t>(i);
+    }
+
+    buffer.clear();
+    pquery_to_jplace_string(sample, q, order.data(), n, buffer, mapper, os.precision());
+    if (q + 1 < sample.size()) {
+      buffer += ",";
+    }
+    buffer += NEWL;
+    os << buffer;
+  }
+}
+
 void full_jplace_string(Sample<Placement> const& sample, std::string const& invocation,
                         std::ostream& os, rtree_mapper const& mapper) {
   // tree and other init
@@ -6,12 +6,24 @@
 #include "util/stringify.hpp"
 #include "sample/PQuery.hpp"
 #include "sample/Sample.hpp"
+#include "sample/Columnar_Sample.hpp"
 #include "sample/Placement.hpp"
 #include "seq/MSA.hpp"
 #include "core/pll/rtree_mapper.hpp"
 
 void sample_to_jplace_string(Sample<Placement> const& sample, std::ostream& os,
                              rtree_mapper const& mapper);
+// assumes the stream to be in fixed notation, as the jplace_writer sets it
+void sample_to_jplace_string(Columnar_Sample const& sample, std::ostream& os,
+                             rtree_mapper const& mapper);
+/**
+  Appends query q of the sample, with the first count of the placements given by order (relative
+  to begin(q)), in that order. Numbers are formatted like in a stream in fixed notation with the
+  given precision.
+*/
+void pquery_to_jplace_string(Columnar_Sample const& sample, const size_t q,
+                             uint32_t const* const order, const size_t count, std::string& out,
+                             rtree_mapper const& mapper, const unsigned int precision);
 void pquery_to_jplace_string(PQuery<Placement> const& p, std::ostream& os,
                              rtree_mapper const& mapper);
 void placement_to_jplace_string(Placement const& p, std::ostream& os, rtree_mapper const& mapper);
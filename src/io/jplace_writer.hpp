@@ -6,6 +6,7 @@
 #include <sstream>
 #include <cassert>
 #include <iomanip>
+#include <vector>
 
 #include "sample/Sample.hpp"
 #include "util/logging.hpp"
@@ -55,7 +56,8 @@ public:
 #endif
   }
 
-  void write(Sample<>& chunk) {
+  template <class Sample_Type>
+  void write(Sample_Type& chunk) {
 #ifdef __PREFETCH
     // ensure the last write has finished
     if (prev_gather_.valid()) {
@@ -68,6 +70,25 @@ public:
 #endif
   }
 
+  /**
+    Writes a chunk that was serialized already, as consecutive pieces of pquery strings. The
+    buffers are moved in, not copied.
+  */
+  void write(std::vector<std::string>&& buffers) {
+#ifdef __PREFETCH
+    // ensure the last write has finished
+    if (prev_gather_.valid()) {
+      prev_gather_.get();
+    }
+    prev_gather_ = std::async(std::launch::async,
+                              [buffers = std::move(buffers), this]() mutable {
+                                this->write_(buffers);
+                              });
+#else
+    write_(buffers);
+#endif
+  }
+
   void wait() {
 #ifdef __PREFETCH
     if (prev_gather_.valid()) {
@@ -88,29 +109,47 @@ public:
   }
 
 protected:
-  void write_(Sample<>& chunk) {
+  template <class Sample_Type>
+  void write_(Sample_Type& chunk) {
+    std::ostringstream buffer;
+    buffer.precision(precision_);
+    buffer.setf(std::ios::fixed, std::ios::floatfield);
+    sample_to_jplace_string(chunk, buffer, mapper_);
+    std::vector<std::string> buffers;
+    buffers.push_back(buffer.str());
+    write_(buffers);
+  }
+
+  void write_(std::vector<std::string>& buffers) {
+    // the jplace head before the first chunk, the separator before all others
+    std::ostringstream lead;
+    lead.precision(precision_);
+    lead.setf(std::ios::fixed, std::ios::floatfield);
+    if (first_) {
+      first_ = false;
+#ifdef __MPI
+      // account for the leading string, which only rank 0 writes
+      if (local_rank_ == 0) {
+        init_jplace_string(tree_string_, lead);
+      }
+#else
+      init_jplace_string(tree_string_, lead);
+#endif
+    } else {
+      lead << ",\n";
+    }
+
 #ifdef __MPI  // ========== MPI ==============
 
     if (shared_file_) {
-      // serialize the sample
-      std::stringstream buffer;
-      buffer.precision(precision_);
-      buffer.setf(std::ios::fixed, std::ios::floatfield);
-      if (first_) {
-        // account for the leading string
-        if (local_rank_ == 0) {
-          init_jplace_string(tree_string_, buffer);
-        }
-        first_ = false;
-      } else {
-        buffer << ",\n";
+      // the write is collective, so join the pieces into one block per rank
+      auto block = lead.str();
+      for (auto const& piece : buffers) {
+        block += piece;
       }
-      sample_to_jplace_string(chunk, buffer, mapper_);
 
       // how much this rank intends to write this turn
-      const auto buffer_str = buffer.str();
-      size_t num_bytes = buffer_str.size();
-      buffer.clear();
+      size_t num_bytes = block.size();
 
       // make the displacements known to all
       std::vector<size_t> block_sizes(all_ranks_.size());
@@ -125,8 +164,8 @@ protected:
       }
 
       // write the local chunk
-      MPI_File_write_at_all(shared_file_, displacement, buffer_str.c_str(), buffer_str.size(),
-                            MPI_CHAR, MPI_STATUS_IGNORE);
+      MPI_File_write_at_all(shared_file_, displacement, block.c_str(), block.size(), MPI_CHAR,
+                            MPI_STATUS_IGNORE);
 
       bytes_written_ += total_written;
     }
@@ -134,14 +173,11 @@ protected:
 #else  // ========== NOT MPI ==============
 
     if (file_) {
-      if (first_) {
-        first_ = false;
-        init_jplace_string(tree_string_, *file_);
-      } else {
-        *file_ << ",\n";
+      const auto lead_str = lead.str();
+      file_->write(lead_str.data(), lead_str.size());
+      for (auto const& piece : buffers) {
+        file_->write(piece.data(), piece.size());
       }
-
-      sample_to_jplace_string(chunk, *file_, mapper_);
     }
 
 #endif
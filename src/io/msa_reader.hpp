@@ -12,14 +12,21 @@
 #include "io/msa_reader_interface.hpp"
 
 inline auto make_msa_reader(const std::string& file_name, const MSA_Info& info,
-                            const bool premasking = true, const bool split = false) {
+                            const bool premasking = true, const bool split = false,
+                            const size_t num_threads = 0) {
   std::unique_ptr<msa_reader> result(nullptr);
 
+  // the standard input can only be streamed
+  if (file_name == "-") {
+    result = std::make_unique<MSA_Stream>(file_name, info, premasking, split, num_threads);
+    return result;
+  }
+
   try {
     result = std::make_unique<Binary_Fasta_Reader>(file_name, info, premasking, split);
   } catch (const std::exception& e) {
     LOG_DBG << "Failed to parse input as binary fasta (bfast), trying `fasta` instead.";
-    result = std::make_unique<MSA_Stream>(file_name, info, premasking, split);
+    result = std::make_unique<MSA_Stream>(file_name, info, premasking, split, num_threads);
   }
 
   return result;
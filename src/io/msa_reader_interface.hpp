@@ -1,6 +1,6 @@
 #pragma once
 
-#include "seq/MSA.hpp"
+#include "seq/MSA_Chunk.hpp"
 
 class msa_reader {
 public:
@@ -9,5 +9,5 @@ public:
 
   virtual size_t num_sequences() const = 0;
   virtual size_t local_seq_offset() const = 0;
-  virtual size_t read_next(MSA& result, const size_t number) = 0;
+  virtual size_t read_next(MSA_Chunk& result, const size_t number) = 0;
 };
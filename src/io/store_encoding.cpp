@@ -0,0 +1,159 @@
+#include "io/store_encoding.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+
+static void check_size(const size_t expected, const size_t actual, const std::string& what) {
+  if (expected != actual) {
+    throw std::runtime_error{"Malformed " + what + " block in binary store: expected " +
+                             std::to_string(expected) + " bytes, got " + std::to_string(actual)};
+  }
+}
+
+// every value of the site is below 2^exponent
+static int16_t site_exponent(double const* const values, const size_t span) {
+  int exponent = 0;
+  std::frexp(*std::max_element(values, values + span), &exponent);
+  return static_cast<int16_t>(exponent);
+}
+
+/*
+  Layout: one int16_t exponent per site, followed by all values divided by 2^exponent of their
+  site. The CLVs of deep trees hold values far below the range of float otherwise.
+*/
+static size_t align_to(const size_t size, const size_t alignment) {
+  return ((size + alignment - 1) / alignment) * alignment;
+}
+
+size_t encoded_float32_size(const size_t size, const size_t span) {
+  return align_to(size / span * sizeof(int16_t), sizeof(float)) + size * sizeof(float);
+}
+
+std::vector<char> encode_float32(double const* const clv, const size_t size, const size_t span) {
+  const size_t num_sites = size / span;
+  const size_t header = align_to(num_sites * sizeof(int16_t), sizeof(float));
+  std::vector<char> result(encoded_float32_size(size, span));
+  auto const exponents = reinterpret_cast<int16_t*>(result.data());
+  auto const values = reinterpret_cast<float*>(result.data() + header);
+
+  for (size_t site = 0; site < num_sites; ++site) {
+    exponents[site] = site_exponent(clv + site * span, span);
+    for (size_t i = site * span; i < (site + 1) * span; ++i) {
+      values[i] = static_cast<float>(std::ldexp(clv[i], -exponents[site]));
+    }
+  }
+  return result;
+}
+
+void decode_float32(char const* const data, const size_t bytes, double* const clv,
+                    const size_t size, const size_t span) {
+  const size_t num_sites = size / span;
+  const size_t header = align_to(num_sites * sizeof(int16_t), sizeof(float));
+  check_size(encoded_float32_size(size, span), bytes, "float32");
+
+  for (size_t site = 0; site < num_sites; ++site) {
+    int16_t exponent;
+    std::memcpy(&exponent, data + site * sizeof(int16_t), sizeof(int16_t));
+
+    for (size_t i = site * span; i < (site + 1) * span; ++i) {
+      float value;
+      std::memcpy(&value, data + header + i * sizeof(float), sizeof(float));
+      clv[i] = std::ldexp(static_cast<double>(value), exponent);
+    }
+  }
+}
+
+static constexpr double SCALED16_MAX = std::numeric_limits<uint16_t>::max();
+
+/*
+  Layout: one int16_t exponent per site, followed by the uint16_t fractions of all values.
+*/
+size_t encoded_scaled16_size(const size_t size, const size_t span) {
+  return size / span * sizeof(int16_t) + size * sizeof(uint16_t);
+}
+
+std::vector<char> encode_scaled16(double const* const clv, const size_t size, const size_t span) {
+  const size_t num_sites = size / span;
+  std::vector<char> result(encoded_scaled16_size(size, span));
+  auto const exponents = reinterpret_cast<int16_t*>(result.data());
+  auto const fractions = reinterpret_cast<uint16_t*>(result.data() + num_sites * sizeof(int16_t));
+
+  for (size_t site = 0; site < num_sites; ++site) {
+    auto const values = clv + site * span;
+    exponents[site] = site_exponent(values, span);
+
+    for (size_t i = 0; i < span; ++i) {
+      fractions[site * span + i] = static_cast<uint16_t>(
+          std::lround(std::ldexp(values[i], -exponents[site]) * SCALED16_MAX));
+    }
+  }
+  return result;
+}
+
+void decode_scaled16(char const* const data, const size_t bytes, double* const clv,
+                     const size_t size, const size_t span) {
+  const size_t num_sites = size / span;
+  check_size(encoded_scaled16_size(size, span), bytes, "scaled16");
+
+  auto const fractions = data + num_sites * sizeof(int16_t);
+  for (size_t site = 0; site < num_sites; ++site) {
+    int16_t exponent;
+    std::memcpy(&exponent, data + site * sizeof(int16_t), sizeof(int16_t));
+
+    for (size_t i = 0; i < span; ++i) {
+      uint16_t fraction;
+      std::memcpy(&fraction, fractions + (site * span + i) * sizeof(uint16_t), sizeof(uint16_t));
+      clv[site * span + i] = std::ldexp(fraction / SCALED16_MAX, exponent);
+    }
+  }
+}
+
+std::vector<char> encode_rle(unsigned int const* const scaler, const size_t size) {
+  std::vector<uint32_t> runs;
+  for (size_t i = 0; i < size;) {
+    size_t run = 1;
+    while (i + run < size and scaler[i + run] == scaler[i]) {
+      ++run;
+    }
+    runs.push_back(static_cast<uint32_t>(run));
+    runs.push_back(scaler[i]);
+    i += run;
+  }
+
+  std::vector<char> result(runs.size() * sizeof(uint32_t));
+  std::memcpy(result.data(), runs.data(), result.size());
+  return result;
+}
+
+size_t decoded_rle_size(char const* const data, const size_t bytes) {
+  if (bytes % (2 * sizeof(uint32_t))) {
+    throw std::runtime_error{"Malformed rle block in binary store"};
+  }
+
+  size_t size = 0;
+  for (size_t offset = 0; offset < bytes; offset += 2 * sizeof(uint32_t)) {
+    uint32_t run;
+    std::memcpy(&run, data + offset, sizeof(uint32_t));
+    size += run;
+  }
+  return size;
+}
+
+void decode_rle(char const* const data, const size_t bytes, unsigned int* const scaler,
+                const size_t size) {
+  check_size(size, decoded_rle_size(data, bytes), "rle");
+
+  size_t i = 0;
+  for (size_t offset = 0; offset < bytes; offset += 2 * sizeof(uint32_t)) {
+    uint32_t run, value;
+    std::memcpy(&run, data + offset, sizeof(uint32_t));
+    std::memcpy(&value, data + offset + sizeof(uint32_t), sizeof(uint32_t));
+    std::fill(scaler + i, scaler + i + run, value);
+    i += run;
+  }
+}
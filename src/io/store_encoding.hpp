@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+  Reduced precision encodings of the buffers in the binary CLV store.
+
+  Both CLV encodings store a power of two per site (all rate categories and states), which the
+  values of the site are expressed in multiples of. That keeps them within range no matter how
+  small the values of a site get.
+
+  float32:  every CLV value as a single precision float.
+  scaled16: every CLV value as a 16 bit fraction. Values below 2^-16 of the largest value of their
+            site lose most of their precision.
+  rle:      scalers as (run length, value) pairs, as they are mostly zero.
+
+  The size of the CLV encodings only depends on the size of the CLV, so it is known up front.
+*/
+size_t encoded_float32_size(const size_t size, const size_t span);
+size_t encoded_scaled16_size(const size_t size, const size_t span);
+
+std::vector<char> encode_float32(double const* const clv, const size_t size, const size_t span);
+void decode_float32(char const* const data, const size_t bytes, double* const clv,
+                    const size_t size, const size_t span);
+
+std::vector<char> encode_scaled16(double const* const clv, const size_t size, const size_t span);
+void decode_scaled16(char const* const data, const size_t bytes, double* const clv,
+                     const size_t size, const size_t span);
+
+std::vector<char> encode_rle(unsigned int const* const scaler, const size_t size);
+size_t decoded_rle_size(char const* const data, const size_t bytes);
+void decode_rle(char const* const data, const size_t bytes, unsigned int* const scaler,
+                const size_t size);
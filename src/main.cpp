@@ -2,6 +2,7 @@
 #include <string>
 #include <algorithm>
 #include <chrono>
+#include <memory>
 
 #include <CLI/CLI.hpp>
 
@@ -77,6 +78,7 @@ int main(int argc, char** argv) {
   std::string tree_file;
   std::string reference_file;
   std::string binary_file;
+  std::string mask_file;
   std::string bfast_conv_file;
   std::vector<std::string> split_files;
 
@@ -89,6 +91,7 @@ int main(int argc, char** argv) {
   bool heuristics_off = not options.prescoring;
   bool raxml_blo = not options.sliding_blo;
   bool no_pre_mask = not options.premasking;
+  bool no_dedup = not options.dedup;
   bool redo = false;
 
   const bool empty = argc == 1;
@@ -109,6 +112,13 @@ int main(int argc, char** argv) {
                "Binary Dump mode: write ref. tree in binary format then exit. NOTE: not compatible "
                "with premasking!")
       ->group("Convert");
+  std::string dump_precision_option("double");
+  app.add_option("--dump-precision", dump_precision_option,
+                 "Precision of the CLVs in the binary dump. 'single' and 'scaled16' (16 bit per "
+                 "value plus a per-site exponent) make for a smaller, slightly less exact file.",
+                 true)
+      ->group("Convert")
+      ->check(CLI::IsMember({"double", "single", "scaled16"}, CLI::ignore_case));
   auto split_option =
       app.add_option("--split", split_files,
                      "Takes a reference MSA (phylip/fasta/fasta.gz) and combined ref +"
@@ -137,9 +147,23 @@ int main(int argc, char** argv) {
   tree_file_opt->excludes(binary_file_opt);
   reference_file_opt->excludes(binary_file_opt);
 
-  app.add_option("-q,--query", query_file, "Path to Query MSA file.")
+  app.add_option("-q,--query", query_file, "Path to Query MSA file, or - for the standard input.")
       ->group("Input")
-      ->check(CLI::ExistingFile);
+      ->check([](const std::string& file) {
+        std::string path(file);
+        return path == "-" ? std::string() : CLI::ExistingFile(path);
+      });
+  app.add_flag("--stream", options.streaming,
+               "Read the queries in a single pass, without first passing over the query file to "
+               "count the sequences and build their gap mask. Premasking then only uses the mask of "
+               "the reference (or of --mask). Implied when reading from the standard input.")
+      ->group("Input");
+  auto mask_file_opt =
+      app.add_option("--mask", mask_file,
+                     "Path to a premasking mask for --stream: one 0/1 character per alignment "
+                     "site, 1 for sites to be masked. Requires --stream.")
+          ->group("Input")
+          ->check(CLI::ExistingFile);
 
   auto model_option =
       app.add_option("-m,--model", model_desc,
@@ -236,6 +260,16 @@ int main(int argc, char** argv) {
              "--chunk-size", options.chunk_size,
              "Number of query sequences to be read in at a time. May influence performance.", true)
           ->group("Compute");
+  app.add_option("--prefetch", options.prefetch_chunks,
+                 "Number of query chunks to read ahead of the computation. 0 disables reading "
+                 "ahead.",
+                 true)
+      ->group("Compute");
+  size_t prefetch_memory_mb = 0;
+  auto prefetch_memory =
+      app.add_option("--prefetch-memory", prefetch_memory_mb,
+                     "Memory limit in MB for the query chunks read ahead (see --prefetch).")
+          ->group("Compute");
   app.add_flag("--raxml-blo", raxml_blo,
                "Employ old style of branch length optimization during thorough insertion as opposed"
                " to sliding approach. "
@@ -244,6 +278,29 @@ int main(int argc, char** argv) {
   app.add_flag("--no-pre-mask", no_pre_mask,
                "Do NOT pre-mask sequences. Enables repeats unless --no-repeats is also specified.")
       ->group("Compute");
+  app.add_flag("--no-dedup", no_dedup,
+               "Do NOT place identical query sequences only once. By default their names are listed "
+               "together in the output.")
+      ->group("Compute");
+  auto dedup_across =
+      app.add_option("--dedup-across", options.dedup_across,
+                     "Number of distinct query sequences whose results are kept to recognize "
+                     "them in later chunks, 0 to only place identical queries once per chunk.",
+                     true)
+          ->group("Compute");
+  auto cache_file_opt =
+      app.add_option("--cache", options.cache_file,
+                     "Path to a placement cache file, created if it does not exist. Queries whose "
+                     "results are in the cache (from runs with the same reference, model and "
+                     "options) are not placed again, and the results of new ones are added to it.")
+          ->group("Compute");
+
+  size_t max_memory_mb = 0;
+  auto max_memory =
+      app.add_option("--max-memory", max_memory_mb,
+                     "Memory limit in MB for reference CLVs and lookup tables. Reference CLVs can "
+                     "only be evicted when reading them from a binary file (-b).")
+          ->group("Compute");
 
   std::string rate_scalers_option("auto");
   app.add_option(
@@ -283,7 +340,14 @@ int main(int argc, char** argv) {
   // no log file for conversion functions
   if (not bfast_conv_file.empty()) {
     LOG_INFO << "Converting given FASTA file to BFAST format...";
-    auto resultfile = Binary_Fasta::fasta_to_bfast(bfast_conv_file, work_dir);
+    // with a reference alignment, store the sequences already masked
+    MSA_Info::mask_type reference_mask;
+    if (not reference_file.empty() and not no_pre_mask) {
+      LOG_INFO << "Premasking the sequences against the reference: " << reference_file;
+      reference_mask = MSA_Info(reference_file).gap_mask();
+    }
+    auto resultfile = Binary_Fasta::fasta_to_bfast(bfast_conv_file, work_dir, reference_mask,
+                                                   options.num_threads);
     LOG_INFO << "Resulting bfast file was written to: " << resultfile;
     exit_epa();
   }
@@ -396,6 +460,42 @@ int main(int argc, char** argv) {
     LOG_INFO << "Selected: Disabling pre-masking. (repeats enabled!)";
   }
 
+  if (no_dedup) {
+    options.dedup = false;
+    LOG_INFO << "Selected: Placing identical query sequences individually";
+  }
+
+  if (*dedup_across) {
+    if (not options.dedup) {
+      throw std::runtime_error{"--dedup-across cannot be combined with --no-dedup"};
+    }
+    LOG_INFO << "Selected: Keeping the results of up to " << options.dedup_across
+             << " distinct queries across chunks";
+  }
+
+  if (*cache_file_opt) {
+    if (not options.dedup) {
+      throw std::runtime_error{"--cache cannot be combined with --no-dedup"};
+    }
+    LOG_INFO << "Selected: Placement cache: " << options.cache_file;
+  }
+
+  if (query_file == "-") {
+    options.streaming = true;
+  }
+
+  if (options.streaming) {
+    LOG_INFO << "Selected: Streaming the queries in a single pass";
+  }
+
+  if (*mask_file_opt) {
+    // without --stream, the queries get their own gap mask in the pass over the file
+    if (not options.streaming) {
+      throw std::runtime_error{"--mask requires --stream (or reading the queries from -)"};
+    }
+    LOG_INFO << "Selected: Premasking mask: " << mask_file;
+  }
+
   if (rate_scalers_option == "auto") {
     options.scaling = Options::NumericalScaling::kAuto;
     LOG_INFO << "Selected: Automatic switching of use of per rate scalers";
@@ -420,6 +520,16 @@ int main(int argc, char** argv) {
   //   LOG_INFO << "Selected: Using the non-repeats version of libpll/modules";
   // }
 
+  if (*max_memory) {
+    options.max_memory = max_memory_mb * 1024 * 1024;
+    LOG_INFO << "Selected: Memory limit for the reference: " << max_memory_mb << " MB";
+  }
+
+  if (*prefetch_memory) {
+    options.prefetch_memory = prefetch_memory_mb * 1024 * 1024;
+    LOG_INFO << "Selected: Memory limit for reading ahead: " << prefetch_memory_mb << " MB";
+  }
+
   if (*no_heur) {
     options.prescoring = false;
     LOG_INFO << "Selected: Disabling the prescoring heuristics.";
@@ -428,6 +538,16 @@ int main(int argc, char** argv) {
   if (options.dump_binary_mode) {
     LOG_INFO << "Selected: Build reference tree and write it out as a binary CLV store (for MPI)";
     LOG_INFO << "\tWARNING: this mode means that no placement will take place in this run";
+
+    if (dump_precision_option == "single") {
+      options.store_precision = Options::StorePrecision::kSingle;
+    } else if (dump_precision_option == "scaled16") {
+      options.store_precision = Options::StorePrecision::kScaled16;
+    }
+    if (options.store_precision != Options::StorePrecision::kDouble) {
+      LOG_INFO << "Selected: Writing the binary CLV store in reduced precision: "
+               << dump_precision_option;
+    }
   }
 
   if (is_file(model_desc)) {
@@ -475,19 +595,33 @@ int main(int argc, char** argv) {
 
   MSA_Info qry_info;
   if (not query_file.empty()) {
-    qry_info = make_msa_info(query_file);
+    if (options.streaming) {
+      // no pass over the queries, they are masked like the reference (or per the given mask)
+      const auto mask = mask_file.empty() ? ref_info.gap_mask() : read_mask(mask_file);
+      if (options.premasking and mask.size() == 0) {
+        throw std::runtime_error{
+            "Streaming the queries without a reference MSA requires either --mask or "
+            "--no-pre-mask"};
+      }
+      qry_info = make_streaming_msa_info(query_file, mask);
+    } else {
+      qry_info = make_msa_info(query_file);
+    }
     LOG_DBG << "Query File:\n" << qry_info;
   }
 
-  if (ref_info.sites() != qry_info.sites()) {
-    LOG_ERR
-        << "The reference and query alignment files do not seem to have the same alignment width! ("
-        << ref_info.sites() << " vs. " << qry_info.sites()
-        << "). Are the query sequences not aligned?" << std::endl;
-    exit_epa(EXIT_FAILURE);
-  }
+  // without a reference MSA, there is nothing to compare a streamed query mask to
+  if (not options.streaming or ref_info.sites()) {
+    if (ref_info.sites() != qry_info.sites()) {
+      LOG_ERR << "The reference and query alignment files do not seem to have the same alignment "
+                 "width! ("
+              << ref_info.sites() << " vs. " << qry_info.sites()
+              << "). Are the query sequences not aligned?" << std::endl;
+      exit_epa(EXIT_FAILURE);
+    }
 
-  MSA_Info::or_mask(ref_info, qry_info);
+    MSA_Info::or_mask(ref_info, qry_info);
+  }
 
   MSA ref_msa;
   if (reference_file.size()) {
@@ -501,6 +635,12 @@ int main(int argc, char** argv) {
 
   // build the Tree
   Tree tree;
+  // when dumping, the CLVs are written to the binary file while they are computed
+  std::unique_ptr<Store_Writer> writer;
+  if (options.dump_binary_mode) {
+    writer = std::make_unique<Store_Writer>(work_dir + "epa_binary_file", options.store_precision);
+  }
+
   if (options.load_binary_mode) {
     LOG_INFO << "Loading from binary";
     tree = Tree(binary_file, model, options);
@@ -518,7 +658,7 @@ int main(int argc, char** argv) {
           << reference_file << " -t " << tree_file << " -n info -m GTRGAMMAX )" << std::endl;
       exit_epa(EXIT_FAILURE);
     }
-    tree = Tree(tree_file, ref_msa, model, options);
+    tree = Tree(tree_file, ref_msa, model, options, writer.get());
   }
 
   if (not options.dump_binary_mode) {
@@ -530,8 +670,7 @@ int main(int argc, char** argv) {
   } else {
     // dump to binary if specified
     LOG_INFO << "Writing to binary";
-    std::string dump_file(work_dir + "epa_binary_file");
-    dump_to_binary(tree, dump_file);
+    writer->finish(tree);
     exit_epa();
   }
 
@@ -6,6 +6,7 @@
 #include <limits>
 #include <utility>
 #include <cstddef>
+#include <algorithm>
 
 std::pair<size_t, size_t> local_seq_package(const size_t num_seqs) {
   int local_rank = 0;
@@ -27,4 +28,55 @@ std::pair<size_t, size_t> local_seq_package(const size_t num_seqs) {
     local_rank_seq_offset = part_size * local_rank;
   }
   return std::make_pair(local_rank_seq_offset, part_size);
-}
\ No newline at end of file
+}
+
+/**
+  Splits the sequences into contiguous packages of roughly equal total weight, one per rank, and
+  returns the offset and size of the package of the given rank. Every rank computes the same split
+  from the same weights, so no communication is needed.
+*/
+std::pair<size_t, size_t> weighted_seq_package(const std::vector<double>& weights,
+                                               const size_t num_ranks,
+                                               const size_t rank) {
+  std::vector<double> prefix(weights.size() + 1, 0.0);
+  for (size_t i = 0; i < weights.size(); ++i) {
+    prefix[i + 1] = prefix[i] + weights[i];
+  }
+
+  // the package boundary closest to the given share of the total weight
+  auto const boundary = [&](const size_t k) -> size_t {
+    if (k == 0) {
+      return 0;
+    }
+    if (k >= num_ranks) {
+      return weights.size();
+    }
+    const double target = prefix.back() * k / num_ranks;
+    size_t i = std::lower_bound(prefix.begin(), prefix.end(), target) - prefix.begin();
+    if (i > 0 and (target - prefix[i - 1]) < (prefix[i] - target)) {
+      --i;
+    }
+    return std::min(i, weights.size());
+  };
+
+  const auto begin = boundary(rank);
+  const auto end = std::max(begin, boundary(rank + 1));
+  return std::make_pair(begin, end - begin);
+}
+
+std::pair<size_t, size_t> local_seq_package(const std::vector<double>& weights) {
+  int local_rank = 0;
+  int num_ranks = 1;
+
+  MPI_COMM_RANK(MPI_COMM_WORLD, &local_rank);
+  MPI_COMM_SIZE(MPI_COMM_WORLD, &num_ranks);
+
+  LOG_INFO << "Number of MPI ranks: " << num_ranks;
+
+  const auto package = weighted_seq_package(weights, num_ranks, local_rank);
+
+  if (num_ranks > 1) {
+    LOG_INFO << "Number of sequences for this MPI rank: " << package.second;
+  }
+  return package;
+}
@@ -3,8 +3,13 @@
 #include "net/mpihead.hpp"
 #include <cstddef>
 #include <utility>
+#include <vector>
 
 std::pair<size_t, size_t> local_seq_package(const size_t num_seqs);
+std::pair<size_t, size_t> local_seq_package(const std::vector<double>& weights);
+std::pair<size_t, size_t> weighted_seq_package(const std::vector<double>& weights,
+                                               const size_t num_ranks,
+                                               const size_t rank);
 
 #ifdef __MPI
 
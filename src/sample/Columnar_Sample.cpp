@@ -0,0 +1,192 @@
+#include "sample/Columnar_Sample.hpp"
+
+#include <stdexcept>
+
+#ifdef __OMP
+#include <omp.h>
+#endif
+
+constexpr size_t Columnar_Sample::NO_NAME;
+
+Columnar_Sample::Columnar_Sample(const Sample<Placement>& sample) {
+  size_t num_placements = 0;
+  for (auto const& pq : sample) {
+    num_placements += pq.size();
+  }
+  reserve(sample.size(), num_placements);
+
+  for (auto const& pq : sample) {
+    const auto q = add_pquery(pq.sequence_id(), pq.header());
+    for (auto const& name : pq.duplicate_headers()) {
+      add_name(q, name);
+    }
+    for (auto const& p : pq) {
+      add_placement(p);
+    }
+  }
+}
+
+Sample<Placement> Columnar_Sample::to_sample() const {
+  Sample<Placement> sample;
+  for (size_t q = 0; q < size(); ++q) {
+    const auto idx = sample.add_pquery(sequence_id(q), header(q));
+    auto& pq = sample[idx];
+    for (auto n = next_name_[first_name_[q]]; n != NO_NAME; n = next_name_[n]) {
+      pq.add_header(name(n));
+    }
+    for (auto i = begin(q); i < end(q); ++i) {
+      pq.emplace_back(placement(i));
+    }
+  }
+  return sample;
+}
+
+void Columnar_Sample::clear() {
+  sequence_ids_.clear();
+  offsets_.resize(1);
+  branch_ids_.clear();
+  likelihoods_.clear();
+  lwrs_.clear();
+  pendant_lengths_.clear();
+  distal_lengths_.clear();
+  names_.clear();
+  name_offsets_.resize(1);
+  first_name_.clear();
+  last_name_.clear();
+  next_name_.clear();
+}
+
+void Columnar_Sample::reserve(const size_t num_pquerys, const size_t num_placements) {
+  sequence_ids_.reserve(num_pquerys);
+  offsets_.reserve(num_pquerys + 1);
+  first_name_.reserve(num_pquerys);
+  last_name_.reserve(num_pquerys);
+  next_name_.reserve(num_pquerys);
+  name_offsets_.reserve(num_pquerys + 1);
+
+  branch_ids_.reserve(num_placements);
+  likelihoods_.reserve(num_placements);
+  lwrs_.reserve(num_placements);
+  pendant_lengths_.reserve(num_placements);
+  distal_lengths_.reserve(num_placements);
+}
+
+size_t Columnar_Sample::push_name(char const* const name, const size_t size) {
+  names_.append(name, size);
+  name_offsets_.push_back(names_.size());
+  next_name_.push_back(NO_NAME);
+  return next_name_.size() - 1;
+}
+
+size_t Columnar_Sample::add_pquery(const size_t seq_id, char const* const header,
+                                   const size_t header_size, const size_t num_placements) {
+  sequence_ids_.push_back(seq_id);
+  offsets_.push_back(offsets_.back() + num_placements);
+  if (num_placements) {
+    const auto size = offsets_.back();
+    branch_ids_.resize(size);
+    likelihoods_.resize(size);
+    lwrs_.resize(size);
+    pendant_lengths_.resize(size);
+    distal_lengths_.resize(size);
+  }
+  const auto n = push_name(header, header_size);
+  first_name_.push_back(n);
+  last_name_.push_back(n);
+  return sequence_ids_.size() - 1;
+}
+
+static Columnar_Sample::branch_id_type checked_branch_id(const Placement& p) {
+  if (p.branch_id() > std::numeric_limits<Columnar_Sample::branch_id_type>::max()) {
+    throw std::runtime_error{"In Columnar_Sample: branch id out of range"};
+  }
+  return static_cast<Columnar_Sample::branch_id_type>(p.branch_id());
+}
+
+void Columnar_Sample::add_placement(const Placement& p) {
+  branch_ids_.push_back(checked_branch_id(p));
+  likelihoods_.push_back(p.likelihood());
+  lwrs_.push_back(p.lwr());
+  pendant_lengths_.push_back(p.pendant_length());
+  distal_lengths_.push_back(p.distal_length());
+  ++offsets_.back();
+}
+
+void Columnar_Sample::set_placement(const size_t i, const Placement& p) {
+  branch_ids_[i] = checked_branch_id(p);
+  likelihoods_[i] = p.likelihood();
+  lwrs_[i] = p.lwr();
+  pendant_lengths_[i] = p.pendant_length();
+  distal_lengths_[i] = p.distal_length();
+}
+
+void Columnar_Sample::add_name(const size_t q, const std::string& name) {
+  const auto n = push_name(name.data(), name.size());
+  next_name_[last_name_[q]] = n;
+  last_name_[q] = n;
+}
+
+Placement Columnar_Sample::placement(const size_t i) const {
+  Placement p(branch_ids_[i], likelihoods_[i], pendant_lengths_[i], distal_lengths_[i]);
+  p.lwr(lwrs_[i]);
+  return p;
+}
+
+std::vector<Placement> Columnar_Sample::placements(const size_t q) const {
+  std::vector<Placement> result;
+  result.reserve(num_placements(q));
+  for (auto i = begin(q); i < end(q); ++i) {
+    result.push_back(placement(i));
+  }
+  return result;
+}
+
+std::vector<std::string> Columnar_Sample::names(const size_t q) const {
+  std::vector<std::string> result;
+  for (auto n = first_name_[q]; n != NO_NAME; n = next_name_[n]) {
+    result.push_back(name(n));
+  }
+  return result;
+}
+
+template <class T>
+static void gather(std::vector<T>& column, const std::vector<size_t>& offsets,
+                   const std::vector<size_t>& new_offsets, const std::vector<uint32_t>& selection) {
+  std::vector<T> result(new_offsets.back());
+  const auto num_pquerys = offsets.size() - 1;
+#ifdef __OMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (size_t q = 0; q < num_pquerys; ++q) {
+    auto const from = column.data() + offsets[q];
+    auto const sel = selection.data() + offsets[q];
+    auto const to = result.data() + new_offsets[q];
+    const auto count = new_offsets[q + 1] - new_offsets[q];
+    for (size_t k = 0; k < count; ++k) {
+      to[k] = from[sel[k]];
+    }
+  }
+  column.swap(result);
+}
+
+void Columnar_Sample::select(const std::vector<uint32_t>& selection,
+                             const std::vector<size_t>& counts) {
+  if (selection.size() != num_placements() or counts.size() != size()) {
+    throw std::runtime_error{"In Columnar_Sample::select: selection does not match the sample"};
+  }
+
+  std::vector<size_t> new_offsets(offsets_.size(), 0);
+  for (size_t q = 0; q < size(); ++q) {
+    if (counts[q] > num_placements(q)) {
+      throw std::runtime_error{"In Columnar_Sample::select: too many placements selected"};
+    }
+    new_offsets[q + 1] = new_offsets[q] + counts[q];
+  }
+
+  gather(branch_ids_, offsets_, new_offsets, selection);
+  gather(likelihoods_, offsets_, new_offsets, selection);
+  gather(lwrs_, offsets_, new_offsets, selection);
+  gather(pendant_lengths_, offsets_, new_offsets, selection);
+  gather(distal_lengths_, offsets_, new_offsets, selection);
+  offsets_.swap(new_offsets);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+#include <cereal/types/vector.hpp>
+#include <cereal/types/string.hpp>
+
+#include "sample/Sample.hpp"
+#include "sample/Placement.hpp"
+
+/**
+  Placement results of a chunk of queries, stored by column: the placements of all queries lie in
+  flat arrays of branch ids, likelihoods, LWRs and lengths, where those of query q span the
+  indices [begin(q), end(q)). The names of the queries are likewise kept in one buffer.
+
+  Compared to a Sample, this saves the vector per pquery and the string per name, and lets the LWR
+  computation and the filters run over contiguous memory. Converts to and from Sample<Placement>.
+*/
+class Columnar_Sample {
+public:
+  using branch_id_type = uint32_t;
+
+  Columnar_Sample() = default;
+  explicit Columnar_Sample(const Sample<Placement>& sample);
+  ~Columnar_Sample() = default;
+
+  Sample<Placement> to_sample() const;
+
+  void clear();
+  void reserve(const size_t num_pquerys, const size_t num_placements);
+
+  /**
+    Adds a query, returns its index. Its placements are either added via add_placement, or, when
+    room for them is made right away, filled in via set_placement.
+  */
+  size_t add_pquery(const size_t seq_id, char const* const header, const size_t header_size,
+                    const size_t num_placements);
+  size_t add_pquery(const size_t seq_id, const std::string& header,
+                    const size_t num_placements = 0) {
+    return add_pquery(seq_id, header.data(), header.size(), num_placements);
+  }
+  // adds a placement to the last query
+  void add_placement(const Placement& p);
+  // sets placement i. Different placements may be set concurrently
+  void set_placement(const size_t i, const Placement& p);
+  // adds the name of an identical query to query q
+  void add_name(const size_t q, const std::string& name);
+
+  // member access
+  size_t size() const { return sequence_ids_.size(); }
+  size_t num_placements() const { return branch_ids_.size(); }
+  size_t sequence_id(const size_t q) const { return sequence_ids_[q]; }
+  size_t begin(const size_t q) const { return offsets_[q]; }
+  size_t end(const size_t q) const { return offsets_[q + 1]; }
+  size_t num_placements(const size_t q) const { return end(q) - begin(q); }
+  Placement placement(const size_t i) const;
+  std::vector<Placement> placements(const size_t q) const;
+
+  // names of query q: first its header, then those of identical queries
+  std::string header(const size_t q) const { return name(first_name_[q]); }
+  std::vector<std::string> names(const size_t q) const;
+  template <class F>
+  void for_each_name(const size_t q, F fn) const {
+    for (auto n = first_name_[q]; n != NO_NAME; n = next_name_[n]) {
+      fn(&names_[name_offsets_[n]], name_offsets_[n + 1] - name_offsets_[n]);
+    }
+  }
+
+  // columns
+  const std::vector<branch_id_type>& branch_ids() const { return branch_ids_; }
+  const std::vector<double>& likelihoods() const { return likelihoods_; }
+  const std::vector<double>& lwrs() const { return lwrs_; }
+  std::vector<double>& lwrs() { return lwrs_; }
+  const std::vector<double>& pendant_lengths() const { return pendant_lengths_; }
+  const std::vector<double>& distal_lengths() const { return distal_lengths_; }
+
+  /**
+    Keeps only the selected placements, in the selected order. Those of query q are given by the
+    first counts[q] entries of the selection starting at begin(q), as indices relative to begin(q).
+  */
+  void select(const std::vector<uint32_t>& selection, const std::vector<size_t>& counts);
+
+  // serialization
+  template <class Archive>
+  void serialize(Archive& ar) {
+    ar(sequence_ids_, offsets_, branch_ids_, likelihoods_, lwrs_, pendant_lengths_,
+       distal_lengths_, names_, name_offsets_, first_name_, last_name_, next_name_);
+  }
+
+private:
+  static constexpr size_t NO_NAME = std::numeric_limits<size_t>::max();
+
+  std::string name(const size_t n) const {
+    return names_.substr(name_offsets_[n], name_offsets_[n + 1] - name_offsets_[n]);
+  }
+  size_t push_name(char const* const name, const size_t size);
+
+  std::vector<size_t> sequence_ids_;
+  std::vector<size_t> offsets_ = {0};
+
+  std::vector<branch_id_type> branch_ids_;
+  std::vector<double> likelihoods_;
+  std::vector<double> lwrs_;
+  std::vector<double> pendant_lengths_;
+  std::vector<double> distal_lengths_;
+
+  // all names, with a list of names per query
+  std::string names_;
+  std::vector<size_t> name_offsets_ = {0};
+  std::vector<size_t> first_name_;
+  std::vector<size_t> last_name_;
+  std::vector<size_t> next_name_;
+};
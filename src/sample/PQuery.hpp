@@ -50,9 +50,12 @@ public:
   inline seqid_type sequence_id() const { return sequence_id_; }
   inline void sequence_id(const seqid_type seq_id) { sequence_id_ = seq_id; }
   const std::string& header() const { return header_; }
+  // headers of the queries with the same sequence, that share this ones placements
+  const std::vector<std::string>& duplicate_headers() const { return duplicate_headers_; }
   size_t size() const { return placements_.size(); }
 
   // manipulators
+  void add_header(std::string header) { duplicate_headers_.push_back(std::move(header)); }
   void erase(iterator begin, iterator end) { placements_.erase(begin, end); }
   void resize(size_t size) { return placements_.resize(size); }
   inline void insert(iterator this_first, const_iterator begin, const_iterator end) {
@@ -82,11 +85,12 @@ public:
   // serialization
   template <class Archive>
   void serialize(Archive& ar) {
-    ar(sequence_id_, header_, placements_);
+    ar(sequence_id_, header_, duplicate_headers_, placements_);
   }
 
 private:
   seqid_type sequence_id_ = 0;
   std::string header_;
+  std::vector<std::string> duplicate_headers_;
   std::vector<value_type> placements_;
 };
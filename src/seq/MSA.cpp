@@ -6,16 +6,17 @@ void MSA::move_sequences(MSA::iterator begin, MSA::iterator end) {
   std::move(begin, end, std::back_inserter(sequence_list_));
 }
 
-void MSA::append(const std::string& header, const std::string& sequence) {
-  if (num_sites_ && sequence.length() != num_sites_) {
+void MSA::append(std::string header, std::string sequence, const Range range) {
+  const auto length = sequence.length();
+  if (num_sites_ && length != num_sites_) {
     throw std::runtime_error{std::string("Tried to insert sequence to MSA of unequal length: ") +
                              header};
   }
 
-  sequence_list_.emplace_back(header, sequence);
+  sequence_list_.emplace_back(std::move(header), std::move(sequence), range);
 
   if (!num_sites_) {
-    num_sites_ = sequence.length();
+    num_sites_ = length;
   }
 }
 
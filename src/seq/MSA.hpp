@@ -16,7 +16,7 @@ public:
   ~MSA() = default;
 
   void move_sequences(iterator begin, iterator end);
-  void append(const std::string& header, const std::string& sequence);
+  void append(std::string header, std::string sequence, const Range range = Range(0, 0));
   void erase(iterator begin, iterator end) { sequence_list_.erase(begin, end); }
   void clear() { sequence_list_.clear(); }
 
@@ -0,0 +1,88 @@
+#include "seq/MSA_Chunk.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+void MSA_Chunk::clear() {
+  num_sites_ = 0;
+  labels_.clear();
+  sites_.clear();
+  label_offsets_.resize(1);
+  site_offsets_.resize(1);
+  ranges_.clear();
+}
+
+void MSA_Chunk::reserve(const size_t sequences, const size_t label_bytes,
+                        const size_t site_bytes) {
+  labels_.reserve(label_bytes);
+  sites_.reserve(site_bytes);
+  label_offsets_.reserve(sequences + 1);
+  site_offsets_.reserve(sequences + 1);
+  ranges_.reserve(sequences);
+}
+
+char* MSA_Chunk::append(char const* const label, const size_t label_size, const size_t length,
+                        const Range range) {
+  if (size() and length != num_sites_) {
+    throw std::runtime_error{std::string("Tried to insert sequence to MSA of unequal length: ") +
+                             std::string(label, label_size)};
+  }
+  num_sites_ = length;
+
+  labels_.append(label, label_size);
+  label_offsets_.push_back(labels_.size());
+
+  const auto begin = sites_.size();
+  // also makes room for the terminating null character
+  sites_.resize(begin + length + 1, '\0');
+  site_offsets_.push_back(sites_.size());
+
+  ranges_.push_back(range);
+
+  return &sites_[begin];
+}
+
+void MSA_Chunk::append(const std::string& label, const std::string& sequence, const Range range) {
+  auto const sites = append(label.data(), label.size(), sequence.size(), range);
+  std::copy(sequence.begin(), sequence.end(), sites);
+}
+
+void MSA_Chunk::append(const MSA_Chunk& other) {
+  if (not other.size()) {
+    return;
+  }
+  if (size() and other.num_sites_ != num_sites_) {
+    throw std::runtime_error{std::string("Tried to insert sequence to MSA of unequal length: ") +
+                             other[0].header()};
+  }
+  num_sites_ = other.num_sites_;
+
+  const auto label_base = labels_.size();
+  const auto site_base = sites_.size();
+  labels_ += other.labels_;
+  sites_ += other.sites_;
+  for (size_t i = 1; i < other.label_offsets_.size(); ++i) {
+    label_offsets_.push_back(label_base + other.label_offsets_[i]);
+    site_offsets_.push_back(site_base + other.site_offsets_[i]);
+  }
+  ranges_.insert(ranges_.end(), other.ranges_.begin(), other.ranges_.end());
+}
+
+MSA MSA_Chunk::to_msa() const {
+  MSA msa(num_sites_);
+  for (const auto s : *this) {
+    msa.append(s.header(), s.sequence(), s.range());
+  }
+  return msa;
+}
+
+void MSA_Chunk::swap(MSA_Chunk& a, MSA_Chunk& b) {
+  std::swap(a.num_sites_, b.num_sites_);
+  std::swap(a.labels_, b.labels_);
+  std::swap(a.sites_, b.sites_);
+  std::swap(a.label_offsets_, b.label_offsets_);
+  std::swap(a.site_offsets_, b.site_offsets_);
+  std::swap(a.ranges_, b.ranges_);
+}
+
+void std::swap(MSA_Chunk& a, MSA_Chunk& b) { MSA_Chunk::swap(a, b); }
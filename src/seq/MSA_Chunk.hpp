@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iterator>
+
+#include "seq/MSA.hpp"
+#include "seq/Sequence_View.hpp"
+#include "util/Range.hpp"
+
+/**
+  A chunk of query sequences, as handed out by the msa_readers.
+
+  Instead of a heap allocated label and sequence per entry (as in MSA), all labels and all sites
+  are kept in one buffer each, indexed by offset arrays. Clearing a chunk keeps its buffers, so
+  a chunk that is reused for reading the next one causes no allocations once it has grown to
+  size. The sequences are accessed through Sequence_View.
+*/
+class MSA_Chunk {
+public:
+  class const_iterator {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Sequence_View;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Sequence_View;
+
+    const_iterator(const MSA_Chunk& chunk, const size_t i) : chunk_(&chunk), i_(i) {}
+
+    Sequence_View operator*() const { return (*chunk_)[i_]; }
+    const_iterator& operator++() {
+      ++i_;
+      return *this;
+    }
+    const_iterator operator+(const difference_type n) const {
+      return const_iterator(*chunk_, i_ + n);
+    }
+    difference_type operator-(const const_iterator& other) const {
+      return static_cast<difference_type>(i_) - static_cast<difference_type>(other.i_);
+    }
+    bool operator==(const const_iterator& other) const { return i_ == other.i_; }
+    bool operator!=(const const_iterator& other) const { return i_ != other.i_; }
+
+  private:
+    MSA_Chunk const* chunk_;
+    size_t i_;
+  };
+
+  MSA_Chunk() = default;
+  ~MSA_Chunk() = default;
+
+  MSA_Chunk(MSA_Chunk const& other) = default;
+  MSA_Chunk(MSA_Chunk&& other) = default;
+  MSA_Chunk& operator=(MSA_Chunk const& other) = default;
+  MSA_Chunk& operator=(MSA_Chunk&& other) = default;
+
+  /**
+    Removes all sequences, keeping the allocated storage.
+  */
+  void clear();
+  void reserve(const size_t sequences, const size_t label_bytes, const size_t site_bytes);
+
+  /**
+    Appends an entry with the given label and room for length sites, and returns where to write
+    the sites to. The pointer is only valid until the next change of the chunk.
+  */
+  char* append(char const* const label, const size_t label_size, const size_t length,
+               const Range range = Range(0, 0));
+  void append(const std::string& label, const std::string& sequence,
+              const Range range = Range(0, 0));
+  void append(const MSA_Chunk& other);
+
+  static void swap(MSA_Chunk& a, MSA_Chunk& b);
+
+  // getters
+  size_t size() const { return ranges_.size(); }
+  size_t num_sites() const { return num_sites_; }
+  // bytes taken up by the labels and sites
+  size_t bytes() const { return labels_.size() + sites_.size(); }
+  Sequence_View operator[](const size_t i) const {
+    return Sequence_View(labels_.data() + label_offsets_[i],
+                         label_offsets_[i + 1] - label_offsets_[i],
+                         sites_.data() + site_offsets_[i],
+                         site_offsets_[i + 1] - site_offsets_[i] - 1, ranges_[i]);
+  }
+
+  // Iterator Compatibility
+  const_iterator begin() const { return const_iterator(*this, 0); }
+  const_iterator end() const { return const_iterator(*this, size()); }
+
+  MSA to_msa() const;
+
+private:
+  size_t num_sites_ = 0;
+  // the sites of every sequence are followed by a null character
+  std::string labels_;
+  std::string sites_;
+  std::vector<size_t> label_offsets_{0};
+  std::vector<size_t> site_offsets_{0};
+  std::vector<Range> ranges_;
+};
+
+namespace std {
+void swap(MSA_Chunk& a, MSA_Chunk& b);
+}
@@ -1,13 +1,61 @@
 #include "seq/MSA_Info.hpp"
 
 #include "io/Binary_Fasta.hpp"
+#include "io/MSA_Index.hpp"
+
+#include <fstream>
+#include <cctype>
 
 MSA_Info make_msa_info(const std::string& file_path) {
   MSA_Info info;
   try {
     info = Binary_Fasta::get_info(file_path);
   } catch (const std::exception&) {
-    info = MSA_Info(file_path);
+    info = can_index(file_path) ? get_msa_index(file_path).info : MSA_Info(file_path);
   }
   return info;
-}
\ No newline at end of file
+}
+
+/**
+  Info for reading the query file in a single pass: instead of passing through the file, the
+  given mask is used, and the number of sequences is left unknown (0). Bfast files carry their
+  info in the header, so for those it is read from there as usual.
+*/
+MSA_Info make_streaming_msa_info(const std::string& file_path, const MSA_Info::mask_type& mask) {
+  if (file_path != "-") {
+    try {
+      return Binary_Fasta::get_info(file_path);
+    } catch (const std::exception&) {
+    }
+  }
+  return MSA_Info(file_path, 0, mask, mask.size());
+}
+
+/**
+  Reads a mask given as one character per alignment site, '1' for masked sites and '0' for the
+  others. Whitespace is ignored.
+*/
+MSA_Info::mask_type read_mask(const std::string& file_path) {
+  std::ifstream file(file_path);
+  if (not file) {
+    throw std::runtime_error{"Cannot open file: " + file_path};
+  }
+
+  std::string bits;
+  char c;
+  while (file.get(c)) {
+    if (c == '0' or c == '1') {
+      bits += c;
+    } else if (not std::isspace(static_cast<unsigned char>(c))) {
+      throw std::runtime_error{"Invalid character in mask file " + file_path + ": " + c};
+    }
+  }
+
+  MSA_Info::mask_type mask(bits.size(), false);
+  for (size_t i = 0; i < bits.size(); ++i) {
+    if (bits[i] == '1') {
+      mask.set(i);
+    }
+  }
+  return mask;
+}
@@ -5,6 +5,8 @@
 #include "genesis/utils/math/bitvector/operators.hpp"
 #include "genesis/sequence/formats/fasta_input_iterator.hpp"
 
+#include "seq/Site_Mask.hpp"
+
 #include <string>
 
 /**
@@ -28,7 +30,7 @@ public:
     // set some initial stuff
     if (it) {
       sites_ = it->length();
-      gap_mask_ = mask_type(sites_, true);
+      site_mask_ = Site_Mask(sites_, true);
     }
 
     while (it) {
@@ -49,18 +51,18 @@ public:
             " does not contain equal size sequences! First offending sequence: " + seq.label()};
       }
 
-      // get the mask of the current sequence
-      auto cur_mask = genesis::sequence::gap_sites(seq);
-      // adjust global mask accordingly
-      gap_mask_ &= cur_mask;
+      // adjust global mask according to the gaps of the current sequence
+      site_mask_.and_gap_sites(seq.sites());
 
       ++it;
     }
+    gap_mask_ = site_mask_.to_bitvector();
   }
 
   MSA_Info(const std::string& file_path, const size_t sequences, const mask_type& mask,
            const size_t sites = 0)
-      : path_(file_path), sites_(sites), sequences_(sequences), gap_mask_(mask) {}
+      : path_(file_path), sites_(sites), sequences_(sequences), gap_mask_(mask),
+        site_mask_(mask) {}
 
   MSA_Info() = default;
   ~MSA_Info() = default;
@@ -70,6 +72,8 @@ public:
   size_t sites() const { return sites_; }
   size_t sequences() const { return sequences_; }
   const mask_type& gap_mask() const { return gap_mask_; }
+  // the gap mask in word form, for masking sequences
+  const Site_Mask& site_mask() const { return site_mask_; }
   size_t gap_count() const { return gap_mask_.count(); }
 
   static void or_mask(MSA_Info& lhs, MSA_Info& rhs) {
@@ -81,6 +85,8 @@ public:
     // new mask contains gaps where either lhs OR rhs has gaps
     // (like masking in pplacer)
     lhs.gap_mask_ = rhs.gap_mask_ = lhs.gap_mask() | rhs.gap_mask();
+    lhs.site_mask_ |= rhs.site_mask_;
+    rhs.site_mask_ = lhs.site_mask_;
   }
 
 private:
@@ -88,28 +94,28 @@ private:
   size_t sites_ = 0;
   size_t sequences_ = 0;
   mask_type gap_mask_;
+  Site_Mask site_mask_;
 };
 
-inline std::string subset_sequence(const std::string& seq, const MSA_Info::mask_type& mask) {
-  const size_t nongap_count = mask.size() - mask.count();
-  std::string result(nongap_count, '$');
-
+inline std::string subset_sequence(const std::string& seq, const Site_Mask& mask) {
   if (seq.length() != mask.size()) {
     throw std::runtime_error{"In subset_sequence: mask and seq incompatible"};
   }
 
-  size_t k = 0;
-  for (size_t i = 0; i < seq.length(); ++i) {
-    if (not mask[i]) {
-      result[k++] = seq[i];
-    }
-  }
-
-  assert(nongap_count == k);
+  std::string result(mask.size() - mask.count(), '$');
+  mask.apply(seq.data(), &result[0]);
 
   return result;
 }
 
+/**
+  Prefer the Site_Mask version when masking many sequences, as this one first has to convert
+  the mask.
+*/
+inline std::string subset_sequence(const std::string& seq, const MSA_Info::mask_type& mask) {
+  return subset_sequence(seq, Site_Mask(mask));
+}
+
 inline std::ostream& operator<<(std::ostream& out, MSA_Info const& rhs) {
   out << "Path: " << rhs.path();
   out << "\nSequences: " << rhs.sequences();
@@ -122,3 +128,5 @@ inline std::ostream& operator<<(std::ostream& out, MSA_Info const& rhs) {
 }
 
 MSA_Info make_msa_info(const std::string& file_path);
+MSA_Info make_streaming_msa_info(const std::string& file_path, const MSA_Info::mask_type& mask);
+MSA_Info::mask_type read_mask(const std::string& file_path);
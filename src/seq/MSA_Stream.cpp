@@ -1,48 +1,39 @@
 #include "seq/MSA_Stream.hpp"
 
 #include <chrono>
+#include <exception>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#ifdef __OMP
+#include <omp.h>
+#endif
 
 #include "util/logging.hpp"
 #include "net/epa_mpi_util.hpp"
+#include "io/fasta_blocks.hpp"
+#include "io/Gzip_Stream.hpp"
+#include "io/MSA_Index.hpp"
 
-static void read_chunk(MSA_Stream::file_type& iter, const MSA_Info& info, const bool premasking,
-                       const size_t number, MSA_Stream::container_type& prefetch_buffer,
-                       const size_t max_read, size_t& num_read) {
-  prefetch_buffer.clear();
-
-  auto length = info.sites();
-  size_t number_left = std::min(number, max_read - num_read);
-
-  while (number_left > 0 and iter) {
-    const auto sequence_length = iter->length();
-    if (length and (length != sequence_length)) {
-      throw std::runtime_error{"MSA file does not contain equal size sequences"};
-    }
-
-    if (!length) length = sequence_length;
-
-    prefetch_buffer.append(
-        iter->label(),
-        (premasking ? subset_sequence(iter->sites(), info.gap_mask()) : iter->sites()));
-
-    length = sequence_length;
-    number_left--;
-    ++iter;
-  }
-
-  num_read += prefetch_buffer.size();
-}
+// size of the blocks in which the raw input is read
+constexpr size_t READ_BLOCK_SIZE = 1ul << 22;
+// below this many records per thread, parsing is not worth spreading out
+constexpr size_t MIN_RECORDS_PER_THREAD = 64;
 
 MSA_Stream::MSA_Stream(const std::string& msa_file, const MSA_Info& info, const bool premasking,
-                       const bool split)
+                       const bool split, const size_t num_threads)
     : info_(info), premasking_(premasking) {
-  genesis::sequence::FastaReader reader_settings;
-  // ensure sequences are uniformly upper case
-  reader_settings.site_casing(genesis::sequence::FastaReader::SiteCasing::kToUpper);
-  iter_ =
-      genesis::sequence::FastaInputIterator(genesis::utils::from_file(msa_file), reader_settings);
+#ifdef __OMP
+  num_threads_ = num_threads ? num_threads : omp_get_max_threads();
+#else
+  static_cast<void>(num_threads);
+  num_threads_ = 1;
+#endif
+
+  file_ = open_input(msa_file, num_threads_);
 
-  if (!iter_) {
+  if (not *file_) {
     throw std::runtime_error{std::string("Cannot open file: ") + msa_file};
   }
 
@@ -50,50 +41,185 @@ MSA_Stream::MSA_Stream(const std::string& msa_file, const MSA_Info& info, const
 
 #ifdef __MPI
   if (split) {
+    int num_ranks = 1;
+    MPI_COMM_SIZE(MPI_COMM_WORLD, &num_ranks);
+
+    // with an index, the ranks can seek straight to their part of the file
+    MSA_Index index;
+    if (num_ranks > 1 and can_index(msa_file) and load_msa_index(msa_file, index) and
+        (not info.sequences() or info.sequences() == index.offsets.size())) {
+      record_offsets_ = std::move(index.offsets);
+    }
+
+    // when streaming, the number of sequences is unknown, but needed for splitting
+    if (not info.sequences() and num_ranks > 1) {
+      if (msa_file == "-") {
+        throw std::runtime_error{"The standard input cannot be split across MPI ranks"};
+      }
+      const auto num_sequences = record_offsets_.size()
+                                     ? record_offsets_.size()
+                                     : count_fasta_records(*open_input(msa_file, num_threads_));
+      info_ = MSA_Info(info.path(), num_sequences, info.gap_mask(), info.sites());
+    }
+
     // get info about to which sequence to skip to and how much this rank should read
-    std::tie(local_seq_offset_, max_read_) = local_seq_package(info.sequences());
+    if (info_.sequences()) {
+      std::tie(local_seq_offset_, max_read_) = local_seq_package(info_.sequences());
 
-    skip_to_sequence(local_seq_offset_);
+      skip_to_sequence(local_seq_offset_);
+    }
   }
 #else
   static_cast<void>(split);
 #endif
 }
 
-size_t MSA_Stream::read_next(MSA_Stream::container_type& result, const size_t number) {
-  if (first_) {  //...this is the first chunk
-    // then read the first chunk and kick off the next asynchronously
-    read_chunk(iter_, info_, premasking_, number, prefetch_chunk_, max_read_, num_read_);
-    first_ = false;
+/**
+  Reads raw blocks until the buffer holds the first number records completely, or until the end
+  of the input.
+*/
+void MSA_Stream::buffer_records(const size_t number) {
+  while (records_.size() <= number and not eof_) {
+    const auto old_size = buffer_.size();
+    buffer_.resize(old_size + READ_BLOCK_SIZE);
+    file_->read(&buffer_[old_size], READ_BLOCK_SIZE);
+    buffer_.resize(old_size + file_->gcount());
+    eof_ = not *file_;
+
+    // a record starts with a '>' at the beginning of a line
+    auto const data = buffer_.data();
+    while (scanned_ < buffer_.size()) {
+      auto const next =
+          static_cast<char const*>(std::memchr(data + scanned_, '>', buffer_.size() - scanned_));
+      if (not next) {
+        scanned_ = buffer_.size();
+        break;
+      }
+      const size_t pos = next - data;
+      if (pos == 0 or data[pos - 1] == '\n') {
+        records_.push_back(pos);
+      }
+      scanned_ = pos + 1;
+    }
   }
-#ifdef __PREFETCH
-  // join prefetching thread to ensure new chunk exists
-  if (prefetcher_.valid()) {
-    prefetcher_.wait();
+}
+
+/**
+  Removes the first number records, which need to be buffered, and anything before them.
+*/
+void MSA_Stream::drop_records(const size_t number) {
+  const auto end = number < records_.size() ? records_[number] : buffer_.size();
+  buffer_.erase(0, end);
+  records_.erase(records_.begin(), records_.begin() + std::min(number, records_.size()));
+  for (auto& r : records_) {
+    r -= end;
   }
-#endif
-  // perform pointer swap to data
-  std::swap(result, prefetch_chunk_);
-
-  // start request next chunk from prefetcher (async)
-#ifdef __PREFETCH
-  prefetcher_ =
-      std::async(std::launch::async, read_chunk, std::ref(iter_), std::ref(info_), premasking_,
-                 number, std::ref(prefetch_chunk_), max_read_, std::ref(num_read_));
-#else
-  read_chunk(iter_, info_, premasking_, number, prefetch_chunk_, max_read_, num_read_);
-#endif
-  // return size of current buffer
-  return result.size();
+  scanned_ -= std::min(scanned_, end);
 }
 
-MSA_Stream::~MSA_Stream() {
-#ifdef __PREFETCH
-  // avoid dangling threads
-  if (prefetcher_.valid()) {
-    prefetcher_.wait();
+void MSA_Stream::read_chunk(MSA_Stream::container_type& result, const size_t number) {
+  result.clear();
+
+  const size_t number_left = std::min(number, max_read_ - num_read_);
+  buffer_records(number_left);
+  const size_t count = std::min(number_left, records_.size());
+
+  if (count == 0) {
+    return;
+  }
+
+  // the first record of the chunk may be preceded by whitespace, so parts start at 0, not at it
+  auto const record_begin = [&](const size_t i) -> size_t {
+    return i == 0 ? 0 : (i < records_.size() ? records_[i] : buffer_.size());
+  };
+
+  const size_t num_parts =
+      std::max(size_t{1}, std::min(num_threads_, count / MIN_RECORDS_PER_THREAD));
+  std::vector<std::exception_ptr> errors(num_parts);
+  const auto length = info_.sites();
+  // the width every record is checked against: that of the MSA if known, else that of the first
+  // record of the part, which is checked across the parts afterwards
+  std::vector<size_t> widths(num_parts, length);
+  auto const& mask = info_.site_mask();
+  const size_t masked_length = mask.size() - mask.count();
+
+  if (parts_.size() < num_parts) {
+    parts_.resize(num_parts);
   }
+
+#ifdef __OMP
+#pragma omp parallel for schedule(static, 1) num_threads(num_parts)
 #endif
+  for (size_t p = 0; p < num_parts; ++p) {
+    try {
+      const size_t first = count * p / num_parts;
+      const size_t last = count * (p + 1) / num_parts;
+      auto& part = parts_[p];
+      part.clear();
+      auto& width = widths[p];
+
+      parse_fasta_block(
+          buffer_.data(), Byte_Range(record_begin(first), record_begin(last)),
+          [&](std::string& label, std::string& sites) {
+            if (not width) {
+              width = sites.size();
+            }
+            if (width != sites.size()) {
+              throw std::runtime_error{"MSA file does not contain equal size sequences"};
+            }
+            if (premasking_ and mask.size() != sites.size()) {
+              throw std::runtime_error{"In subset_sequence: mask and seq incompatible"};
+            }
+            const auto size = premasking_ ? masked_length : sites.size();
+            auto const out = part.append(label.data(), label.size(), size);
+            if (premasking_) {
+              mask.apply(sites.data(), out);
+            } else {
+              std::copy(sites.begin(), sites.end(), out);
+            }
+            for (size_t k = 0; k < size; ++k) {
+              out[k] = std::toupper(static_cast<unsigned char>(out[k]));
+            }
+          });
+
+      if (part.size() != last - first) {
+        throw std::runtime_error{"Malformed FASTA: unexpected number of records in a block"};
+      }
+    } catch (...) {
+      errors[p] = std::current_exception();
+    }
+  }
+
+  for (auto& e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+
+  for (auto const width : widths) {
+    if (width != widths.front()) {
+      throw std::runtime_error{"MSA file does not contain equal size sequences"};
+    }
+  }
+
+  if (num_parts == 1) {
+    // trade storage with the part instead of copying it
+    std::swap(result, parts_[0]);
+  } else {
+    for (size_t p = 0; p < num_parts; ++p) {
+      result.append(parts_[p]);
+    }
+  }
+
+  drop_records(count);
+
+  num_read_ += result.size();
+}
+
+size_t MSA_Stream::read_next(MSA_Stream::container_type& result, const size_t number) {
+  first_ = false;
+  read_chunk(result, number);
+  return result.size();
 }
 
 void MSA_Stream::skip_to_sequence(const size_t n) {
@@ -102,13 +228,6 @@ void MSA_Stream::skip_to_sequence(const size_t n) {
     throw std::runtime_error{"Skipping currently not allowed after first read!"};
   }
 
-#ifdef __PREFETCH
-  // join prefetching thread to ensure new chunk exists
-  if (prefetcher_.valid()) {
-    prefetcher_.wait();
-  }
-#endif
-
   if (n >= num_sequences()) {
     throw std::runtime_error{"Trying to skip out of bounds!"};
   }
@@ -117,7 +236,31 @@ void MSA_Stream::skip_to_sequence(const size_t n) {
     throw std::runtime_error{"Trying to skip behind!"};
   }
 
-  size_t offset = n - num_read_;
+  // seek right to the record if its offset is known
+  if (n < record_offsets_.size() and num_read_ == 0) {
+    buffer_.clear();
+    records_.clear();
+    scanned_ = 0;
+    eof_ = false;
+    file_->clear();
+    file_->seekg(record_offsets_[n]);
+    if (not *file_) {
+      throw std::runtime_error{"Cannot seek to sequence " + std::to_string(n)};
+    }
+    return;
+  }
 
-  std::advance(iter_, offset);
+  // otherwise, skip the records without parsing them, as many as are buffered completely at a
+  // time
+  size_t offset = n - num_read_;
+  while (offset > 0) {
+    buffer_records(records_.size());
+    const auto complete = eof_ ? records_.size() : records_.size() - 1;
+    const auto skipped = std::min(offset, complete);
+    if (skipped == 0 and eof_) {
+      throw std::runtime_error{"Trying to skip out of bounds!"};
+    }
+    drop_records(skipped);
+    offset -= skipped;
+  }
 }
@@ -5,26 +5,29 @@
 #include <stdexcept>
 #include <memory>
 #include <limits>
+#include <istream>
+#include <cstdint>
 
-#ifdef __PREFETCH
-#include <future>
-#endif
-
-#include "seq/MSA.hpp"
+#include "seq/MSA_Chunk.hpp"
 #include "seq/MSA_Info.hpp"
 #include "io/msa_reader_interface.hpp"
 
-#include "genesis/sequence/formats/fasta_input_iterator.hpp"
+/**
+  Reads a (possibly gzip compressed) FASTA file chunk by chunk. The raw input is read in large
+  blocks and cut at record boundaries, and the records of a chunk are then parsed, uppercased,
+  checked and premasked by several threads at once, keeping their order. Every thread fills a
+  chunk of its own, which are kept across calls along with their storage.
 
+  Reading ahead is left to Prefetching_Reader.
+*/
 class MSA_Stream : public msa_reader {
 public:
-  using container_type = MSA;
-  using file_type = genesis::sequence::FastaInputIterator;
+  using container_type = MSA_Chunk;
 
   MSA_Stream(const std::string& msa_file, const MSA_Info& info, const bool premasking = true,
-             const bool split = false);
+             const bool split = false, const size_t num_threads = 0);
   MSA_Stream() = default;
-  ~MSA_Stream();
+  ~MSA_Stream() = default;
 
   MSA_Stream(MSA_Stream const& other) = delete;
   MSA_Stream(MSA_Stream&& other) = default;
@@ -38,15 +41,22 @@ public:
 
 private:
   void skip_to_sequence(const size_t);
+  void read_chunk(container_type& result, const size_t number);
+  void buffer_records(const size_t number);
+  void drop_records(const size_t number);
 
 private:
   MSA_Info info_;
-  file_type iter_;
-  // container_type active_chunk_;
-  container_type prefetch_chunk_;
-#ifdef __PREFETCH
-  std::future<void> prefetcher_;
-#endif
+  std::unique_ptr<std::istream> file_;
+  bool eof_ = false;
+  // raw input that is yet to be parsed, and the offsets of the records found in it so far
+  std::string buffer_;
+  std::vector<size_t> records_;
+  size_t scanned_ = 0;
+  // byte offsets of all records, if known from an index
+  std::vector<uint64_t> record_offsets_;
+  size_t num_threads_ = 0;
+  std::vector<MSA_Chunk> parts_;
   bool premasking_ = true;
   size_t num_read_ = 0;
   size_t max_read_ = std::numeric_limits<size_t>::max();
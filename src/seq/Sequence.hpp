@@ -2,13 +2,17 @@
 
 #include <string>
 #include <vector>
+#include <utility>
+
+#include "util/Range.hpp"
 
 class Sequence {
 public:
   Sequence() = default;
   ~Sequence() = default;
-  Sequence(std::string header, std::string sequence) : sequence_(sequence) {
-    header_.push_back(header);
+  Sequence(std::string header, std::string sequence, const Range range = Range(0, 0))
+      : sequence_(std::move(sequence)), range_(range) {
+    header_.push_back(std::move(header));
   }
   Sequence(const Sequence& s) = default;
   Sequence(Sequence&& s) = default;
@@ -18,15 +22,20 @@ public:
   Sequence& operator=(Sequence&& s) = default;
   bool operator==(const Sequence& other) { return sequence_.compare(other.sequence()) == 0; }
   bool operator==(const Sequence& other) const { return sequence_.compare(other.sequence()) == 0; }
-  // TODO doesn't merge in the full list (very tailored to the collapse func)
-  void merge(const Sequence& other) { header_.push_back(other.header()); }
+  // takes on the headers of an identical sequence
+  void merge(const Sequence& other) {
+    header_.insert(header_.end(), other.header_.begin(), other.header_.end());
+  }
 
   // member access
   const std::string& header() const { return header_.front(); }
   const std::vector<std::string>& header_list() const { return header_; }
   const std::string& sequence() const { return sequence_; }
+  // the valid range of the sequence if it came precomputed, empty otherwise
+  const Range& range() const { return range_; }
 
 private:
   std::vector<std::string> header_;
   std::string sequence_;
+  Range range_;
 };
@@ -0,0 +1,43 @@
+#include "seq/Sequence_Hash.hpp"
+
+#include <cstring>
+
+static inline uint64_t rotate_left(const uint64_t x, const unsigned int r) {
+  return (x << r) | (x >> (64u - r));
+}
+
+// final mixing step of MurmurHash3
+static inline uint64_t finalize_hash(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+Sequence_Hash hash_sequence(char const* const sites, const size_t size) {
+  constexpr uint64_t P1 = 0x87C37B91114253D5ull;
+  constexpr uint64_t P2 = 0x4CF5AD432745937Full;
+
+  uint64_t a = 0x9E3779B97F4A7C15ull ^ size;
+  uint64_t b = 0xC2B2AE3D27D4EB4Full + size;
+
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, sites + i, 8);
+    a = rotate_left(a ^ (word * P1), 31) * P2;
+    b = rotate_left(b + (word * P2), 27) * P1 + a;
+  }
+
+  uint64_t tail = 0;
+  std::memcpy(&tail, sites + i, size - i);
+  a = rotate_left(a ^ (tail * P1), 31) * P2;
+  b = rotate_left(b + (tail * P2), 27) * P1 + a;
+
+  Sequence_Hash hash;
+  hash.first = finalize_hash(a);
+  hash.second = finalize_hash(b ^ hash.first);
+  return hash;
+}
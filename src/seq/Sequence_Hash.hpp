@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <functional>
+
+/**
+  128 bit hash of the sites of a sequence, used to recognize identical (masked) queries without
+  keeping their sites around. Two lanes are computed a word at a time, with different
+  multipliers, which makes accidental collisions of distinct sequences practically impossible.
+*/
+struct Sequence_Hash {
+  uint64_t first = 0;
+  uint64_t second = 0;
+
+  bool operator==(const Sequence_Hash& other) const {
+    return first == other.first and second == other.second;
+  }
+  bool operator!=(const Sequence_Hash& other) const { return not(*this == other); }
+};
+
+namespace std {
+template <>
+struct hash<Sequence_Hash> {
+  size_t operator()(const Sequence_Hash& h) const { return static_cast<size_t>(h.first); }
+};
+}  // namespace std
+
+Sequence_Hash hash_sequence(char const* const sites, const size_t size);
+
+inline Sequence_Hash hash_sequence(const std::string& sites) {
+  return hash_sequence(sites.data(), sites.size());
+}
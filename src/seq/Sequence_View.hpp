@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <ostream>
+
+#include "seq/Sequence.hpp"
+#include "util/Range.hpp"
+
+/**
+  Non-owning view of a sequence, such as those stored in an MSA_Chunk. The sites are
+  null-terminated, so they can be handed to pll as they are.
+
+  Views of a Sequence are valid as long as the Sequence is, views into an MSA_Chunk until the
+  chunk is changed.
+*/
+class Sequence_View {
+public:
+  Sequence_View(char const* const header, const size_t header_size, char const* const sites,
+                const size_t size, const Range range = Range(0, 0))
+      : header_(header), header_size_(header_size), sites_(sites), size_(size), range_(range) {}
+  Sequence_View(const Sequence& s)
+      : Sequence_View(s.header().c_str(), s.header().size(), s.sequence().c_str(),
+                      s.sequence().size(), s.range()) {}
+  Sequence_View() = delete;
+  ~Sequence_View() = default;
+
+  // member access
+  std::string header() const { return std::string(header_, header_size_); }
+  char const* header_data() const { return header_; }
+  size_t header_size() const { return header_size_; }
+  char const* sites() const { return sites_; }
+  size_t size() const { return size_; }
+  std::string sequence() const { return std::string(sites_, size_); }
+  // the valid range of the sequence if it came precomputed, empty otherwise
+  const Range& range() const { return range_; }
+
+private:
+  char const* header_;
+  size_t header_size_;
+  char const* sites_;
+  size_t size_;
+  Range range_;
+};
+
+// like Sequence, compares the sites only. Also lets a Sequence be compared to a view
+inline bool operator==(const Sequence_View& lhs, const Sequence_View& rhs) {
+  return lhs.size() == rhs.size() and std::memcmp(lhs.sites(), rhs.sites(), lhs.size()) == 0;
+}
+inline bool operator!=(const Sequence_View& lhs, const Sequence_View& rhs) {
+  return not(lhs == rhs);
+}
+
+inline std::ostream& operator<<(std::ostream& out, Sequence_View const& rhs) {
+  out << ">" << rhs.header() << "\n" << rhs.sites();
+  return out;
+}
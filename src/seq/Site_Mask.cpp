@@ -0,0 +1,202 @@
+#include "seq/Site_Mask.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#include "genesis/sequence/functions/functions.hpp"
+#include "genesis/sequence/sequence.hpp"
+
+using word_type = Site_Mask::word_type;
+constexpr size_t Site_Mask::WORD_BITS;
+
+// above this many gap characters, comparing against each of them is slower than a table lookup
+constexpr size_t MAX_COMPARED_GAP_CHARS = 16;
+
+namespace {
+/**
+  The gap characters, as a lookup table and as a list for the vectorized comparisons. They are
+  taken from genesis::sequence::gap_sites itself, so that both always agree.
+*/
+struct Gap_Chars {
+  std::array<bool, 256> is_gap;
+  std::vector<char> chars;
+
+  Gap_Chars() {
+    is_gap.fill(false);
+    std::string ascii(128, '\0');
+    for (size_t c = 0; c < ascii.size(); ++c) {
+      ascii[c] = static_cast<char>(c);
+    }
+    const auto gaps = genesis::sequence::gap_sites(genesis::sequence::Sequence("", ascii));
+    for (size_t c = 0; c < ascii.size(); ++c) {
+      if (gaps[c]) {
+        is_gap[c] = true;
+        chars.push_back(static_cast<char>(c));
+      }
+    }
+  }
+};
+}  // namespace
+
+static Gap_Chars const& gap_chars() {
+  static const Gap_Chars gap_chars;
+  return gap_chars;
+}
+
+static inline word_type low_bits(const size_t n) {
+  return n >= Site_Mask::WORD_BITS ? ~word_type(0) : (word_type(1) << n) - 1;
+}
+
+static inline size_t popcount(const word_type word) {
+  return static_cast<size_t>(__builtin_popcountll(word));
+}
+
+/**
+  Returns the word with bit i set if site i of the n (at most 64) given sites is a gap.
+*/
+static word_type gap_word(char const* const sites, const size_t n, Gap_Chars const& gaps) {
+#ifdef __SSE2__
+  if (n == Site_Mask::WORD_BITS and gaps.chars.size() <= MAX_COMPARED_GAP_CHARS) {
+    __m128i v[4];
+    __m128i hits[4];
+    for (size_t k = 0; k < 4; ++k) {
+      v[k] = _mm_loadu_si128(reinterpret_cast<__m128i const*>(sites + 16 * k));
+      hits[k] = _mm_setzero_si128();
+    }
+    for (auto const c : gaps.chars) {
+      const auto gap = _mm_set1_epi8(c);
+      for (size_t k = 0; k < 4; ++k) {
+        hits[k] = _mm_or_si128(hits[k], _mm_cmpeq_epi8(v[k], gap));
+      }
+    }
+    word_type word = 0;
+    for (size_t k = 0; k < 4; ++k) {
+      word |= static_cast<word_type>(static_cast<uint16_t>(_mm_movemask_epi8(hits[k])))
+              << (16 * k);
+    }
+    return word;
+  }
+#endif
+  word_type word = 0;
+  for (size_t i = 0; i < n; ++i) {
+    word |= static_cast<word_type>(gaps.is_gap[static_cast<unsigned char>(sites[i])]) << i;
+  }
+  return word;
+}
+
+Site_Mask::Site_Mask(const size_t sites, const bool value)
+    : size_(sites), words_((sites + WORD_BITS - 1) / WORD_BITS, value ? ~word_type(0) : 0) {
+  // keep the bits past the last site unset
+  if (value and (sites % WORD_BITS)) {
+    words_.back() = low_bits(sites % WORD_BITS);
+  }
+}
+
+Site_Mask::Site_Mask(const genesis::utils::Bitvector& mask) : Site_Mask(mask.size()) {
+  for (size_t i = 0; i < size_; ++i) {
+    if (mask[i]) {
+      words_[i / WORD_BITS] |= word_type(1) << (i % WORD_BITS);
+    }
+  }
+}
+
+size_t Site_Mask::count() const {
+  size_t count = 0;
+  for (auto const word : words_) {
+    count += popcount(word);
+  }
+  return count;
+}
+
+genesis::utils::Bitvector Site_Mask::to_bitvector() const {
+  genesis::utils::Bitvector mask(size_, false);
+  for (size_t w = 0; w < words_.size(); ++w) {
+    for (auto word = words_[w]; word; word &= word - 1) {
+      mask.set(w * WORD_BITS + __builtin_ctzll(word));
+    }
+  }
+  return mask;
+}
+
+void Site_Mask::and_gap_sites(char const* const sequence, const size_t length) {
+  if (length != size_) {
+    throw std::runtime_error{"In Site_Mask: mask and sequence incompatible"};
+  }
+
+  auto const& gaps = gap_chars();
+  for (size_t w = 0; w < words_.size(); ++w) {
+    // once a word has no gap sites left, no sequence can add any
+    if (words_[w]) {
+      const auto begin = w * WORD_BITS;
+      words_[w] &= gap_word(sequence + begin, std::min(WORD_BITS, size_ - begin), gaps);
+    }
+  }
+}
+
+Site_Mask& Site_Mask::operator&=(const Site_Mask& other) {
+  if (other.size_ != size_) {
+    throw std::runtime_error{"In Site_Mask: masks of different size"};
+  }
+  for (size_t w = 0; w < words_.size(); ++w) {
+    words_[w] &= other.words_[w];
+  }
+  return *this;
+}
+
+Site_Mask& Site_Mask::operator|=(const Site_Mask& other) {
+  if (other.size_ != size_) {
+    throw std::runtime_error{"In Site_Mask: masks of different size"};
+  }
+  for (size_t w = 0; w < words_.size(); ++w) {
+    words_[w] |= other.words_[w];
+  }
+  return *this;
+}
+
+void Site_Mask::apply(char const* const sequence, char* result) const {
+  for (size_t w = 0; w < words_.size(); ++w) {
+    const auto begin = w * WORD_BITS;
+    const auto n = std::min(WORD_BITS, size_ - begin);
+    auto keep = ~words_[w] & low_bits(n);
+    char const* const sites = sequence + begin;
+
+    // runs of unmasked sites are common, and copied as a whole
+    if (keep == low_bits(n)) {
+      std::memcpy(result, sites, n);
+      result += n;
+      continue;
+    }
+
+#ifdef __BMI2__
+    // compress eight sites at a time, selecting the bytes of the kept ones
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const auto keep8 = (keep >> i) & 0xFF;
+      if (not keep8) {
+        continue;
+      }
+      uint64_t chunk;
+      std::memcpy(&chunk, sites + i, 8);
+      const uint64_t bytes = _pdep_u64(keep8, 0x0101010101010101ull) * 0xFF;
+      const uint64_t packed = _pext_u64(chunk, bytes);
+      const auto kept = popcount(keep8);
+      std::memcpy(result, &packed, kept);
+      result += kept;
+    }
+    keep &= ~low_bits(i);
+#endif
+
+    for (; keep; keep &= keep - 1) {
+      *result++ = sites[__builtin_ctzll(keep)];
+    }
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "genesis/utils/math/bitvector.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+  A mask over the sites of an alignment, packed into 64 bit words: bit i % 64 of word i / 64 is
+  set if site i is masked out (as in MSA_Info::gap_mask).
+
+  Unlike the genesis Bitvector, which only gives access to single bits, this lets masking and
+  gap detection work on a word of sites at a time, which matters for wide alignments.
+*/
+class Site_Mask {
+public:
+  using word_type = uint64_t;
+  static constexpr size_t WORD_BITS = 64;
+
+  Site_Mask() = default;
+  explicit Site_Mask(const size_t sites, const bool value = false);
+  explicit Site_Mask(const genesis::utils::Bitvector& mask);
+
+  ~Site_Mask() = default;
+
+  size_t size() const { return size_; }
+  // number of masked out sites
+  size_t count() const;
+  const std::vector<word_type>& words() const { return words_; }
+
+  genesis::utils::Bitvector to_bitvector() const;
+
+  /**
+    Masks out every site at which the sequence does not have a gap, such that starting from an
+    all-set mask, only the sites that are gaps in all added sequences remain set. Gap characters
+    are those of genesis::sequence::gap_sites.
+  */
+  void and_gap_sites(char const* const sequence, const size_t length);
+  void and_gap_sites(const std::string& sequence) {
+    and_gap_sites(sequence.data(), sequence.size());
+  }
+
+  Site_Mask& operator&=(const Site_Mask& other);
+  Site_Mask& operator|=(const Site_Mask& other);
+  bool operator==(const Site_Mask& other) const {
+    return size_ == other.size_ and words_ == other.words_;
+  }
+
+  /**
+    Copies the sites of the sequence that are not masked out to result, which needs room for
+    size() - count() characters.
+  */
+  void apply(char const* const sequence, char* result) const;
+
+private:
+  size_t size_ = 0;
+  std::vector<word_type> words_;
+};
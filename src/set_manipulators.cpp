@@ -6,6 +6,8 @@
 #include <iterator>
 #include <cmath>
 
+#include "seq/Sequence_Hash.hpp"
+
 void split(const Work& src, std::vector<Work>& parts, const unsigned int num_parts) {
   parts.clear();
   // ensure that there are actually as many parts as specified. We want empty parts to enable null
@@ -40,11 +42,12 @@ void merge(Work& dest, const Work& src) {
 
 void merge(Timer<>& dest, const Timer<>& src) { dest.insert(dest.end(), src.begin(), src.end()); }
 
-void compute_and_set_lwr(Sample<Placement>& sample) {
+void compute_and_set_lwr(Sample<Placement>& sample, const size_t num_pquerys) {
+  const size_t size = std::min(num_pquerys, static_cast<size_t>(sample.size()));
 #ifdef __OMP
 #pragma omp parallel for schedule(dynamic)
 #endif
-  for (size_t j = 0; j < sample.size(); ++j) {
+  for (size_t j = 0; j < size; ++j) {
     auto& pq = sample[j];
     double total = 0.0;
 
@@ -54,20 +57,59 @@ void compute_and_set_lwr(Sample<Placement>& sample) {
           return (lhs.likelihood() < rhs.likelihood());
         })->likelihood();
 
-    std::vector<double> exp_lh(pq.size());
-    // get the distances to the max
+    // get the distances to the max, kept in the lwr until normalized
     for (size_t i = 0; i < pq.size(); ++i) {
-      exp_lh[i] = std::exp(pq[i].likelihood() - max);
-      total += exp_lh[i];
+      pq[i].lwr(std::exp(pq[i].likelihood() - max));
+      total += pq[i].lwr();
     }
 
     // normalize the distances
     for (size_t i = 0; i < pq.size(); ++i) {
-      pq[i].lwr(exp_lh[i] / total);
+      pq[i].lwr(pq[i].lwr() / total);
     }
   }
 }
 
+void compute_lwr(double const* const logl, double* const lwr, const size_t n) {
+  if (not n) {
+    return;
+  }
+
+  double max = logl[0];
+  for (size_t i = 1; i < n; ++i) {
+    max = std::max(max, logl[i]);
+  }
+
+  double total = 0.0;
+#ifdef __OMP
+#pragma omp simd reduction(+ : total)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    lwr[i] = std::exp(logl[i] - max);
+    total += lwr[i];
+  }
+
+#ifdef __OMP
+#pragma omp simd
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    lwr[i] /= total;
+  }
+}
+
+void compute_and_set_lwr(Columnar_Sample& sample) {
+  auto const logl = sample.likelihoods().data();
+  auto const lwr = sample.lwrs().data();
+
+#ifdef __OMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+  for (size_t q = 0; q < sample.size(); ++q) {
+    const auto begin = sample.begin(q);
+    compute_lwr(logl + begin, lwr + begin, sample.num_placements(q));
+  }
+}
+
 void sort_by_lwr(PQuery<Placement>& pq) {
   sort(pq.begin(), pq.end(),
        [](const Placement& p_a, const Placement& p_b) -> bool { return p_a.lwr() > p_b.lwr(); });
@@ -189,7 +231,124 @@ void discard_by_accumulated_threshold(Sample<Placement>& sample, const double th
   }
 }
 
-void filter(Sample<Placement>& sample, const Options& options) {
+// sorts the first k of the n placements by descending LWR
+static void top_by_lwr(double const* const lwr, uint32_t* const order, const size_t k,
+                       const size_t n) {
+  std::partial_sort(order, order + k, order + n,
+                    [lwr](const uint32_t lhs, const uint32_t rhs) { return lwr[lhs] > lwr[rhs]; });
+}
+
+size_t select_by_support_threshold(double const* const lwr, uint32_t* const order, const size_t n,
+                                   const double thresh, const size_t min, const size_t max) {
+  size_t num_kept = 0;
+  for (size_t i = 0; i < n; ++i) {
+    num_kept += lwr[i] > thresh;
+  }
+  num_kept = std::max(num_kept, min);
+  if (max) {
+    num_kept = std::min(num_kept, max);
+  }
+  num_kept = std::min(num_kept, n);
+
+  top_by_lwr(lwr, order, num_kept, n);
+  return num_kept;
+}
+
+size_t select_by_accumulated_threshold(double const* const lwr, uint32_t* const order,
+                                       const size_t n, const double thresh, const size_t min,
+                                       const size_t max) {
+  const auto num_sorted = std::min(max, n);
+  top_by_lwr(lwr, order, num_sorted, n);
+
+  double sum = 0.0;
+  size_t num_kept = 0;
+  while (num_kept < num_sorted and sum < thresh) {
+    sum += lwr[order[num_kept++]];
+  }
+  // the same lower bound as until_accumulated_reached
+  return std::min(std::max(num_kept, min - 1), n);
+}
+
+size_t select_by_filter(double const* const lwr, uint32_t* const order, const size_t n,
+                        const Options& options) {
+  if (options.acc_threshold) {
+    return select_by_accumulated_threshold(lwr, order, n, options.support_threshold,
+                                           options.filter_min, options.filter_max);
+  }
+  return select_by_support_threshold(lwr, order, n, options.support_threshold, options.filter_min,
+                                     options.filter_max);
+}
+
+static void check_support_threshold(const double thresh, const size_t min) {
+  if (thresh < 0.0 or thresh > 1.0) {
+    throw std::range_error{"thresh is not a valid likelihood weight ratio (outside of [0,1])"};
+  }
+  if (min < 1) {
+    throw std::range_error{"Filter min cannot be smaller than 1!"};
+  }
+}
+
+static void check_accumulated_threshold(const double thresh, const size_t min, const size_t max) {
+  check_support_threshold(thresh, min);
+  if (min > max) {
+    throw std::range_error{"Filter min cannot be smaller than max!"};
+  }
+}
+
+void check_filter(const Options& options) {
+  if (options.acc_threshold) {
+    check_accumulated_threshold(options.support_threshold, options.filter_min,
+                                options.filter_max);
+  } else {
+    check_support_threshold(options.support_threshold, options.filter_min);
+  }
+}
+
+/**
+  Filters the placements of every query by LWR. For each query, select gets its LWRs, the indices
+  of its placements and their number. It moves the indices of the placements to keep to the
+  front, by descending LWR, and returns how many those are.
+*/
+template <class F>
+static void select_by_lwr(Columnar_Sample& sample, F select) {
+  std::vector<uint32_t> selection(sample.num_placements());
+  std::vector<size_t> counts(sample.size());
+  auto const lwrs = sample.lwrs().data();
+
+#ifdef __OMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+  for (size_t q = 0; q < sample.size(); ++q) {
+    const auto begin = sample.begin(q);
+    const auto n = sample.num_placements(q);
+    auto const order = selection.data() + begin;
+    for (size_t i = 0; i < n; ++i) {
+      order[i] = static_cast<uint32_t>(i);
+    }
+    counts[q] = select(lwrs + begin, order, n);
+  }
+
+  sample.select(selection, counts);
+}
+
+void discard_by_support_threshold(Columnar_Sample& sample, const double thresh, const size_t min,
+                                  const size_t max) {
+  check_support_threshold(thresh, min);
+  select_by_lwr(sample, [=](double const* const lwr, uint32_t* const order, const size_t n) {
+    return select_by_support_threshold(lwr, order, n, thresh, min, max);
+  });
+}
+
+void discard_by_accumulated_threshold(Columnar_Sample& sample, const double thresh,
+                                      const size_t min, const size_t max) {
+  check_accumulated_threshold(thresh, min, max);
+  select_by_lwr(sample, [=](double const* const lwr, uint32_t* const order, const size_t n) {
+    return select_by_accumulated_threshold(lwr, order, n, thresh, min, max);
+  });
+}
+
+template <class T>
+static void filter_(T& sample, const Options& options) {
   if (options.acc_threshold) {
     LOG_DBG << "Filtering output by accumulated threshold: " << options.support_threshold
             << std::endl;
@@ -203,24 +362,28 @@ void filter(Sample<Placement>& sample, const Options& options) {
   }
 }
 
+void filter(Sample<Placement>& sample, const Options& options) { filter_(sample, options); }
+
+void filter(Columnar_Sample& sample, const Options& options) { filter_(sample, options); }
+
 /* Find duplicate sequences in a MSA and collapse them into one entry that
-  holds all respective headers */
+  holds all respective headers. Keeps the order of the first occurrences */
 void find_collapse_equal_sequences(MSA& msa) {
-  auto end_merge_range = msa.end();
-  auto begin_merge_range = end_merge_range;
-  for (auto target_iter = msa.begin(); target_iter != end_merge_range; target_iter++) {
-    auto target = *target_iter;
-    begin_merge_range = partition(target_iter + 1, end_merge_range,
-                                  [&target](const Sequence& query) { return !(target == query); });
-    // now all sequences in the msa that are equal to the "target" are at the end of the msa
-    // whose first element is *begin_merge_range
-    for (auto merge_iter = begin_merge_range; merge_iter != end_merge_range; merge_iter++) {
-      (*target_iter).merge((*merge_iter));
+  std::unordered_map<Sequence_Hash, MSA::iterator> first_occurrence;
+  auto keep = msa.begin();
+  for (auto it = msa.begin(); it != msa.end(); ++it) {
+    const auto hash = hash_sequence(it->sequence());
+    const auto first = first_occurrence.find(hash);
+    if (first != first_occurrence.end()) {
+      first->second->merge(*it);
+      continue;
     }
-
-    end_merge_range = begin_merge_range;
+    if (keep != it) {
+      *keep = std::move(*it);
+    }
+    first_occurrence.emplace(hash, keep);
+    ++keep;
   }
-  // merging done: all redundant sequences are at the back of msa, starting at end_merge_range
-  // cleanup:
-  msa.erase(end_merge_range, msa.end());
+  // all redundant sequences were merged, the tail holds their moved-from leftovers
+  msa.erase(keep, msa.end());
 }
@@ -5,6 +5,7 @@
 #include <limits>
 
 #include "sample/Sample.hpp"
+#include "sample/Columnar_Sample.hpp"
 #include "util/Timer.hpp"
 #include "util/Options.hpp"
 #include "util/logging.hpp"
@@ -19,7 +20,9 @@ void merge(Timer<>& dest, const Timer<>& src);
 
 void sort_by_lwr(PQuery<Placement>& pq);
 void sort_by_logl(PQuery<Placement>& pq);
-void compute_and_set_lwr(Sample<Placement>& sample);
+// of the first num_pquerys pquerys of the sample
+void compute_and_set_lwr(Sample<Placement>& sample,
+                         const size_t num_pquerys = std::numeric_limits<size_t>::max());
 pq_iter_t until_top_percent(PQuery<Placement>& pq, const double x);
 void discard_bottom_x_percent(Sample<Placement>& sample, const double x);
 void discard_by_support_threshold(Sample<Placement>& sample, const double thresh,
@@ -35,6 +38,32 @@ void discard_by_accumulated_threshold(Sample<Placement>& sample, const double th
                                       const size_t min = 1,
                                       const size_t max = std::numeric_limits<size_t>::max());
 void filter(Sample<Placement>& sample, const Options& options);
+
+// the same for the columnar representation
+void compute_and_set_lwr(Columnar_Sample& sample);
+void discard_by_support_threshold(Columnar_Sample& sample, const double thresh,
+                                  const size_t min = 1,
+                                  const size_t max = std::numeric_limits<size_t>::max());
+void discard_by_accumulated_threshold(Columnar_Sample& sample, const double thresh,
+                                      const size_t min = 1,
+                                      const size_t max = std::numeric_limits<size_t>::max());
+void filter(Columnar_Sample& sample, const Options& options);
+
+/**
+  The per query steps of the above, on the n placements of a query: compute_lwr sets the LWRs from
+  the likelihoods, the select functions move the indices (into the LWRs) of the placements to keep
+  to the front of order, by descending LWR, and return how many those are. check_filter throws
+  for options the filters do not accept.
+*/
+void compute_lwr(double const* const logl, double* const lwr, const size_t n);
+size_t select_by_support_threshold(double const* const lwr, uint32_t* const order, const size_t n,
+                                   const double thresh, const size_t min, const size_t max);
+size_t select_by_accumulated_threshold(double const* const lwr, uint32_t* const order,
+                                       const size_t n, const double thresh, const size_t min,
+                                       const size_t max);
+size_t select_by_filter(double const* const lwr, uint32_t* const order, const size_t n,
+                        const Options& options);
+void check_filter(const Options& options);
 void find_collapse_equal_sequences(MSA& msa);
 
 /**
@@ -77,7 +77,8 @@ Tiny_Tree::Tiny_Tree(pll_unode_t* edge_node, const unsigned int branch_id, Tree&
       make_tiny_tree_structure(old_proximal, old_distal, tip_tip_case), utree_destroy);
 
   partition_ = std::unique_ptr<pll_partition_t, partition_deleter>(
-      make_tiny_partition(reference_tree, tree_.get(), old_proximal, old_distal, tip_tip_case),
+      make_tiny_partition(reference_tree, tree_.get(), old_proximal, old_distal, tip_tip_case,
+                          &proximal_pin_, &distal_pin_),
       tiny_partition_destroy);
 
   // operation for computing the clv toward the new tip (for initialization and logl in non-blo
@@ -125,10 +126,11 @@ Tiny_Tree::Tiny_Tree(pll_unode_t* edge_node, const unsigned int branch_id, Tree&
       }
       lookup_store->init_branch(branch_id, precomputed_sites);
     }
+    lookup_pin_ = lookup_store->pin(branch_id);
   }
 }
 
-Placement Tiny_Tree::place(const Sequence& s) {
+Placement Tiny_Tree::place(const Sequence_View& s) {
   assert(partition_);
   assert(tree_);
 
@@ -142,14 +144,15 @@ Placement Tiny_Tree::place(const Sequence& s) {
   double logl = 0.0;
   std::vector<unsigned int> param_indices(partition_->rate_cats, 0);
 
-  if (s.sequence().size() != partition_->sites) {
+  if (s.size() != partition_->sites) {
     throw std::runtime_error{"Query sequence length not same as reference alignment!"};
   }
 
   Range range(0, partition_->sites);
 
   if (premasking_) {
-    range = get_valid_range(s.sequence());
+    // bfast input comes with the range precomputed
+    range = s.range() ? s.range() : get_valid_range(s.sites(), s.size());
     if (not range) {
       throw std::runtime_error{std::string() + "Sequence with header '" + s.header() +
                                "' does not appear to have any non-gap sites!"};
@@ -161,7 +164,7 @@ Placement Tiny_Tree::place(const Sequence& s) {
 
     // init the new tip with s.sequence(), branch length
     auto err_check = pll_set_tip_states(partition_.get(), new_tip->clv_index,
-                                        get_char_map(partition_.get()), s.sequence().c_str());
+                                        get_char_map(partition_.get()), s.sites());
 
     if (err_check == PLL_FAILURE) {
       throw std::runtime_error{"Set tip states during placement failed!"};
@@ -203,7 +206,7 @@ Placement Tiny_Tree::place(const Sequence& s) {
     pll_update_partials(partition_.get(), &op, 1);
 
   } else {
-    logl = lookup_->sum_precomputed_sitelk(branch_id_, s.sequence(), range);
+    logl = lookup_->sum_precomputed_sitelk(branch_id_, s, range);
   }
 
   if (logl == -std::numeric_limits<double>::infinity()) {
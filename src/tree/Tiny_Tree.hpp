@@ -4,7 +4,7 @@
 #include <unordered_map>
 
 #include "core/pll/pllhead.hpp"
-#include "seq/Sequence.hpp"
+#include "seq/Sequence_View.hpp"
 #include "util/constants.hpp"
 #include "util/Options.hpp"
 #include "sample/Placement.hpp"
@@ -43,7 +43,7 @@ public:
   Tiny_Tree& operator=(Tiny_Tree const& other) = delete;
   Tiny_Tree& operator=(Tiny_Tree&& other) = default;
 
-  Placement place(const Sequence& s);
+  Placement place(const Sequence_View& s);
 
 private:
   // pll structures
@@ -57,4 +57,9 @@ private:
   unsigned int branch_id_;
 
   std::shared_ptr<Lookup_Store> lookup_;
+
+  // keep the shared reference buffers in memory while this tree uses them
+  Memory_Budget::Pin proximal_pin_;
+  Memory_Budget::Pin distal_pin_;
+  Memory_Budget::Pin lookup_pin_;
 };
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <cstdio>
 #include <numeric>
+#include <algorithm>
 
 #include "core/pll/epa_pll_util.hpp"
 #include "io/file_io.hpp"
@@ -14,7 +15,7 @@
 #include "util/stringify.hpp"
 
 Tree::Tree(const std::string& tree_file, const MSA& msa, raxml::Model& model,
-           const Options& options)
+           const Options& options, Store_Writer* writer)
     : ref_msa_(msa), model_(model), options_(options) {
   try {
     tree_ = utree_ptr(build_tree_from_file(tree_file, nums_, mapper_, options.preserve_rooting),
@@ -35,6 +36,7 @@ Tree::Tree(const std::string& tree_file, const MSA& msa, raxml::Model& model,
                              pll_partition_destroy);
 
   locks_ = Mutex_List(partition_->tips + partition_->clv_buffers);
+  init_budget();
 
   link_tree_msa(tree_.get(), partition_.get(), model_, ref_msa_, nums_.tip_nodes);
 
@@ -44,7 +46,16 @@ Tree::Tree(const std::string& tree_file, const MSA& msa, raxml::Model& model,
   LOG_INFO << model_;
   LOG_DBG << "Tree length: " << sum_branch_lengths(tree_.get());
 
-  precompute_clvs(tree_.get(), partition_.get(), nums_);
+  // stream the CLVs to the binary store as they are computed
+  clv_callback on_computed = nullptr;
+  if (writer) {
+    writer->begin(tree_.get(), partition_.get());
+    on_computed = [writer, this](const unsigned int clv_index) {
+      writer->write_clv(partition_.get(), clv_index);
+    };
+  }
+
+  precompute_clvs(tree_.get(), partition_.get(), nums_, options_.num_threads, on_computed);
 
   auto logl = this->ref_tree_logl();
 
@@ -65,6 +76,7 @@ Tree::Tree(const std::string& bin_file, raxml::Model& model, const Options& opti
   nums_ = Tree_Numbers(partition_->tips);
   tree_ = utree_ptr(binary_.load_utree(partition_->tips), utree_destroy);
   locks_ = Mutex_List(partition_->tips + partition_->clv_buffers);
+  init_budget();
 
   raxml::assign(model_, partition_.get());
   LOG_DBG << model_;
@@ -72,16 +84,139 @@ Tree::Tree(const std::string& bin_file, raxml::Model& model, const Options& opti
   LOG_DBG << "Reference tree log-likelihood: " << std::to_string(this->ref_tree_logl());
 }
 
+Tree::~Tree() {
+  // buffers served from a mapped binary file must not be freed by pll_partition_destroy
+  binary_.unmap_partition(partition_.get());
+}
+
+Tree::Tree(Tree&& other)
+    : partition_(std::move(other.partition_)),
+      tree_(std::move(other.tree_)),
+      nums_(std::move(other.nums_)),
+      ref_msa_(std::move(other.ref_msa_)),
+      model_(std::move(other.model_)),
+      options_(std::move(other.options_)),
+      binary_(std::move(other.binary_)),
+      mapper_(std::move(other.mapper_)),
+      locks_(std::move(other.locks_)),
+      budget_(std::move(other.budget_)),
+      budget_pool_(other.budget_pool_),
+      clv_scaler_(std::move(other.clv_scaler_)) {
+  bind_budget();
+}
+
+Tree& Tree::operator=(Tree&& other) {
+  if (this != &other) {
+    binary_.unmap_partition(partition_.get());
+    partition_ = std::move(other.partition_);
+    tree_ = std::move(other.tree_);
+    nums_ = std::move(other.nums_);
+    ref_msa_ = std::move(other.ref_msa_);
+    model_ = std::move(other.model_);
+    options_ = std::move(other.options_);
+    binary_ = std::move(other.binary_);
+    mapper_ = std::move(other.mapper_);
+    locks_ = std::move(other.locks_);
+    budget_ = std::move(other.budget_);
+    budget_pool_ = other.budget_pool_;
+    clv_scaler_ = std::move(other.clv_scaler_);
+    bind_budget();
+  }
+  return *this;
+}
+
+/**
+  Sets up the memory budget, if one was requested. Only buffers that can be reloaded from a binary
+  file are subject to eviction, so the reference CLVs only take part in out-of-core mode.
+*/
+void Tree::init_budget() {
+  if (not options_.max_memory) {
+    return;
+  }
+
+  budget_ = std::make_unique<Memory_Budget>(options_.max_memory);
+
+  if (not options_.load_binary_mode) {
+    return;
+  }
+
+  // remember which scaler is loaded alongside each CLV
+  clv_scaler_.assign(locks_.size(), PLL_SCALE_BUFFER_NONE);
+  for (size_t i = 0; i < tree_->tip_count + tree_->inner_count; ++i) {
+    auto node = tree_->nodes[i];
+    do {
+      clv_scaler_[node->clv_index] = node->scaler_index;
+      node = node->next;
+    } while (node and node != tree_->nodes[i]);
+  }
+
+  budget_pool_ = budget_->add_pool(locks_.size(), nullptr);
+  bind_budget();
+}
+
+void Tree::bind_budget() {
+  if (budget_ and not clv_scaler_.empty()) {
+    budget_->rebind_pool(budget_pool_, [this](const size_t i) { return this->evict_clv(i); });
+  }
+}
+
+/**
+  Frees the buffers loaded for the given CLV index, or lets the kernel drop their pages if they are
+  mapped. Refuses if the buffers are currently being loaded.
+*/
+bool Tree::evict_clv(const size_t clv_index) {
+  const auto scaler = clv_scaler_[clv_index];
+
+  if (binary_.zero_copy()) {
+    binary_.discard(partition_.get(), clv_index, scaler);
+    return true;
+  }
+
+  std::unique_lock<std::mutex> lock(locks_[clv_index], std::try_to_lock);
+  if (not lock) {
+    return false;
+  }
+
+  // with a compact store only some of the buffers are expanded copies
+  auto partition = partition_.get();
+  if ((partition->attributes & PLL_ATTRIB_PATTERN_TIP) and clv_index < partition->tips) {
+    if (not binary_.contains(partition->tipchars[clv_index])) {
+      free(partition->tipchars[clv_index]);
+      partition->tipchars[clv_index] = nullptr;
+    }
+  } else if (not binary_.contains(partition->clv[clv_index])) {
+    pll_aligned_free(partition->clv[clv_index]);
+    partition->clv[clv_index] = nullptr;
+  }
+
+  if (scaler != PLL_SCALE_BUFFER_NONE and not binary_.contains(partition->scale_buffer[scaler])) {
+    free(partition->scale_buffer[scaler]);
+    partition->scale_buffer[scaler] = nullptr;
+  }
+
+  binary_.discard(partition, clv_index, scaler);
+
+  return true;
+}
+
 /**
   Returns a pointer either to the CLV or tipchar buffer, depending on the index.
   If they are not currently in memory, fetches them from file.
   Ensures that associated scalers are allocated and ready on return.
+
+  Under a memory budget, buffers may be evicted again once they are no longer pinned. Callers
+  that hold on to the returned buffer should therefore pass a pin, which keeps the buffer and
+  its scaler in memory for as long as it lives.
 */
-void* Tree::get_clv(const pll_unode_t* node) {
+void* Tree::get_clv(const pll_unode_t* node, Memory_Budget::Pin* pin) {
   const auto i = node->clv_index;
 
-  // prevent race condition from concurrent access to this function
-  Scoped_Mutex lock_by_clv_id(locks_[i]);
+  // prevent race condition from concurrent access to this function. Not needed if all buffers
+  // are in memory from the start, as is the case with a memory mapped binary file
+  std::unique_lock<std::mutex> lock_by_clv_id(locks_[i], std::defer_lock);
+  if (options_.load_binary_mode and not binary_.zero_copy()) {
+    lock_by_clv_id.lock();
+  }
 
   const auto scaler = node->scaler_index;
   const bool use_tipchars = partition_->attributes & PLL_ATTRIB_PATTERN_TIP;
@@ -113,15 +248,60 @@ void* Tree::get_clv(const pll_unode_t* node) {
     binary_.load_scaler(partition_.get(), scaler);
   }
 
+  if (budget_ and not clv_scaler_.empty()) {
+    size_t bytes = (use_tipchars and i < partition_->tips)
+                       ? partition_->sites * sizeof(unsigned char)
+                       : pll_get_clv_size(partition_.get(), i) * sizeof(double);
+    if (clv_scaler_[i] != PLL_SCALE_BUFFER_NONE) {
+      bytes += pll_get_sites_number(partition_.get(), i) * sizeof(unsigned int);
+    }
+    auto entry_pin = budget_->acquire(budget_pool_, i, bytes);
+    if (pin) {
+      *pin = std::move(entry_pin);
+    }
+  }
+
   return clv_ptr;
 }
 
+/**
+  Ensures the buffers of the given nodes are loaded ahead of their use. For a memory mapped binary
+  file the reads are left to the kernel, otherwise a background thread loads the buffers in the
+  order in which they lie in the file.
+  The returned future is ready once all buffers are loaded, and rethrows any error of loading them.
+  Buffers that are requested from the placement threads in the meantime are simply loaded by
+  whichever comes first.
+  Under a memory budget the background thread is skipped: the buffers it loads are not pinned, so
+  it would only evict those that the placement threads just loaded.
+*/
+std::future<void> Tree::prefetch(std::vector<pll_unode_t const*> nodes) {
+  if (not options_.load_binary_mode or binary_.zero_copy() or budget_) {
+    binary_.prefetch(partition_.get(), nodes);
+    std::promise<void> done;
+    done.set_value();
+    return done.get_future();
+  }
+
+  // the file holds the buffers in order of their clv_index, followed by the scalers
+  std::sort(nodes.begin(), nodes.end(), [](pll_unode_t const* lhs, pll_unode_t const* rhs) {
+    return lhs->clv_index < rhs->clv_index;
+  });
+
+  return std::async(std::launch::async, [this, nodes]() {
+    for (auto const node : nodes) {
+      this->get_clv(node);
+    }
+  });
+}
+
 double Tree::ref_tree_logl() {
   std::vector<unsigned int> param_indices(partition_->rate_cats, 0);
   const auto root = get_root(tree_.get());
-  // ensure clvs are there
-  this->get_clv(root);
-  this->get_clv(root->back);
+  // ensure clvs are there, and stay there under a memory budget
+  Memory_Budget::Pin root_pin;
+  Memory_Budget::Pin back_pin;
+  this->get_clv(root, &root_pin);
+  this->get_clv(root->back, &back_pin);
 
   auto logl = pll_compute_edge_loglikelihood(partition_.get(), root->clv_index, root->scaler_index,
                                              root->back->clv_index, root->back->scaler_index,
@@ -3,12 +3,14 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <future>
 
 #include "seq/MSA.hpp"
 #include "core/raxml/Model.hpp"
 #include "tree/Tree_Numbers.hpp"
 #include "util/Options.hpp"
 #include "io/Binary.hpp"
+#include "util/Memory_Budget.hpp"
 #include "core/pll/pllhead.hpp"
 #include "core/pll/pll_util.hpp"
 #include "core/pll/rtree_mapper.hpp"
@@ -21,16 +23,17 @@ public:
   using partition_ptr = std::unique_ptr<pll_partition_t, partition_deleter>;
   using utree_ptr = std::unique_ptr<pll_utree_t, utree_deleter>;
 
-  Tree(const std::string& tree_file, const MSA& msa, raxml::Model& model, const Options& options);
+  Tree(const std::string& tree_file, const MSA& msa, raxml::Model& model, const Options& options,
+       Store_Writer* writer = nullptr);
   Tree(const std::string& bin_file, raxml::Model& model, const Options& options);
   Tree() = default;
-  ~Tree() = default;
+  ~Tree();
 
   Tree(Tree const& other) = delete;
-  Tree(Tree&& other) = default;
+  Tree(Tree&& other);
 
   Tree& operator=(Tree const& other) = delete;
-  Tree& operator=(Tree&& other) = default;
+  Tree& operator=(Tree&& other);
 
   // member access
   Tree_Numbers& nums() { return nums_; }
@@ -39,12 +42,18 @@ public:
   auto partition() { return partition_.get(); }
   auto tree() { return tree_.get(); }
   rtree_mapper& mapper() { return mapper_; }
+  Memory_Budget* budget() { return budget_.get(); }
 
-  void* get_clv(const pll_unode_t*);
+  void* get_clv(const pll_unode_t*, Memory_Budget::Pin* pin = nullptr);
+  std::future<void> prefetch(std::vector<pll_unode_t const*> nodes);
 
   double ref_tree_logl();
 
 private:
+  void init_budget();
+  void bind_budget();
+  bool evict_clv(const size_t clv_index);
+
   // pll structures
 
   partition_ptr partition_{nullptr, pll_partition_destroy};
@@ -63,4 +72,9 @@ private:
 
   // thread safety
   Mutex_List locks_;
+
+  // out-of-core memory limit, only set if requested
+  std::unique_ptr<Memory_Budget> budget_;
+  size_t budget_pool_ = 0;
+  std::vector<unsigned int> clv_scaler_;
 };
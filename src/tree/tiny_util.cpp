@@ -71,7 +71,9 @@ static void deep_copy_repeats(pll_partition_t* dest_part, pll_unode_t* dest_node
 
 pll_partition_t* make_tiny_partition(Tree& reference_tree, const pll_utree_t* tree,
                                      pll_unode_t const* const old_proximal,
-                                     pll_unode_t const* const old_distal, const bool tip_tip_case) {
+                                     pll_unode_t const* const old_distal, const bool tip_tip_case,
+                                     Memory_Budget::Pin* proximal_pin,
+                                     Memory_Budget::Pin* distal_pin) {
   /**
     As we work with PLL_PATTERN_TIP functionality, special care has to be taken in regards to the
     node and partition structure: PLL assumes that any node with clv index < number of tips is in
@@ -106,57 +108,13 @@ pll_partition_t* make_tiny_partition(Tree& reference_tree, const pll_utree_t* tr
     throw std::runtime_error{std::string(pll_errmsg)};
   }
 
-  unsigned int i;
-  free(tiny->rates);
-  tiny->rates = old_partition->rates;
-  if (tiny->subst_params) {
-    for (i = 0; i < tiny->rate_matrices; ++i) {
-      pll_aligned_free(tiny->subst_params[i]);
-    }
-  }
-  free(tiny->subst_params);
-  tiny->subst_params = old_partition->subst_params;
-  if (tiny->frequencies) {
-    for (i = 0; i < tiny->rate_matrices; ++i) {
-      pll_aligned_free(tiny->frequencies[i]);
-    }
-  }
-  free(tiny->frequencies);
-  tiny->frequencies = old_partition->frequencies;
-  if (tiny->eigenvecs) {
-    for (i = 0; i < tiny->rate_matrices; ++i) {
-      pll_aligned_free(tiny->eigenvecs[i]);
-    }
-  }
-  free(tiny->eigenvecs);
-  tiny->eigenvecs = old_partition->eigenvecs;
-  if (tiny->inv_eigenvecs) {
-    for (i = 0; i < tiny->rate_matrices; ++i) {
-      pll_aligned_free(tiny->inv_eigenvecs[i]);
-    }
-  }
-  free(tiny->inv_eigenvecs);
-  tiny->inv_eigenvecs = old_partition->inv_eigenvecs;
-  if (tiny->eigenvals) {
-    for (i = 0; i < tiny->rate_matrices; ++i) {
-      pll_aligned_free(tiny->eigenvals[i]);
-    }
-  }
-  free(tiny->eigenvals);
-  tiny->eigenvals = old_partition->eigenvals;
-
-  if (tiny->prop_invar) {
-    free(tiny->prop_invar);
-  }
-  tiny->prop_invar = old_partition->prop_invar;
+  share_model_buffers(tiny, old_partition);
 
   if (tiny->invariant) {
     free(tiny->invariant);
   }
   tiny->invariant = old_partition->invariant;
 
-  free(tiny->eigen_decomp_valid);
-  tiny->eigen_decomp_valid = old_partition->eigen_decomp_valid;
   if (tiny->pattern_weights) {
     free(tiny->pattern_weights);
   }
@@ -164,7 +122,7 @@ pll_partition_t* make_tiny_partition(Tree& reference_tree, const pll_utree_t* tr
 
   // shallow copy major buffers
   pll_aligned_free(tiny->clv[proximal->clv_index]);
-  tiny->clv[proximal->clv_index] = static_cast<double*>(reference_tree.get_clv(old_proximal));
+  tiny->clv[proximal->clv_index] = static_cast<double*>(reference_tree.get_clv(old_proximal, proximal_pin));
 
   if (tip_tip_case and use_tipchars) {
     std::string sequence(tiny->sites, 'A');
@@ -174,10 +132,10 @@ pll_partition_t* make_tiny_partition(Tree& reference_tree, const pll_utree_t* tr
     }
     pll_aligned_free(tiny->tipchars[distal->clv_index]);
     tiny->tipchars[distal->clv_index] =
-        static_cast<unsigned char*>(reference_tree.get_clv(old_distal));
+        static_cast<unsigned char*>(reference_tree.get_clv(old_distal, distal_pin));
   } else {
     pll_aligned_free(tiny->clv[distal->clv_index]);
-    tiny->clv[distal->clv_index] = static_cast<double*>(reference_tree.get_clv(old_distal));
+    tiny->clv[distal->clv_index] = static_cast<double*>(reference_tree.get_clv(old_distal, distal_pin));
   }
 
   // deep copy scalers
@@ -201,15 +159,8 @@ pll_partition_t* make_tiny_partition(Tree& reference_tree, const pll_utree_t* tr
 void tiny_partition_destroy(pll_partition_t* partition) {
   if (partition) {
     // unset shallow copied things
-    partition->rates = nullptr;
-    partition->subst_params = nullptr;
-    partition->frequencies = nullptr;
-    partition->eigenvecs = nullptr;
-    partition->inv_eigenvecs = nullptr;
-    partition->eigenvals = nullptr;
-    partition->prop_invar = nullptr;
+    unshare_model_buffers(partition);
     partition->invariant = nullptr;
-    partition->eigen_decomp_valid = nullptr;
     partition->pattern_weights = nullptr;
 
     partition->clv[proximal_clv_index] = nullptr;
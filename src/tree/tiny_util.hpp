@@ -8,4 +8,6 @@ pll_utree_t* make_tiny_tree_structure(const pll_unode_t* old_proximal,
                                       const pll_unode_t* old_distal, const bool tip_tip_case);
 pll_partition_t* make_tiny_partition(Tree& reference_tree, const pll_utree_t* tree,
                                      const pll_unode_t* old_proximal, const pll_unode_t* old_distal,
-                                     const bool tip_tip_case);
+                                     const bool tip_tip_case,
+                                     Memory_Budget::Pin* proximal_pin = nullptr,
+                                     Memory_Budget::Pin* distal_pin = nullptr);
@@ -0,0 +1,109 @@
+#include "util/Memory_Budget.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+/**
+  Registers a pool of num_entries entries, to be evicted by the given function. Returns the pool
+  id used to acquire its entries.
+*/
+size_t Memory_Budget::add_pool(const size_t num_entries, evict_function evict) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pool_begin_.push_back(entries_.size());
+  evict_.push_back(evict);
+  entries_.resize(entries_.size() + num_entries);
+  return evict_.size() - 1;
+}
+
+/**
+  Replaces the evict function of a pool, for owners that have moved.
+*/
+void Memory_Budget::rebind_pool(const size_t pool, evict_function evict) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(pool < evict_.size());
+  evict_[pool] = evict;
+}
+
+/**
+  Forgets about the buffers of a pool, for owners that go away before the budget does.
+*/
+void Memory_Budget::release_pool(const size_t pool) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(pool < evict_.size());
+
+  const auto end = (pool + 1 < pool_begin_.size()) ? pool_begin_[pool + 1] : entries_.size();
+  for (size_t key = pool_begin_[pool]; key < end; ++key) {
+    assert(entries_[key].pins == 0);
+    resident_ -= entries_[key].bytes;
+    entries_[key].bytes = 0;
+  }
+  evict_[pool] = [](size_t) { return false; };
+}
+
+/**
+  Pins an entry whose buffer is (now) in memory. If the entry was not accounted for yet, its size
+  is added to the budget, evicting others as needed. Must be called by the owner while no other
+  thread can evict the entry, i.e. while holding whatever the evict function of the pool locks.
+*/
+Memory_Budget::Pin Memory_Budget::acquire(const size_t pool, const size_t index,
+                                          const size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(pool < pool_begin_.size());
+
+  const auto key = pool_begin_[pool] + index;
+  assert(key < entries_.size());
+  auto& entry = entries_[key];
+
+  ++entry.pins;
+  entry.referenced = true;
+
+  if (entry.bytes == 0) {
+    entry.bytes = bytes;
+    resident_ += bytes;
+    make_room(key);
+  }
+
+  return Pin(this, key);
+}
+
+size_t Memory_Budget::resident_bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return resident_;
+}
+
+void Memory_Budget::unpin(const size_t key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(entries_[key].pins > 0);
+  --entries_[key].pins;
+}
+
+/**
+  Sweeps the clock hand over the entries until the budget is met, evicting unpinned entries that
+  were not referenced since the last sweep. Gives up after two full rounds, in which case the
+  budget stays exceeded until pins are released: the pinned entries are the working set.
+*/
+void Memory_Budget::make_room(const size_t keep_key) {
+  for (size_t step = 0; resident_ > max_bytes_ and step < 2 * entries_.size(); ++step) {
+    const auto key = hand_;
+    hand_ = (hand_ + 1) % entries_.size();
+
+    auto& entry = entries_[key];
+    if (key == keep_key or entry.bytes == 0 or entry.pins > 0) {
+      continue;
+    }
+    if (entry.referenced) {
+      entry.referenced = false;
+      continue;
+    }
+
+    // find the pool of the entry
+    const auto pool_it = std::upper_bound(pool_begin_.begin(), pool_begin_.end(), key);
+    const size_t pool = std::distance(pool_begin_.begin(), pool_it) - 1;
+
+    if (evict_[pool](key - pool_begin_[pool])) {
+      resident_ -= entry.bytes;
+      entry.bytes = 0;
+    }
+  }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+  Keeps the total size of a set of reloadable buffers below a given limit, evicting the least
+  recently used ones via the clock algorithm.
+
+  Owners register a pool of entries along with a function that evicts one of them, and then
+  acquire an entry whenever they hand out its buffer. An acquired entry is pinned, and thus never
+  evicted, until the returned Pin is destroyed. The evict function may refuse (return false), for
+  example if the entry is currently being loaded by another thread.
+
+  The budget must outlive all pins.
+*/
+class Memory_Budget {
+public:
+  using evict_function = std::function<bool(size_t)>;
+
+  class Pin {
+  public:
+    Pin() = default;
+    Pin(Memory_Budget* budget, const size_t key) : budget_(budget), key_(key) {}
+    ~Pin() { reset(); }
+
+    Pin(Pin const& other) = delete;
+    Pin(Pin&& other) : budget_(other.budget_), key_(other.key_) { other.budget_ = nullptr; }
+
+    Pin& operator=(Pin const& other) = delete;
+    Pin& operator=(Pin&& other) {
+      if (this != &other) {
+        reset();
+        budget_ = other.budget_;
+        key_ = other.key_;
+        other.budget_ = nullptr;
+      }
+      return *this;
+    }
+
+    void reset() {
+      if (budget_) {
+        budget_->unpin(key_);
+        budget_ = nullptr;
+      }
+    }
+
+  private:
+    Memory_Budget* budget_ = nullptr;
+    size_t key_ = 0;
+  };
+
+  explicit Memory_Budget(const size_t max_bytes) : max_bytes_(max_bytes) {}
+  Memory_Budget() = delete;
+  ~Memory_Budget() = default;
+
+  Memory_Budget(Memory_Budget const& other) = delete;
+  Memory_Budget& operator=(Memory_Budget const& other) = delete;
+
+  size_t add_pool(const size_t num_entries, evict_function evict);
+  void rebind_pool(const size_t pool, evict_function evict);
+  void release_pool(const size_t pool);
+
+  Pin acquire(const size_t pool, const size_t index, const size_t bytes);
+
+  size_t max_bytes() const { return max_bytes_; }
+  size_t resident_bytes();
+
+private:
+  struct Entry {
+    size_t bytes = 0;
+    unsigned int pins = 0;
+    bool referenced = false;
+  };
+
+  void unpin(const size_t key);
+  void make_room(const size_t keep_key);
+
+  std::mutex mutex_;
+  std::vector<Entry> entries_;
+  std::vector<size_t> pool_begin_;
+  std::vector<evict_function> evict_;
+  size_t hand_ = 0;
+  size_t resident_ = 0;
+  const size_t max_bytes_;
+};
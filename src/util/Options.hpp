@@ -6,6 +6,7 @@
 class Options {
 public:
   enum class NumericalScaling { kOn, kOff, kAuto };
+  enum class StorePrecision { kDouble, kSingle, kScaled16 };
 
   Options() = default;
   ~Options() = default;
@@ -22,11 +23,19 @@ public:
   double prescoring_threshold = 0.99999;
   bool ranged = false;
   bool dump_binary_mode = false;
+  StorePrecision store_precision = StorePrecision::kDouble;
   bool load_binary_mode = false;
   unsigned int chunk_size = 5000;
+  unsigned int prefetch_chunks = 2;
+  size_t prefetch_memory = 0;  // in bytes, 0 meaning unlimited
   unsigned int num_threads = 0;
+  size_t max_memory = 0;  // in bytes, 0 meaning unlimited
   bool repeats = false;
   bool premasking = true;
+  bool dedup = true;
+  size_t dedup_across = 100000;  // distinct queries whose results are kept across chunks
+  std::string cache_file;
+  bool streaming = false;
   bool baseball = false;
   std::string tmp_dir;
   unsigned int precision = 10;
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <cassert>
+#include <ostream>
 
 class Range {
 public:
@@ -31,19 +32,23 @@ inline std::ostream& operator<<(std::ostream& out, Range const& rhs) {
  *  0  1  2  3  4  5  6  7  8  9 10
  *  Output: (3,6)
  */
-inline Range get_valid_range(const std::string& sequence) {
+inline Range get_valid_range(char const* const sequence, const size_t length) {
   size_t lower = 0;
-  size_t upper = sequence.length();
+  size_t upper = length;
 
   assert(upper);
 
-  while (lower < upper and sequence.c_str()[lower] == '-') {
+  while (lower < upper and sequence[lower] == '-') {
     lower++;
   }
 
-  while (upper > lower and sequence.c_str()[upper - 1u] == '-') {
+  while (upper > lower and sequence[upper - 1u] == '-') {
     upper--;
   }
 
   return Range(lower, upper - lower);
 }
+
+inline Range get_valid_range(const std::string& sequence) {
+  return get_valid_range(sequence.c_str(), sequence.length());
+}
@@ -1,6 +1,7 @@
 #include "Epatest.hpp"
 
 #include <vector>
+#include <cstring>
 
 #include "tree/Tree.hpp"
 #include "io/Binary.hpp"
@@ -226,3 +227,135 @@ static void read_(Options options) {
 }
 
 TEST(Binary, read) { all_combinations(read_); }
+
+static void mapped_(Options options) {
+  // setup
+  auto msa =
+      build_MSA_from_file(env->reference_file, MSA_Info(env->reference_file), options.premasking);
+  raxml::Model model;
+  Tree original_tree(env->tree_file, msa, model, options);
+  dump_to_binary(original_tree, env->binary_file);
+
+  // test
+  Binary binary(env->binary_file);
+  EXPECT_TRUE(binary.mapped());
+
+  auto partition = binary.load_partition();
+  auto part = original_tree.partition();
+  const bool use_tipchars = part->attributes & PLL_ATTRIB_PATTERN_TIP;
+
+  // all buffers are available without any further loading
+  for (size_t i = 0; i < part->tips + part->clv_buffers; ++i) {
+    if (use_tipchars and i < part->tips) {
+      ASSERT_TRUE(partition->tipchars[i] != nullptr);
+      EXPECT_EQ(memcmp(part->tipchars[i], partition->tipchars[i], part->sites), 0);
+    } else {
+      ASSERT_TRUE(partition->clv[i] != nullptr);
+      EXPECT_EQ(memcmp(part->clv[i], partition->clv[i],
+                       pll_get_clv_size(part, i) * sizeof(double)),
+                0);
+    }
+  }
+  for (size_t i = 0; i < part->scale_buffers; ++i) {
+    EXPECT_TRUE(partition->scale_buffer[i] != nullptr);
+  }
+
+  binary.unmap_partition(partition);
+  pll_partition_destroy(partition);
+}
+
+TEST(Binary, mapped) { all_combinations(mapped_); }
+
+TEST(Binary, prefetch) {
+  // setup
+  Options options;
+  auto msa =
+      build_MSA_from_file(env->reference_file, MSA_Info(env->reference_file), options.premasking);
+  raxml::Model model;
+  Tree original_tree(env->tree_file, msa, model, options);
+  dump_to_binary(original_tree, env->binary_file);
+
+  Tree read_tree(env->binary_file, model, options);
+
+  vector<pll_unode_t*> branches(read_tree.nums().branches);
+  utree_query_branches(read_tree.tree(), &branches[0]);
+
+  vector<pll_unode_t const*> nodes;
+  for (auto const branch : branches) {
+    nodes.push_back(branch);
+    nodes.push_back(branch->back);
+  }
+
+  // test
+  read_tree.prefetch(nodes).wait();
+
+  auto part = original_tree.partition();
+  for (auto const node : nodes) {
+    if (node->clv_index < part->tips) {
+      continue;
+    }
+    const auto clv = static_cast<double*>(read_tree.get_clv(node));
+    EXPECT_EQ(memcmp(part->clv[node->clv_index], clv,
+                     pll_get_clv_size(part, node->clv_index) * sizeof(double)),
+              0);
+  }
+}
+
+static void compact_(Options options) {
+  // setup
+  auto msa =
+      build_MSA_from_file(env->reference_file, MSA_Info(env->reference_file), options.premasking);
+  raxml::Model model;
+
+  for (auto precision : {Options::StorePrecision::kSingle, Options::StorePrecision::kScaled16}) {
+    options.store_precision = precision;
+    Tree original_tree(env->tree_file, msa, model, options);
+    dump_to_binary(original_tree, env->binary_file);
+
+    // test
+    Tree read_tree(env->binary_file, model, options);
+    const auto logl = original_tree.ref_tree_logl();
+    EXPECT_NEAR(logl, read_tree.ref_tree_logl(), std::abs(logl) * 1e-4);
+  }
+}
+
+TEST(Binary, compact) { all_combinations(compact_); }
+
+static void streamed_(Options options) {
+  // setup
+  auto msa =
+      build_MSA_from_file(env->reference_file, MSA_Info(env->reference_file), options.premasking);
+  raxml::Model model;
+  Store_Writer writer(env->binary_file, options.store_precision);
+  Tree original_tree(env->tree_file, msa, model, options, &writer);
+  writer.finish(original_tree);
+
+  // test
+  Tree read_tree(env->binary_file, model, options);
+  auto part = original_tree.partition();
+  auto read_part = read_tree.partition();
+
+  vector<pll_unode_t*> branches(read_tree.nums().branches);
+  utree_query_branches(read_tree.tree(), &branches[0]);
+
+  for (auto const branch : branches) {
+    for (auto const node : {branch, branch->back}) {
+      if (node->clv_index < part->tips) {
+        continue;
+      }
+      const auto clv = static_cast<double*>(read_tree.get_clv(node));
+      EXPECT_EQ(memcmp(part->clv[node->clv_index], clv,
+                       pll_get_clv_size(part, node->clv_index) * sizeof(double)),
+                0);
+      if (node->scaler_index != PLL_SCALE_BUFFER_NONE and part->scale_buffer[node->scaler_index]) {
+        EXPECT_EQ(memcmp(part->scale_buffer[node->scaler_index],
+                         read_part->scale_buffer[node->scaler_index],
+                         pll_get_sites_number(part, node->clv_index) * sizeof(unsigned int)),
+                  0);
+      }
+    }
+  }
+  EXPECT_DOUBLE_EQ(original_tree.ref_tree_logl(), read_tree.ref_tree_logl());
+}
+
+TEST(Binary, streamed) { all_combinations(streamed_); }
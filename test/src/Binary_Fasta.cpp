@@ -6,6 +6,9 @@
 
 #include "genesis/utils/core/options.hpp"
 
+#include <fstream>
+#include <string>
+
 static void compare_msas(const MSA& lhs, const MSA& rhs) {
   ASSERT_EQ(lhs.size(), rhs.size());
 
@@ -46,7 +49,7 @@ TEST(Binary_Fasta, reader) {
 
   const size_t skip = 0;
 
-  MSA read_msa;
+  MSA_Chunk read_msa;
   size_t i = skip;
   const size_t chunksize = 5;
   size_t num_sequences = 0;
@@ -61,3 +64,132 @@ TEST(Binary_Fasta, reader) {
     i += num_sequences;
   }
 }
+
+TEST(Binary_Fasta, masked_reader) {
+  genesis::utils::Options::get().allow_file_overwriting(true);
+
+  const std::string orig_file(env->combined_file);
+  const std::string binfile_name(orig_file + ".bin");
+
+  MSA_Info full_info(env->combined_file);
+  auto msa = build_MSA_from_file(orig_file, full_info);
+  Binary_Fasta::save(msa, binfile_name);
+
+  // mask every third site
+  MSA_Info::mask_type mask(msa.num_sites(), false);
+  for (size_t i = 0; i < mask.size(); i += 3) {
+    mask.set(i);
+  }
+  MSA_Info info(orig_file, msa.size(), mask, mask.size());
+
+  Binary_Fasta_Reader reader(binfile_name, info, true);
+
+  MSA_Chunk read_msa;
+  size_t i = 0;
+  size_t num_sequences = 0;
+  while ((num_sequences = reader.read_next(read_msa, 4)) != 0) {
+    for (size_t k = 0; k < num_sequences; ++k) {
+      EXPECT_STREQ(msa[i + k].header().c_str(), read_msa[k].header().c_str());
+      EXPECT_STREQ(subset_sequence(msa[i + k].sequence(), mask).c_str(),
+                   read_msa[k].sequence().c_str());
+    }
+    i += num_sequences;
+  }
+  EXPECT_EQ(msa.size(), i);
+}
+
+TEST(Binary_Fasta, premasked) {
+  genesis::utils::Options::get().allow_file_overwriting(true);
+
+  const std::string orig_file(env->combined_file);
+  const std::string binfile_name(orig_file + ".bin");
+
+  MSA_Info info(env->combined_file);
+  auto msa = build_MSA_from_file(orig_file, info);
+
+  // mask every fifth site on top of the gap mask
+  MSA_Info::mask_type reference_mask(msa.num_sites(), false);
+  for (size_t i = 0; i < reference_mask.size(); i += 5) {
+    reference_mask.set(i);
+  }
+  Binary_Fasta::save(msa, binfile_name, reference_mask);
+
+  const auto bin_info = Binary_Fasta::get_info(binfile_name);
+  const auto mask = info.gap_mask() | reference_mask;
+  EXPECT_TRUE(bin_info.gap_mask() == mask);
+
+  // premasked files are of no use without premasking
+  EXPECT_THROW(Binary_Fasta_Reader(binfile_name, bin_info, false), std::runtime_error);
+
+  auto read_msa = Binary_Fasta::load(binfile_name, true);
+  ASSERT_EQ(msa.size(), read_msa.size());
+  for (size_t i = 0; i < msa.size(); ++i) {
+    const auto expected = subset_sequence(msa[i].sequence(), mask);
+    EXPECT_STREQ(expected.c_str(), read_msa[i].sequence().c_str());
+
+    // the valid range comes along with the sequence
+    const auto range = get_valid_range(expected);
+    EXPECT_EQ(range.begin, read_msa[i].range().begin);
+    EXPECT_EQ(range.span, read_msa[i].range().span);
+  }
+}
+
+TEST(Binary_Fasta, amino_acids) {
+  genesis::utils::Options::get().allow_file_overwriting(true);
+
+  const std::string binfile_name(env->combined_file + ".aa.bin");
+
+  MSA msa;
+  msa.append("first", "--MKVLAAGIVALLLAAGCSSSKEETPQ--");
+  msa.append("second", "-MRVLWTTLLLSLAAGCATSNKEQ-PQXB-");
+  msa.append("third", "---KVLAAGZVALLLAAGCSSSKEETPQYY");
+
+  Binary_Fasta::save(msa, binfile_name);
+
+  auto read_msa = Binary_Fasta::load(binfile_name);
+
+  compare_msas(msa, read_msa);
+}
+
+TEST(Binary_Fasta, amino_acids_late) {
+  genesis::utils::Options::get().allow_file_overwriting(true);
+
+  // the first records could pass for nucleotides, only a later one shows these are amino acids
+  MSA msa;
+  msa.append("gaps", "------------------------------");
+  msa.append("short", "--------ACGTRYKMSWBDHVN-------");
+  for (size_t i = 0; i < 200; ++i) {
+    msa.append("nt" + std::to_string(i), "ACGTACGTACGTACGTACGTACGTACGTAC");
+  }
+  msa.append("aa", "-MRVLWTTLLLSLAAGCATSNKEQ-PQXB-");
+
+  const std::string binfile_name(env->combined_file + ".aa_late.bin");
+  Binary_Fasta::save(msa, binfile_name);
+  compare_msas(msa, Binary_Fasta::load(binfile_name));
+
+  const std::string fasta_file(env->out_dir + "aa_late.fasta");
+  {
+    std::ofstream out(fasta_file);
+    for (auto const& s : msa) {
+      out << ">" << s.header() << "\n" << s.sequence() << "\n";
+    }
+  }
+  for (unsigned int num_threads : {1u, 4u}) {
+    const auto bfast_file = Binary_Fasta::fasta_to_bfast(fasta_file, env->out_dir,
+                                                         MSA_Info::mask_type(), num_threads);
+    compare_msas(msa, Binary_Fasta::load(bfast_file));
+  }
+}
+
+TEST(Binary_Fasta, parallel_conversion) {
+  genesis::utils::Options::get().allow_file_overwriting(true);
+
+  const std::string orig_file(env->combined_file);
+  auto msa = build_MSA_from_file(orig_file, MSA_Info(orig_file));
+
+  for (unsigned int num_threads : {1u, 4u}) {
+    const auto bfast_file =
+        Binary_Fasta::fasta_to_bfast(orig_file, env->out_dir, MSA_Info::mask_type(), num_threads);
+    compare_msas(msa, Binary_Fasta::load(bfast_file));
+  }
+}
@@ -0,0 +1,138 @@
+#include "Epatest.hpp"
+
+#include "sample/Columnar_Sample.hpp"
+#include "sample/Sample.hpp"
+#include "io/jplace_util.hpp"
+#include "set_manipulators.hpp"
+
+#include <cereal/archives/binary.hpp>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <random>
+
+using namespace std;
+
+static void expect_equal(Sample<Placement> const& expected, Columnar_Sample const& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t q = 0; q < expected.size(); ++q) {
+    auto const& pq = expected.at(q);
+    EXPECT_EQ(pq.sequence_id(), actual.sequence_id(q));
+    EXPECT_EQ(pq.header(), actual.header(q));
+    ASSERT_EQ(pq.size(), actual.num_placements(q));
+    for (size_t k = 0; k < pq.size(); ++k) {
+      const auto p = actual.placement(actual.begin(q) + k);
+      EXPECT_EQ(pq.at(k).branch_id(), p.branch_id());
+      EXPECT_EQ(pq.at(k).likelihood(), p.likelihood());
+      EXPECT_DOUBLE_EQ(pq.at(k).lwr(), p.lwr());
+      EXPECT_EQ(pq.at(k).pendant_length(), p.pendant_length());
+      EXPECT_EQ(pq.at(k).distal_length(), p.distal_length());
+    }
+  }
+}
+
+TEST(Columnar_Sample, conversion) {
+  mt19937 gen(1);
+  auto sample = random_sample(50, gen);
+  sample.add_pquery(200, "no_placements");
+
+  Columnar_Sample columnar(sample);
+  expect_equal(sample, columnar);
+  EXPECT_EQ(vector<string>({"query_3", "duplicate_of_3"}), columnar.names(3));
+  EXPECT_EQ(vector<string>({"query_4"}), columnar.names(4));
+
+  const auto back = columnar.to_sample();
+  expect_equal(back, columnar);
+  EXPECT_EQ(sample.at(3).duplicate_headers(), back.at(3).duplicate_headers());
+
+  columnar.add_name(4, "another");
+  EXPECT_EQ(vector<string>({"query_4", "another"}), columnar.names(4));
+  EXPECT_EQ(vector<string>({"query_5"}), columnar.names(5));
+}
+
+TEST(Columnar_Sample, slots) {
+  Columnar_Sample sample;
+  sample.add_pquery(7, "seven", 3);
+  sample.add_pquery(8, "eight");
+  sample.add_pquery(9, "nine", 2);
+  ASSERT_EQ(5, sample.num_placements());
+  EXPECT_EQ(0, sample.num_placements(1));
+  EXPECT_EQ(3, sample.begin(2));
+
+  // in any order, like the threads of the placement
+#ifdef __OMP
+#pragma omp parallel for
+#endif
+  for (size_t i = 0; i < 5; ++i) {
+    const auto slot = 4 - i;
+    sample.set_placement(slot, Placement(slot * 10, -1.0 * slot, 0.1, 0.2));
+  }
+
+  for (size_t i = 0; i < 5; ++i) {
+    EXPECT_EQ(i * 10, sample.placement(i).branch_id());
+    EXPECT_EQ(-1.0 * i, sample.placement(i).likelihood());
+  }
+  EXPECT_EQ(30, sample.placements(2)[0].branch_id());
+}
+
+TEST(Columnar_Sample, lwr_and_filters) {
+  mt19937 gen(2);
+  for (const bool accumulated : {false, true}) {
+    for (const size_t max : {1ul, 3ul, 7ul, 100ul}) {
+      auto sample = random_sample(60, gen);
+      Columnar_Sample columnar(sample);
+
+      compute_and_set_lwr(sample);
+      compute_and_set_lwr(columnar);
+      expect_equal(sample, columnar);
+
+      if (accumulated) {
+        discard_by_accumulated_threshold(sample, 0.9, 1, max);
+        discard_by_accumulated_threshold(columnar, 0.9, 1, max);
+      } else {
+        discard_by_support_threshold(sample, 0.05, 1, max);
+        discard_by_support_threshold(columnar, 0.05, 1, max);
+      }
+      expect_equal(sample, columnar);
+    }
+  }
+}
+
+TEST(Columnar_Sample, jplace) {
+  mt19937 gen(3);
+  auto sample = random_sample(20, gen);
+  compute_and_set_lwr(sample);
+  Columnar_Sample columnar(sample);
+
+  rtree_mapper mapper;
+  ostringstream expected;
+  ostringstream actual;
+  for (auto stream : {&expected, &actual}) {
+    stream->precision(10);
+    stream->setf(ios::fixed, ios::floatfield);
+  }
+  sample_to_jplace_string(sample, expected, mapper);
+  sample_to_jplace_string(columnar, actual, mapper);
+  EXPECT_EQ(expected.str(), actual.str());
+}
+
+TEST(Columnar_Sample, serialization) {
+  mt19937 gen(4);
+  const auto sample = random_sample(30, gen);
+  Columnar_Sample columnar(sample);
+
+  stringstream buffer;
+  {
+    cereal::BinaryOutputArchive out(buffer);
+    out(columnar);
+  }
+  Columnar_Sample loaded;
+  {
+    cereal::BinaryInputArchive in(buffer);
+    in(loaded);
+  }
+
+  expect_equal(sample, loaded);
+  EXPECT_EQ(columnar.names(0), loaded.names(0));
+}
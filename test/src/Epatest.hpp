@@ -4,6 +4,10 @@
 
 #include "core/raxml/Model.hpp"
 #include "util/Options.hpp"
+#include "sample/Sample.hpp"
+
+#include <random>
+#include <string>
 
 // The testing environment
 class Epatest : public ::testing::Environment {
@@ -67,3 +71,23 @@ void all_combinations(Func f, bool verbose = false) {
     f(o);
   }
 }
+
+// a sample of random placements, with more than one name for every third query
+static inline Sample<Placement> random_sample(const size_t size, std::mt19937& gen) {
+  std::uniform_int_distribution<size_t> num_placements(1, 40);
+  std::uniform_real_distribution<double> logl(-20.0, 0.0);
+  std::uniform_real_distribution<double> length(0.0, 1.0);
+
+  Sample<Placement> sample;
+  for (size_t i = 0; i < size; ++i) {
+    const auto idx = sample.add_pquery(100 + i, "query_" + std::to_string(i));
+    if (i % 3 == 0) {
+      sample[idx].add_header("duplicate_of_" + std::to_string(i));
+    }
+    const auto n = num_placements(gen);
+    for (size_t b = 0; b < n; ++b) {
+      sample[idx].emplace_back(b * 2, -1000.0 + logl(gen), length(gen), length(gen));
+    }
+  }
+  return sample;
+}
@@ -0,0 +1,162 @@
+#ifdef __ZLIB
+
+#include "Epatest.hpp"
+
+#include "io/Gzip_Stream.hpp"
+#include "seq/MSA_Stream.hpp"
+#include "seq/MSA.hpp"
+#include "seq/MSA_Info.hpp"
+
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+
+#include <zlib.h>
+
+using namespace std;
+
+static string file_content(const string& file_name) {
+  ifstream in(file_name, ios::binary);
+  return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+static string read_all(istream& in) {
+  string result;
+  char buffer[4096];
+  while (in.read(buffer, sizeof(buffer)) or in.gcount()) {
+    result.append(buffer, in.gcount());
+  }
+  return result;
+}
+
+static void put_uint(string& out, const uint32_t value, const size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i) {
+    out += static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+// writes the content as gzip file of as many members as there are parts
+static void write_gzip(const string& file_name, const string& content, const size_t parts) {
+  remove(file_name.c_str());
+  for (size_t i = 0; i < parts; ++i) {
+    auto file = gzopen(file_name.c_str(), "ab");
+    const auto begin = content.size() * i / parts;
+    const auto end = content.size() * (i + 1) / parts;
+    gzwrite(file, content.data() + begin, static_cast<unsigned>(end - begin));
+    gzclose(file);
+  }
+}
+
+// writes the content as BGZF file, in blocks of the given size plus the empty end of file block
+static void write_bgzf(const string& file_name, const string& content, const size_t block_size) {
+  ofstream out(file_name, ios::binary);
+  for (size_t pos = 0; pos <= content.size(); pos += block_size) {
+    const auto size = min(block_size, content.size() - pos);
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    string compressed(deflateBound(&zs, size), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(content.data() + pos));
+    zs.avail_in = static_cast<uInt>(size);
+    zs.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+    zs.avail_out = static_cast<uInt>(compressed.size());
+    deflate(&zs, Z_FINISH);
+    compressed.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    string block("\x1f\x8b\x08\x04\0\0\0\0\0\xff\x06\0BC\x02\0", 16);
+    put_uint(block, static_cast<uint32_t>(18 + compressed.size() + 8 - 1), 2);
+    block += compressed;
+    put_uint(block, crc32(0L, reinterpret_cast<const Bytef*>(content.data() + pos),
+                          static_cast<uInt>(size)), 4);
+    put_uint(block, static_cast<uint32_t>(size), 4);
+    out << block;
+
+    if (size == 0) {
+      break;
+    }
+  }
+}
+
+TEST(Gzip_Stream, decompression) {
+  // enough content for several batches of blocks
+  string content;
+  for (size_t i = 0; content.size() < (3ul << 20); ++i) {
+    content += ">seq" + to_string(i) + "\nACGTTGCA-ACGTNNACGTAAAC" + to_string(i % 97) + "\n";
+  }
+
+  const auto bgzf_file = env->out_dir + "decompression.fasta.bgz";
+  write_bgzf(bgzf_file, content, 60000);
+  const auto gzip_file = env->out_dir + "decompression.fasta.gz";
+  write_gzip(gzip_file, content, 3);
+
+  EXPECT_TRUE(is_gzip_file(bgzf_file));
+  EXPECT_TRUE(is_gzip_file(gzip_file));
+
+  for (size_t num_threads : {1u, 4u}) {
+    Gzip_Stream bgzf(bgzf_file, num_threads);
+    EXPECT_TRUE(bgzf.is_bgzf());
+    EXPECT_EQ(read_all(bgzf), content);
+  }
+
+  Gzip_Stream gzip(gzip_file, 4);
+  EXPECT_FALSE(gzip.is_bgzf());
+  EXPECT_EQ(read_all(gzip), content);
+
+  // truncated files are an error, not just a shorter input
+  for (auto const& file_name : {bgzf_file, gzip_file}) {
+    const auto compressed = file_content(file_name);
+    const auto truncated_file = env->out_dir + "truncated.fasta.gz";
+    ofstream(truncated_file, ios::binary) << compressed.substr(0, compressed.size() / 2);
+    Gzip_Stream truncated(truncated_file, 2);
+    EXPECT_ANY_THROW(read_all(truncated));
+  }
+}
+
+TEST(Gzip_Stream, bgzf_edge_cases) {
+  // an empty file is just the end of file block
+  const auto empty_file = env->out_dir + "empty.fasta.bgz";
+  write_bgzf(empty_file, "", 1000);
+  Gzip_Stream empty(empty_file, 2);
+  EXPECT_TRUE(empty.is_bgzf());
+  EXPECT_EQ(read_all(empty), "");
+
+  // a block size too small to hold the block is no BGZF, the file is read as plain gzip
+  const string content(">seq\nACGT\n");
+  const auto tampered_file = env->out_dir + "tampered.fasta.bgz";
+  write_bgzf(tampered_file, content, 1000);
+  auto compressed = file_content(tampered_file);
+  compressed[16] = 5;
+  compressed[17] = 0;
+  ofstream(tampered_file, ios::binary) << compressed;
+  Gzip_Stream tampered(tampered_file, 2);
+  EXPECT_FALSE(tampered.is_bgzf());
+  EXPECT_EQ(read_all(tampered), content);
+}
+
+TEST(Gzip_Stream, msa_stream) {
+  MSA_Info info(env->combined_file);
+  const auto content = file_content(env->combined_file);
+  const auto bgzf_file = env->out_dir + "combined.fasta.bgz";
+  write_bgzf(bgzf_file, content, 1000);
+  const auto gzip_file = env->out_dir + "combined.fasta.gz";
+  write_gzip(gzip_file, content, 1);
+
+  MSA_Chunk expected;
+  MSA_Stream(env->combined_file, info, true).read_next(expected, info.sequences());
+
+  for (auto const& file_name : {bgzf_file, gzip_file}) {
+    MSA_Stream streamed_msa(file_name, info, true, false, 2);
+    MSA_Chunk chunk;
+    streamed_msa.read_next(chunk, info.sequences());
+    ASSERT_EQ(chunk.size(), expected.size());
+    for (size_t i = 0; i < chunk.size(); ++i) {
+      EXPECT_EQ(chunk[i].header(), expected[i].header());
+      EXPECT_EQ(chunk[i], expected[i]);
+    }
+  }
+}
+
+#endif
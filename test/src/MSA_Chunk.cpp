@@ -0,0 +1,84 @@
+#include "Epatest.hpp"
+
+#include "seq/MSA_Chunk.hpp"
+#include "seq/MSA.hpp"
+
+#include <string>
+#include <cstring>
+
+using namespace std;
+
+TEST(MSA_Chunk, append) {
+  MSA_Chunk chunk;
+  chunk.append("first", "ACGT-");
+  chunk.append("second", "--GTA", Range(2, 3));
+  auto const sites = chunk.append("third", 5, 5);
+  memcpy(sites, "TTTTT", 5);
+
+  ASSERT_EQ(chunk.size(), 3u);
+  EXPECT_EQ(chunk.num_sites(), 5u);
+  EXPECT_EQ(chunk[0].header(), "first");
+  EXPECT_EQ(chunk[1].header(), "second");
+  EXPECT_EQ(chunk[2].header(), "third");
+  EXPECT_EQ(chunk[0].sequence(), "ACGT-");
+  EXPECT_EQ(chunk[2].sequence(), "TTTTT");
+  EXPECT_EQ(chunk[1].range().begin, 2u);
+  EXPECT_EQ(chunk[1].range().span, 3u);
+  EXPECT_FALSE(chunk[0].range());
+
+  // the sites can be handed on as C strings
+  EXPECT_STREQ(chunk[1].sites(), "--GTA");
+
+  EXPECT_THROW(chunk.append("wrong", "ACGT"), runtime_error);
+
+  size_t i = 0;
+  for (auto const& s : chunk) {
+    EXPECT_EQ(s, chunk[i++]);
+  }
+  EXPECT_EQ(i, chunk.size());
+}
+
+TEST(MSA_Chunk, reuse) {
+  MSA_Chunk chunk;
+  chunk.append("a", "ACGT");
+  chunk.append("b", "CCCC");
+  const auto bytes = chunk.bytes();
+
+  chunk.clear();
+  EXPECT_EQ(chunk.size(), 0u);
+  EXPECT_EQ(chunk.bytes(), 0u);
+
+  // a cleared chunk takes sequences of any width
+  chunk.append("c", "AC");
+  ASSERT_EQ(chunk.size(), 1u);
+  EXPECT_EQ(chunk[0].header(), "c");
+  EXPECT_EQ(chunk[0].sequence(), "AC");
+  EXPECT_LT(chunk.bytes(), bytes);
+}
+
+TEST(MSA_Chunk, concatenate) {
+  MSA_Chunk a;
+  a.append("a", "ACGT");
+  MSA_Chunk b;
+  b.append("b", "CCCC");
+  b.append("c", "GGGG", Range(0, 4));
+
+  a.append(b);
+  ASSERT_EQ(a.size(), 3u);
+  EXPECT_EQ(a[1].header(), "b");
+  EXPECT_EQ(a[2].header(), "c");
+  EXPECT_EQ(a[2].sequence(), "GGGG");
+  EXPECT_EQ(a[2].range().span, 4u);
+
+  MSA_Chunk c;
+  c.append("d", "AC");
+  EXPECT_THROW(a.append(c), runtime_error);
+
+  const auto msa = a.to_msa();
+  ASSERT_EQ(msa.size(), a.size());
+  for (size_t i = 0; i < msa.size(); ++i) {
+    EXPECT_EQ(msa[i].header(), a[i].header());
+    EXPECT_EQ(msa[i], a[i]);
+    EXPECT_EQ(msa[i].range().span, a[i].range().span);
+  }
+}
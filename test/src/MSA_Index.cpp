@@ -0,0 +1,70 @@
+#include "Epatest.hpp"
+
+#include "io/MSA_Index.hpp"
+#include "seq/MSA_Info.hpp"
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+
+static string copy_to_out_dir(const string& file, const string& name) {
+  const auto copy = env->out_dir + name;
+  ifstream in(file, ios::binary);
+  ofstream out(copy, ios::binary);
+  out << in.rdbuf();
+  remove(index_file_name(copy).c_str());
+  return copy;
+}
+
+TEST(MSA_Index, build_and_load) {
+  const auto file = copy_to_out_dir(env->combined_file, "index_test.fasta");
+  MSA_Info info(file);
+
+  auto built = get_msa_index(file, 2);
+  EXPECT_EQ(info.sequences(), built.info.sequences());
+  EXPECT_EQ(info.sites(), built.info.sites());
+  EXPECT_EQ(info.gap_mask(), built.info.gap_mask());
+  ASSERT_EQ(info.sequences(), built.offsets.size());
+
+  // every offset points at the start of a record
+  ifstream in(file, ios::binary);
+  for (auto const offset : built.offsets) {
+    in.seekg(offset);
+    EXPECT_EQ('>', in.get());
+  }
+
+  MSA_Index loaded;
+  ASSERT_TRUE(load_msa_index(file, loaded));
+  EXPECT_EQ(built.offsets, loaded.offsets);
+  EXPECT_EQ(built.info.sequences(), loaded.info.sequences());
+  EXPECT_EQ(built.info.sites(), loaded.info.sites());
+  EXPECT_EQ(built.info.gap_mask(), loaded.info.gap_mask());
+
+  remove(index_file_name(file).c_str());
+  remove(file.c_str());
+}
+
+TEST(MSA_Index, outdated) {
+  const auto file = copy_to_out_dir(env->combined_file, "index_outdated.fasta");
+  MSA_Index index;
+  EXPECT_FALSE(load_msa_index(file, index));
+
+  const auto built = get_msa_index(file);
+  EXPECT_TRUE(load_msa_index(file, index));
+
+  // changing the file invalidates its index
+  {
+    ofstream out(file, ios::binary | ios::app);
+    out << ">appended\n" << string(built.info.sites(), 'A') << "\n";
+  }
+  EXPECT_FALSE(load_msa_index(file, index));
+
+  const auto rebuilt = get_msa_index(file);
+  EXPECT_EQ(built.info.sequences() + 1, rebuilt.info.sequences());
+  EXPECT_TRUE(load_msa_index(file, index));
+
+  remove(index_file_name(file).c_str());
+  remove(file.c_str());
+}
@@ -4,8 +4,12 @@
 #include "seq/MSA.hpp"
 #include "seq/MSA_Info.hpp"
 #include "io/file_io.hpp"
+#include "io/fasta_blocks.hpp"
 
 #include <string>
+#include <vector>
+#include <fstream>
+#include <cctype>
 
 using namespace std;
 
@@ -13,7 +17,7 @@ TEST(MSA_Stream, reading) {
   MSA_Info info(env->combined_file);
   MSA complete_msa = build_MSA_from_file(env->combined_file, info);
   const size_t chunk_size = 3;
-  MSA read_msa;
+  MSA_Chunk read_msa;
   MSA_Stream streamed_msa(env->combined_file, info, false);
 
   for (size_t i = 0; i < complete_msa.size(); i++) {
@@ -29,7 +33,7 @@ TEST(MSA_Stream, reading_masked) {
   MSA_Info info(env->combined_file);
   MSA complete_msa = build_MSA_from_file(env->combined_file, info, true);
   const auto chunk_size = 3;
-  MSA read_msa;
+  MSA_Chunk read_msa;
   MSA_Stream streamed_msa(env->combined_file, info, true);
 
   for (size_t i = 0; i < complete_msa.size(); i++) {
@@ -39,4 +43,102 @@ TEST(MSA_Stream, reading_masked) {
     EXPECT_EQ(complete_msa[i], read_msa[i % chunk_size]);
   }
   MSA_Stream dummy;
-}
\ No newline at end of file
+}
+
+TEST(MSA_Stream, parallel_parsing) {
+  // lowercase, wrapped sequences with mixed line endings, enough to spread over several threads
+  const size_t num_sequences = 1000;
+  const string chars = "acgt-n";
+  const string file_name = env->out_dir + "parallel_parsing.fasta";
+  vector<string> expected;
+  {
+    ofstream out(file_name);
+    for (size_t i = 0; i < num_sequences; ++i) {
+      string seq;
+      for (size_t j = 0; j < 50; ++j) {
+        seq += chars[(i * 7 + j * j) % chars.size()];
+      }
+      out << ">seq" << i << (i % 3 ? "\n" : "\r\n");
+      out << seq.substr(0, 17) << "\n" << seq.substr(17) << "\n";
+      for (auto& c : seq) {
+        c = toupper(c);
+      }
+      expected.push_back(seq);
+    }
+  }
+  MSA_Info info(file_name);
+
+  for (const bool premasking : {false, true}) {
+    for (size_t num_threads : {1u, 4u}) {
+      MSA_Stream streamed_msa(file_name, info, premasking, false, num_threads);
+      MSA_Chunk chunk;
+      size_t i = 0;
+      while (streamed_msa.read_next(chunk, 300)) {
+        for (auto const& s : chunk) {
+          EXPECT_EQ(s.header(), "seq" + to_string(i));
+          const auto seq =
+              premasking ? subset_sequence(expected[i], info.gap_mask()) : expected[i];
+          EXPECT_EQ(s.sequence(), seq);
+          ++i;
+        }
+      }
+      EXPECT_EQ(i, num_sequences);
+    }
+  }
+}
+
+TEST(MSA_Stream, streaming) {
+  MSA_Info info(env->combined_file);
+  MSA complete_msa = build_MSA_from_file(env->combined_file, info, true);
+
+  // the mask survives a round trip through a mask file
+  const string mask_file = env->out_dir + "streaming.mask";
+  {
+    ofstream out(mask_file);
+    out << info.gap_mask() << "\n";
+  }
+  const auto mask = read_mask(mask_file);
+  EXPECT_EQ(mask, info.gap_mask());
+
+  // no pass over the file: the number of sequences is unknown
+  auto stream_info = make_streaming_msa_info(env->combined_file, mask);
+  EXPECT_EQ(stream_info.sequences(), 0u);
+  EXPECT_EQ(stream_info.sites(), info.sites());
+
+  MSA_Stream streamed_msa(env->combined_file, stream_info, true);
+  MSA_Chunk chunk;
+  size_t i = 0;
+  while (streamed_msa.read_next(chunk, 4)) {
+    for (auto const& s : chunk) {
+      EXPECT_EQ(complete_msa[i], s);
+      ++i;
+    }
+  }
+  EXPECT_EQ(i, complete_msa.size());
+
+  ifstream in(env->combined_file);
+  EXPECT_EQ(count_fasta_records(in), info.sequences());
+}
+
+TEST(MSA_Stream, unequal_lengths) {
+  // the sites of a streamed MSA are unknown without a mask, so the records are checked against
+  // each other, also when they end up in different parts of a parallel parse
+  const string file_name = env->out_dir + "unequal_lengths.fasta";
+  {
+    ofstream out(file_name);
+    for (size_t i = 0; i < 1000; ++i) {
+      out << ">seq" << i << "\n" << string(i == 900 ? 49 : 50, 'A') << "\n";
+    }
+  }
+  const auto info = make_streaming_msa_info(file_name, MSA_Info::mask_type{});
+  EXPECT_EQ(info.sites(), 0u);
+
+  for (size_t num_threads : {1u, 4u}) {
+    EXPECT_ANY_THROW({
+      MSA_Stream streamed_msa(file_name, info, false, false, num_threads);
+      MSA_Chunk chunk;
+      while (streamed_msa.read_next(chunk, 1000)) {
+      }
+    });
+  }
+}
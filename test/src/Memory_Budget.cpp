@@ -0,0 +1,52 @@
+#include "Epatest.hpp"
+
+#include "util/Memory_Budget.hpp"
+
+#include <vector>
+
+using namespace std;
+
+TEST(Memory_Budget, evicts_unpinned) {
+  Memory_Budget budget(100);
+  vector<size_t> evicted;
+  auto pool = budget.add_pool(4, [&](size_t i) {
+    evicted.push_back(i);
+    return true;
+  });
+
+  // the pinned entry stays, the others take turns
+  auto pinned = budget.acquire(pool, 0, 50);
+  budget.acquire(pool, 1, 50);
+  EXPECT_EQ(budget.resident_bytes(), 100);
+  EXPECT_TRUE(evicted.empty());
+
+  budget.acquire(pool, 2, 50);
+  ASSERT_EQ(evicted.size(), 1);
+  EXPECT_EQ(evicted[0], 1);
+  EXPECT_EQ(budget.resident_bytes(), 100);
+
+  // nothing evictable: the budget is exceeded rather than evicting anything in use
+  auto pinned_too = budget.acquire(pool, 2, 50);
+  budget.acquire(pool, 3, 50);
+  EXPECT_EQ(evicted.size(), 1);
+  EXPECT_EQ(budget.resident_bytes(), 150);
+
+  // once released, the excess is evicted again
+  pinned.reset();
+  budget.acquire(pool, 1, 50);
+  EXPECT_EQ(evicted.size(), 3);
+  EXPECT_EQ(budget.resident_bytes(), 100);
+}
+
+TEST(Memory_Budget, refused_eviction) {
+  Memory_Budget budget(10);
+  auto busy = budget.add_pool(1, [](size_t) { return false; });
+  auto pool = budget.add_pool(1, [](size_t) { return true; });
+
+  budget.acquire(busy, 0, 10);
+  budget.acquire(pool, 0, 10);
+  EXPECT_EQ(budget.resident_bytes(), 20);
+
+  budget.release_pool(busy);
+  EXPECT_EQ(budget.resident_bytes(), 10);
+}
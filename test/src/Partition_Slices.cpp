@@ -0,0 +1,84 @@
+#include "Epatest.hpp"
+
+#include "core/pll/Partition_Slices.hpp"
+#include "core/pll/pll_util.hpp"
+#include "io/file_io.hpp"
+#include "seq/MSA.hpp"
+#include "seq/MSA_Info.hpp"
+#include "tree/Tree.hpp"
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+static void slices_logl_test(Options o) {
+  // buildup
+  raxml::Model model;
+  auto msa = build_MSA_from_file(env->reference_file, MSA_Info(env->reference_file), o.premasking);
+  Tree tree(env->tree_file, msa, model, o);
+  auto partition = tree.partition();
+
+  vector<pll_unode_t*> branches(tree.nums().branches);
+  utree_query_branches(tree.tree(), &branches[0]);
+
+  vector<unsigned int> param_indices(partition->rate_cats, 0);
+
+  for (unsigned int num_slices : {1u, 2u, 3u, 7u}) {
+    Partition_Slices slices(partition, num_slices);
+
+    // tests
+    for (auto const edge : branches) {
+      const auto expected = pll_compute_edge_loglikelihood(
+          partition, edge->clv_index, edge->scaler_index, edge->back->clv_index,
+          edge->back->scaler_index, edge->pmatrix_index, &param_indices[0], nullptr);
+      EXPECT_NEAR(expected, slices.edge_loglikelihood(edge), 1e-6);
+    }
+  }
+}
+
+TEST(Partition_Slices, edge_loglikelihood) {
+  Options o;
+  slices_logl_test(o);
+  o.premasking = false;
+  slices_logl_test(o);
+}
+
+TEST(Partition_Slices, update_partials) {
+  // buildup
+  raxml::Model model;
+  Options o;
+  auto msa = build_MSA_from_file(env->reference_file, MSA_Info(env->reference_file), true);
+  Tree tree(env->tree_file, msa, model, o);
+  auto partition = tree.partition();
+
+  // recompute an inner CLV via the slices
+  auto node = get_root(tree.tree());
+  if (not node->next) {
+    node = node->back;
+  }
+  const auto clv_size = pll_get_clv_size(partition, node->clv_index);
+  vector<double> expected(partition->clv[node->clv_index],
+                          partition->clv[node->clv_index] + clv_size);
+  memset(partition->clv[node->clv_index], 0, clv_size * sizeof(double));
+
+  Partition_Slices slices(partition, 3);
+  const auto op = make_operation(node);
+  slices.update_partials(&op, 1);
+
+  // tests
+  EXPECT_EQ(memcmp(&expected[0], partition->clv[node->clv_index], clv_size * sizeof(double)), 0);
+}
+
+TEST(Partition_Slices, unsupported) {
+  for (const unsigned int attribute : {PLL_ATTRIB_SITE_REPEATS, PLL_ATTRIB_AB_FLAG}) {
+    auto partition = pll_partition_create(4, 2, 4, 20, 1, 5, 4, 6, PLL_ATTRIB_ARCH_CPU | attribute);
+    ASSERT_NE(partition, nullptr);
+
+    EXPECT_FALSE(Partition_Slices::supports(partition));
+    EXPECT_ANY_THROW(Partition_Slices(partition, 2));
+
+    pll_partition_destroy(partition);
+  }
+}
@@ -0,0 +1,196 @@
+#include "Epatest.hpp"
+
+#include "io/Placement_Cache.hpp"
+#include "seq/Sequence_Hash.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdio>
+#include <future>
+#include <chrono>
+
+#include <unistd.h>
+
+using namespace std;
+
+using cache_map = map<pair<uint64_t, uint64_t>, vector<Placement>>;
+
+static string fresh_cache_file(const string& name) {
+  const auto file = env->out_dir + name;
+  remove(file.c_str());
+  return file;
+}
+
+static vector<Placement> make_placements(const size_t n) {
+  vector<Placement> placements;
+  for (size_t i = 0; i < n; ++i) {
+    placements.emplace_back(i * 3, -1000.5 - i, 0.25 / (i + 1), 0.75 + i);
+    placements.back().lwr(1.0 / (i + 1));
+  }
+  return placements;
+}
+
+static cache_map load_all(Placement_Cache& cache, size_t& num_entries) {
+  cache_map entries;
+  num_entries = cache.load([&entries](const Sequence_Hash& hash, vector<Placement>& placements) {
+    entries[make_pair(hash.first, hash.second)] = placements;
+  });
+  return entries;
+}
+
+static void expect_equal(const vector<Placement>& expected, const vector<Placement>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].branch_id(), actual[i].branch_id());
+    EXPECT_EQ(expected[i].likelihood(), actual[i].likelihood());
+    EXPECT_EQ(expected[i].lwr(), actual[i].lwr());
+    EXPECT_EQ(expected[i].pendant_length(), actual[i].pendant_length());
+    EXPECT_EQ(expected[i].distal_length(), actual[i].distal_length());
+  }
+}
+
+TEST(Placement_Cache, round_trip) {
+  const auto file = fresh_cache_file("round_trip.epacache");
+  const auto key = hash_sequence("reference A");
+  const auto a = hash_sequence("ACGT");
+  const auto b = hash_sequence("CCGT");
+
+  {
+    Placement_Cache cache(file, key);
+    size_t num_entries = 1;
+    EXPECT_TRUE(load_all(cache, num_entries).empty());
+    EXPECT_EQ(0, num_entries);
+
+    cache.add(a, make_placements(3));
+    cache.flush();
+    cache.add(b, make_placements(1));
+    cache.flush();
+  }
+
+  Placement_Cache cache(file, key);
+  size_t num_entries = 0;
+  auto entries = load_all(cache, num_entries);
+  EXPECT_EQ(2, num_entries);
+  expect_equal(make_placements(3), entries[make_pair(a.first, a.second)]);
+  expect_equal(make_placements(1), entries[make_pair(b.first, b.second)]);
+}
+
+TEST(Placement_Cache, keys) {
+  const auto file = fresh_cache_file("keys.epacache");
+  const auto seq = hash_sequence("ACGT");
+
+  // two processes with different references sharing the file
+  Placement_Cache first(file, hash_sequence("reference A"));
+  Placement_Cache second(file, hash_sequence("reference B"));
+
+  first.add(seq, make_placements(2));
+  second.add(seq, make_placements(4));
+  second.flush();
+  first.flush();
+  second.add(hash_sequence("GGGG"), make_placements(1));
+  second.flush();
+
+  size_t num_entries = 0;
+  auto entries = load_all(first, num_entries);
+  EXPECT_EQ(1, num_entries);
+  expect_equal(make_placements(2), entries[make_pair(seq.first, seq.second)]);
+
+  entries = load_all(second, num_entries);
+  EXPECT_EQ(2, num_entries);
+  expect_equal(make_placements(4), entries[make_pair(seq.first, seq.second)]);
+}
+
+TEST(Placement_Cache, incomplete_entry) {
+  const auto file = fresh_cache_file("incomplete.epacache");
+  const auto key = hash_sequence("reference A");
+  const auto a = hash_sequence("ACGT");
+  const auto b = hash_sequence("CCGT");
+
+  {
+    Placement_Cache cache(file, key);
+    cache.add(a, make_placements(2));
+    cache.add(b, make_placements(2));
+    cache.flush();
+  }
+
+  // as if a run crashed in the middle of writing the last entry
+  ifstream in(file, ios::binary | ios::ate);
+  const auto size = static_cast<size_t>(in.tellg());
+  in.close();
+  ASSERT_EQ(0, truncate(file.c_str(), size - 12));
+
+  Placement_Cache cache(file, key);
+  size_t num_entries = 0;
+  auto entries = load_all(cache, num_entries);
+  EXPECT_EQ(1, num_entries);
+  EXPECT_EQ(1, entries.count(make_pair(a.first, a.second)));
+
+  // the next writer cuts it off
+  cache.add(b, make_placements(5));
+  cache.flush();
+
+  Placement_Cache reread(file, key);
+  entries = load_all(reread, num_entries);
+  EXPECT_EQ(2, num_entries);
+  expect_equal(make_placements(5), entries[make_pair(b.first, b.second)]);
+}
+
+TEST(Placement_Cache, flush_while_loading) {
+  const auto file = fresh_cache_file("flush_while_loading.epacache");
+  const auto key = hash_sequence("reference A");
+  const auto a = hash_sequence("ACGT");
+  const auto b = hash_sequence("CCGT");
+
+  {
+    Placement_Cache cache(file, key);
+    cache.add(a, make_placements(2));
+    cache.flush();
+  }
+  // an incomplete entry, which the next writer cuts off
+  {
+    ofstream out(file, ios::binary | ios::app);
+    const uint64_t words[3] = {key.first, key.second, b.first};
+    out.write(reinterpret_cast<char const*>(words), sizeof(words));
+  }
+  ifstream in(file, ios::binary | ios::ate);
+  const auto size = static_cast<size_t>(in.tellg());
+  in.close();
+
+  // a second process writing to the cache while the first one reads it
+  Placement_Cache writer(file, key);
+  writer.add(b, make_placements(3));
+
+  Placement_Cache reader(file, key);
+  future<void> flushed;
+  const auto num_entries =
+      reader.load([&](const Sequence_Hash&, vector<Placement>& placements) {
+        flushed = async(launch::async, [&writer]() { writer.flush(); });
+        // the writer waits for the reader, so the mapped file stays as it is
+        EXPECT_EQ(future_status::timeout, flushed.wait_for(chrono::milliseconds(200)));
+        ifstream in(file, ios::binary | ios::ate);
+        EXPECT_EQ(size, static_cast<size_t>(in.tellg()));
+        expect_equal(make_placements(2), placements);
+      });
+  EXPECT_EQ(1, num_entries);
+  ASSERT_TRUE(flushed.valid());
+  flushed.get();
+
+  Placement_Cache reread(file, key);
+  size_t num_reread = 0;
+  auto entries = load_all(reread, num_reread);
+  EXPECT_EQ(2, num_reread);
+  expect_equal(make_placements(3), entries[make_pair(b.first, b.second)]);
+}
+
+TEST(Placement_Cache, not_a_cache) {
+  const auto file = fresh_cache_file("not_a_cache.epacache");
+  {
+    ofstream out(file);
+    out << ">some\nACGT\n";
+  }
+  Placement_Cache cache(file, hash_sequence("reference A"));
+  size_t num_entries = 0;
+  EXPECT_ANY_THROW(load_all(cache, num_entries));
+}
@@ -0,0 +1,53 @@
+#include "Epatest.hpp"
+
+#include "io/Prefetching_Reader.hpp"
+#include "io/file_io.hpp"
+#include "seq/MSA_Stream.hpp"
+#include "seq/MSA.hpp"
+#include "seq/MSA_Info.hpp"
+
+#include <memory>
+#include <string>
+
+using namespace std;
+
+static void prefetch_test(const size_t max_chunks, const size_t max_bytes) {
+  MSA_Info info(env->combined_file);
+  MSA complete_msa = build_MSA_from_file(env->combined_file, info);
+  const size_t chunk_size = 3;
+
+  Prefetching_Reader reader(make_unique<MSA_Stream>(env->combined_file, info, false), max_chunks,
+                            max_bytes);
+  EXPECT_EQ(reader.num_sequences(), info.sequences());
+
+  MSA_Chunk chunk;
+  size_t i = 0;
+  while (reader.read_next(chunk, chunk_size)) {
+    EXPECT_LE(chunk.size(), chunk_size);
+    for (auto const& s : chunk) {
+      EXPECT_EQ(complete_msa[i].header(), s.header());
+      EXPECT_EQ(complete_msa[i], s);
+      ++i;
+    }
+  }
+  EXPECT_EQ(i, complete_msa.size());
+
+  // stays at the end
+  EXPECT_EQ(reader.read_next(chunk, chunk_size), 0u);
+}
+
+TEST(Prefetching_Reader, reading) {
+  prefetch_test(1, 0);
+  prefetch_test(4, 0);
+  // a single chunk at a time is still let through
+  prefetch_test(4, 1);
+}
+
+TEST(Prefetching_Reader, fixed_chunk_size) {
+  MSA_Info info(env->combined_file);
+  Prefetching_Reader reader(make_unique<MSA_Stream>(env->combined_file, info, false), 2);
+
+  MSA_Chunk chunk;
+  EXPECT_EQ(reader.read_next(chunk, 1), 1u);
+  EXPECT_ANY_THROW(reader.read_next(chunk, 2));
+}
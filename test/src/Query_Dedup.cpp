@@ -0,0 +1,169 @@
+#include "Epatest.hpp"
+
+#include "core/Query_Dedup.hpp"
+#include "seq/Sequence_Hash.hpp"
+#include "seq/MSA_Chunk.hpp"
+#include "sample/Columnar_Sample.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// stand-in for the placement: one placement per query, on the branch of its first site
+static Columnar_Sample place_all(const MSA_Chunk& queries, const size_t seq_id_offset) {
+  Columnar_Sample sample;
+  for (size_t i = 0; i < queries.size(); ++i) {
+    sample.add_pquery(seq_id_offset + i, queries[i].header());
+    sample.add_placement(Placement(static_cast<size_t>(queries[i].sites()[0]), -10.0, 0.1, 0.2));
+  }
+  return sample;
+}
+
+TEST(Query_Dedup, hash_sequence) {
+  EXPECT_EQ(hash_sequence("ACGT-ACGT-ACGT"), hash_sequence(string("ACGT-ACGT-ACGT")));
+  EXPECT_NE(hash_sequence("ACGT-ACGT-ACGT"), hash_sequence("ACGT-ACGT-ACGA"));
+  EXPECT_NE(hash_sequence("A"), hash_sequence("AA"));
+  // differences past the first word
+  EXPECT_NE(hash_sequence("ACGTACGTACGTACGTA"), hash_sequence("ACGTACGTACGTACGTC"));
+}
+
+TEST(Query_Dedup, within_chunk) {
+  MSA_Chunk chunk;
+  chunk.append("a", "ACGT");
+  chunk.append("b", "CCGT");
+  chunk.append("a1", "ACGT");
+  chunk.append("a2", "ACGT");
+  chunk.append("b1", "CCGT");
+  chunk.append("c", "GCGT");
+
+  Query_Dedup dedup;
+  MSA_Chunk unique;
+  dedup.reduce(chunk, unique);
+
+  ASSERT_EQ(3, unique.size());
+  EXPECT_EQ(3, dedup.num_duplicates());
+  EXPECT_EQ("a", unique[0].header());
+  EXPECT_EQ("b", unique[1].header());
+  EXPECT_EQ("c", unique[2].header());
+  EXPECT_EQ(string("GCGT"), unique[2].sites());
+
+  auto sample = place_all(unique, 100);
+  dedup.expand(chunk, sample, 100);
+
+  ASSERT_EQ(3, sample.size());
+  EXPECT_EQ(vector<string>({"a", "a1", "a2"}), sample.names(0));
+  EXPECT_EQ(vector<string>({"b", "b1"}), sample.names(1));
+  EXPECT_EQ(vector<string>({"c"}), sample.names(2));
+}
+
+TEST(Query_Dedup, across_chunks) {
+  Query_Dedup dedup;
+  MSA_Chunk unique;
+
+  MSA_Chunk first;
+  first.append("a", "ACGT");
+  first.append("b", "CCGT");
+  dedup.reduce(first, unique);
+  auto first_sample = place_all(unique, 0);
+  dedup.expand(first, first_sample, 0);
+  ASSERT_EQ(2, first_sample.size());
+  dedup.record(first_sample, 0);
+  EXPECT_EQ(2, dedup.num_results());
+
+  MSA_Chunk second;
+  second.append("b1", "CCGT");
+  second.append("d", "TCGT");
+  second.append("b2", "CCGT");
+  dedup.reduce(second, unique);
+
+  ASSERT_EQ(1, unique.size());
+  EXPECT_EQ("d", unique[0].header());
+
+  auto second_sample = place_all(unique, 2);
+  dedup.expand(second, second_sample, 2);
+
+  // the queries known from the first chunk share one pquery with the results of back then
+  ASSERT_EQ(2, second_sample.size());
+  EXPECT_EQ("d", second_sample.header(0));
+  EXPECT_EQ(vector<string>({"b1", "b2"}), second_sample.names(1));
+  ASSERT_EQ(1, second_sample.num_placements(1));
+  EXPECT_EQ(first_sample.placement(1).branch_id(), second_sample.placement(1).branch_id());
+  // ids stay within the range of the chunk
+  EXPECT_EQ(3, second_sample.sequence_id(1));
+
+  // only the newly placed query is kept
+  dedup.record(second_sample, 2);
+  EXPECT_EQ(3, dedup.num_results());
+  EXPECT_EQ(hash_sequence("TCGT"), dedup.result_hash(2));
+}
+
+TEST(Query_Dedup, filtered_out) {
+  MSA_Chunk chunk;
+  chunk.append("a", "ACGT");
+  chunk.append("a1", "ACGT");
+
+  Query_Dedup dedup;
+  MSA_Chunk unique;
+  dedup.reduce(chunk, unique);
+
+  // no placements survived for the query
+  Columnar_Sample sample;
+  dedup.expand(chunk, sample, 0);
+  EXPECT_EQ(0, sample.size());
+}
+
+TEST(Query_Dedup, bounded) {
+  Query_Dedup dedup(1);
+  MSA_Chunk unique;
+  vector<Sequence_Hash> recorded;
+  auto const on_record = [&recorded](const Sequence_Hash& hash, const vector<Placement>&) {
+    recorded.push_back(hash);
+  };
+
+  MSA_Chunk first;
+  first.append("a", "ACGT");
+  first.append("b", "CCGT");
+  first.append("b1", "CCGT");
+  dedup.reduce(first, unique);
+  ASSERT_EQ(2, unique.size());
+  auto first_sample = place_all(unique, 0);
+  dedup.expand(first, first_sample, 0);
+  dedup.record(first_sample, 0, on_record);
+
+  // every placed query is passed on, but only the first one is kept
+  EXPECT_EQ(vector<Sequence_Hash>({hash_sequence("ACGT"), hash_sequence("CCGT")}), recorded);
+  EXPECT_EQ(1, dedup.num_results());
+  EXPECT_TRUE(dedup.full());
+
+  // the query that was not kept is placed again, still only once within its chunk
+  MSA_Chunk second;
+  second.append("a1", "ACGT");
+  second.append("b2", "CCGT");
+  second.append("b3", "CCGT");
+  dedup.reduce(second, unique);
+  ASSERT_EQ(1, unique.size());
+  EXPECT_EQ("b2", unique[0].header());
+  EXPECT_EQ(2, dedup.num_duplicates());
+
+  dedup.add_result(hash_sequence("TCGT"), {});
+  EXPECT_EQ(1, dedup.num_results());
+}
+
+TEST(Query_Dedup, within_chunk_only) {
+  Query_Dedup dedup(0);
+  MSA_Chunk unique;
+
+  MSA_Chunk chunk;
+  chunk.append("a", "ACGT");
+  chunk.append("a1", "ACGT");
+  dedup.reduce(chunk, unique);
+  auto sample = place_all(unique, 0);
+  dedup.expand(chunk, sample, 0);
+  dedup.record(sample, 0);
+  EXPECT_EQ(0, dedup.num_results());
+
+  dedup.reduce(chunk, unique);
+  EXPECT_EQ(1, unique.size());
+  EXPECT_EQ(1, dedup.num_duplicates());
+}
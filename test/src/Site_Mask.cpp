@@ -0,0 +1,68 @@
+#include "Epatest.hpp"
+
+#include "seq/Site_Mask.hpp"
+#include "seq/MSA_Info.hpp"
+
+#include "genesis/sequence/functions/functions.hpp"
+#include "genesis/sequence/sequence.hpp"
+
+#include <string>
+#include <vector>
+#include <random>
+
+using namespace std;
+
+static string random_sequence(const size_t length, mt19937& gen) {
+  const string chars = "ACGT-.?NXacgtn";
+  uniform_int_distribution<size_t> dist(0, chars.size() - 1);
+  string seq(length, 'A');
+  for (auto& c : seq) {
+    c = chars[dist(gen)];
+  }
+  return seq;
+}
+
+TEST(Site_Mask, gap_sites) {
+  mt19937 gen(42);
+  // around the word size, as well as wider
+  for (const size_t length : {1ul, 63ul, 64ul, 65ul, 200ul, 1031ul}) {
+    MSA_Info::mask_type expected(length, true);
+    Site_Mask mask(length, true);
+    for (size_t i = 0; i < 5; ++i) {
+      const auto seq = random_sequence(length, gen);
+      expected &= genesis::sequence::gap_sites(genesis::sequence::Sequence("", seq));
+      mask.and_gap_sites(seq);
+      EXPECT_EQ(expected, mask.to_bitvector());
+      EXPECT_EQ(expected.count(), mask.count());
+    }
+    EXPECT_THROW(mask.and_gap_sites(string(length + 1, '-')), runtime_error);
+  }
+}
+
+TEST(Site_Mask, subset_sequence) {
+  mt19937 gen(7);
+  bernoulli_distribution masked(0.3);
+  for (const size_t length : {0ul, 5ul, 64ul, 100ul, 1000ul}) {
+    // random masks, plus runs of masked and unmasked sites
+    for (size_t m = 0; m < 3; ++m) {
+      MSA_Info::mask_type bits(length, false);
+      for (size_t i = 0; i < length; ++i) {
+        if ((m == 0 and masked(gen)) or (m == 1 and (i / 70) % 2) or m == 2) {
+          bits.set(i);
+        }
+      }
+      const Site_Mask mask(bits);
+      EXPECT_EQ(bits, mask.to_bitvector());
+
+      const auto seq = random_sequence(length, gen);
+      string expected;
+      for (size_t i = 0; i < length; ++i) {
+        if (not bits[i]) {
+          expected += seq[i];
+        }
+      }
+      EXPECT_EQ(expected, subset_sequence(seq, mask));
+      EXPECT_EQ(expected, subset_sequence(seq, bits));
+    }
+  }
+}
@@ -17,3 +17,46 @@ TEST(encoding, 4bit) {
   // printf("%s\n", input.c_str());
   // printf("%s\n", unpacked.c_str());
 }
+
+TEST(encoding, 4bit_blocks) {
+  FourBit converter;
+
+  // long enough for the vectorized kernels, with a tail and lowercase characters
+  std::string input;
+  for (size_t i = 0; i < 301; ++i) {
+    input.push_back(NT_MAP[(i * 7) % NT_MAP_SIZE]);
+  }
+  std::string mixed_case(input);
+  for (size_t i = 0; i < mixed_case.size(); i += 3) {
+    mixed_case[i] = std::tolower(mixed_case[i]);
+  }
+
+  const auto packed = converter.to_fourbit(mixed_case);
+  EXPECT_EQ(converter.from_fourbit(packed, input.size()), input);
+
+  // characters outside of NT_MAP are rejected, wherever they are
+  for (const size_t pos : {size_t(0), size_t(101), input.size() - 1}) {
+    std::string unknown(input);
+    unknown[pos] = 'E';
+    EXPECT_THROW(converter.to_fourbit(unknown), std::runtime_error);
+  }
+}
+
+TEST(encoding, 5bit) {
+  FiveBit converter;
+  const std::string input("ACDEFGHIKLMNPQRSTVWY-XBZacdefghik---lmnpqrstvwyxbz");
+
+  const auto packed = converter.to_fivebit(input);
+  EXPECT_EQ(packed.size(), (input.size() * 5 + 7) / 8);
+
+  std::string unpacked(input.size(), '\0');
+  converter.from_fivebit(packed.data(), input.size(), &unpacked[0]);
+  EXPECT_STRCASEEQ(input.c_str(), unpacked.c_str());
+
+  const std::vector<size_t> sites{0, 7, 8, 33, input.size() - 1};
+  std::string subset(sites.size(), '\0');
+  converter.from_fivebit(packed.data(), sites, &subset[0]);
+  EXPECT_EQ(subset, "AIK-Z");
+
+  EXPECT_THROW(converter.to_fivebit("AC*"), std::runtime_error);
+}
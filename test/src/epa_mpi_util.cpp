@@ -0,0 +1,42 @@
+#include "Epatest.hpp"
+
+#include "net/epa_mpi_util.hpp"
+
+#include <numeric>
+#include <vector>
+
+using namespace std;
+
+TEST(epa_mpi_util, weighted_seq_package) {
+  // uniform weights split like the count based packages
+  vector<double> uniform(12, 1.0);
+  for (size_t rank = 0; rank < 4; ++rank) {
+    const auto package = weighted_seq_package(uniform, 4, rank);
+    EXPECT_EQ(package.first, rank * 3);
+    EXPECT_EQ(package.second, 3u);
+  }
+
+  // one heavy sequence gets a rank of its own
+  vector<double> skewed{1.0, 1.0, 1.0, 1.0, 12.0, 1.0, 1.0, 1.0, 1.0};
+  const auto first = weighted_seq_package(skewed, 3, 0);
+  const auto second = weighted_seq_package(skewed, 3, 1);
+  const auto third = weighted_seq_package(skewed, 3, 2);
+  EXPECT_EQ(first.first, 0u);
+  EXPECT_EQ(first.second, 4u);
+  EXPECT_EQ(second.first, 4u);
+  EXPECT_EQ(second.second, 1u);
+  EXPECT_EQ(third.first, 5u);
+  EXPECT_EQ(third.second, 4u);
+
+  // the packages are contiguous and cover everything, even with more ranks than sequences
+  vector<double> weights{3.0, 0.5, 7.0, 2.0, 2.0};
+  for (size_t num_ranks : {1u, 2u, 3u, 8u}) {
+    size_t next = 0;
+    for (size_t rank = 0; rank < num_ranks; ++rank) {
+      const auto package = weighted_seq_package(weights, num_ranks, rank);
+      EXPECT_EQ(package.first, next);
+      next += package.second;
+    }
+    EXPECT_EQ(next, weights.size());
+  }
+}
@@ -13,6 +13,7 @@
 #include "seq/MSA.hpp"
 
 #include <string>
+#include <cstring>
 
 using namespace std;
 
@@ -67,7 +68,7 @@ static void precompute_clvs_test(Options o) {
   // auto valid_map = vector<Range>(nums.tip_nodes);
   link_tree_msa(tree, part, model, msa, nums.tip_nodes);
 
-  optimize(model, tree, part, nums, o.opt_branches, o.opt_model);
+  optimize(model, tree, part, nums, o.opt_branches, o.opt_model, o.num_threads);
 
   precompute_clvs(tree, part, nums);
 
@@ -137,6 +138,53 @@ TEST(epa_pll_util, precompute_clvs) {
   precompute_clvs_test(o);
 }
 
+static pll_partition_t* precomputed_partition(Options const& o, pll_utree_t*& tree,
+                                              unsigned int const num_threads) {
+  auto msa = build_MSA_from_file(env->reference_file, MSA_Info(env->reference_file), o.premasking);
+  Tree_Numbers nums;
+  raxml::Model model;
+
+  rtree_mapper dummy;
+  tree = build_tree_from_file(env->tree_file, nums, dummy);
+  auto part = make_partition(model, nums, msa.num_sites(), o);
+
+  set_unique_clv_indices(get_root(tree), nums.tip_nodes);
+  link_tree_msa(tree, part, model, msa, nums.tip_nodes);
+
+  precompute_clvs(tree, part, nums, num_threads);
+
+  return part;
+}
+
+TEST(epa_pll_util, precompute_clvs_parallel) {
+  Options o;
+  pll_utree_t* serial_tree;
+  pll_utree_t* parallel_tree;
+  auto serial = precomputed_partition(o, serial_tree, 1);
+  auto parallel = precomputed_partition(o, parallel_tree, 4);
+
+  // tests
+  const size_t scaler_size = (serial->attributes & PLL_ATTRIB_RATE_SCALERS)
+                                 ? serial->sites * serial->rate_cats
+                                 : serial->sites;
+  for (size_t i = serial->tips; i < serial->tips + serial->clv_buffers; ++i) {
+    const auto clv_size = pll_get_clv_size(serial, i);
+    ASSERT_EQ(clv_size, pll_get_clv_size(parallel, i));
+    EXPECT_EQ(memcmp(serial->clv[i], parallel->clv[i], clv_size * sizeof(double)), 0);
+  }
+  for (size_t i = 0; i < serial->scale_buffers; ++i) {
+    EXPECT_EQ(memcmp(serial->scale_buffer[i], parallel->scale_buffer[i],
+                     scaler_size * sizeof(unsigned int)),
+              0);
+  }
+
+  // teardown
+  pll_partition_destroy(serial);
+  pll_partition_destroy(parallel);
+  pll_utree_destroy(serial_tree, nullptr);
+  pll_utree_destroy(parallel_tree, nullptr);
+}
+
 TEST(epa_pll_util, split_combined_msa) {
   // buildup
   auto combined_msa = build_MSA_from_file(env->combined_file, MSA_Info(env->combined_file), true);
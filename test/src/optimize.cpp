@@ -1,9 +1,15 @@
 #include "Epatest.hpp"
 
 #include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
 
 #include "core/pll/optimize.hpp"
+#include "core/pll/Partials_Cache.hpp"
 #include "core/pll/epa_pll_util.hpp"
+#include "core/pll/pll_util.hpp"
+#include "core/pll/rtree_mapper.hpp"
 #include "io/file_io.hpp"
 #include "util/Options.hpp"
 #include "tree/Tree.hpp"
@@ -99,4 +105,163 @@
 //     // printf("%f\n", l);
 //   }
 
-// }
\ No newline at end of file
+// }
+
+static double edge_logl(pll_partition_t* partition, pll_unode_t const* const edge) {
+  std::vector<unsigned int> param_indices(partition->rate_cats, 0);
+  return pll_compute_edge_loglikelihood(partition, edge->clv_index, edge->scaler_index,
+                                        edge->back->clv_index, edge->back->scaler_index,
+                                        edge->pmatrix_index, &param_indices[0], nullptr);
+}
+
+TEST(optimize, partials_cache) {
+  // buildup
+  auto msa = build_MSA_from_file(env->reference_file, MSA_Info(env->reference_file), true);
+  Tree_Numbers nums;
+  raxml::Model model;
+  rtree_mapper dummy;
+  auto tree = build_tree_from_file(env->tree_file, nums, dummy);
+  auto part = make_partition(model, nums, msa.num_sites(), Options());
+  set_unique_clv_indices(get_root(tree), nums.tip_nodes);
+  link_tree_msa(tree, part, model, msa, nums.tip_nodes);
+
+  std::vector<pll_unode_t*> travbuffer(nums.nodes);
+  std::vector<double> branch_lengths(nums.branches);
+  std::vector<unsigned int> matrix_indices(nums.branches);
+  std::vector<pll_operation_t> operations(nums.nodes);
+
+  std::vector<pll_unode_t*> branches(nums.branches);
+  utree_query_branches(tree, &branches[0]);
+
+  Partials_Cache cache(part);
+
+  // traverses via the cache, then checks the result against a full traversal
+  auto check = [&](pll_unode_t* root) {
+    if (not root->next) {
+      root = root->back;
+    }
+    traverse_update_partials(root, part, &travbuffer[0], &branch_lengths[0], &matrix_indices[0],
+                             &operations[0], &cache);
+    const auto cached_logl = edge_logl(part, root);
+    std::vector<std::vector<double>> cached_clvs;
+    for (auto const node : travbuffer) {
+      if (node->next) {
+        auto const clv = part->clv[node->clv_index];
+        cached_clvs.emplace_back(clv, clv + pll_get_clv_size(part, node->clv_index));
+      }
+    }
+
+    traverse_update_partials(root, part, &travbuffer[0], &branch_lengths[0], &matrix_indices[0],
+                             &operations[0]);
+    EXPECT_DOUBLE_EQ(edge_logl(part, root), cached_logl);
+    size_t i = 0;
+    for (auto const node : travbuffer) {
+      if (node->next) {
+        auto const& expected = cached_clvs[i++];
+        EXPECT_EQ(0, memcmp(&expected[0], part->clv[node->clv_index],
+                            expected.size() * sizeof(double)));
+      }
+    }
+  };
+
+  // tests
+  auto const root = get_root(tree);
+  check(root);
+  // nothing changed
+  check(root);
+
+  // a branch length
+  auto const branch = branches[nums.branches / 2];
+  branch->length = branch->back->length = branch->length * 2.0 + 0.05;
+  check(root);
+
+  // a model parameter
+  const auto num_rates = model.subst_rates(0).size();
+  std::vector<double> rates(part->subst_params[0], part->subst_params[0] + num_rates);
+  rates[0] *= 1.5;
+  pll_set_subst_params(part, 0, &rates[0]);
+  cache.invalidate();
+  check(root);
+
+  // another root, and a change behind it
+  check(branches[1]);
+  branches[2]->length = branches[2]->back->length = 0.25;
+  check(branches[1]);
+  check(root);
+
+  // teardown
+  pll_partition_destroy(part);
+  pll_utree_destroy(tree, nullptr);
+}
+
+struct Optimized_Reference {
+  std::vector<double> subst_rates;
+  std::vector<double> ratecat_rates;
+  std::vector<double> branch_lengths;
+  double logl;
+};
+
+static Optimized_Reference optimize_reference(const unsigned int num_threads) {
+  // buildup
+  auto msa = build_MSA_from_file(env->reference_file, MSA_Info(env->reference_file), true);
+  Tree_Numbers nums;
+  raxml::Model model;
+  rtree_mapper dummy;
+  auto tree = build_tree_from_file(env->tree_file, nums, dummy);
+  auto part = make_partition(model, nums, msa.num_sites(), Options());
+  set_unique_clv_indices(get_root(tree), nums.tip_nodes);
+  link_tree_msa(tree, part, model, msa, nums.tip_nodes);
+
+  // the optimization picks its roots at random
+  srand(42);
+  optimize(model, tree, part, nums, true, true, num_threads);
+
+  Optimized_Reference result;
+  result.subst_rates = model.subst_rates(0);
+  result.ratecat_rates = model.ratecat_rates();
+
+  std::vector<pll_unode_t*> branches(nums.branches);
+  utree_query_branches(tree, &branches[0]);
+  for (auto const branch : branches) {
+    result.branch_lengths.push_back(branch->length);
+  }
+
+  std::vector<pll_unode_t*> travbuffer(nums.nodes);
+  std::vector<double> branch_lengths(nums.branches);
+  std::vector<unsigned int> matrix_indices(nums.branches);
+  std::vector<pll_operation_t> operations(nums.nodes);
+  auto root = get_root(tree);
+  if (not root->next) {
+    root = root->back;
+  }
+  traverse_update_partials(root, part, &travbuffer[0], &branch_lengths[0], &matrix_indices[0],
+                           &operations[0]);
+  result.logl = edge_logl(part, root);
+
+  // teardown
+  pll_partition_destroy(part);
+  pll_utree_destroy(tree, nullptr);
+
+  return result;
+}
+
+static void expect_close(std::vector<double> const& expected, std::vector<double> const& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], actual[i], 1e-2 * std::fabs(expected[i]) + 1e-3);
+  }
+}
+
+TEST(optimize, threads) {
+  const auto serial = optimize_reference(1);
+
+  for (const unsigned int num_threads : {2u, 4u}) {
+    const auto sliced = optimize_reference(num_threads);
+
+    // the same optimization, up to the order in which the sites are summed up
+    EXPECT_NEAR(serial.logl, sliced.logl, OPT_EPSILON);
+    expect_close(serial.subst_rates, sliced.subst_rates);
+    expect_close(serial.ratecat_rates, sliced.ratecat_rates);
+    expect_close(serial.branch_lengths, sliced.branch_lengths);
+  }
+}
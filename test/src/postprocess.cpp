@@ -0,0 +1,98 @@
+#include "Epatest.hpp"
+
+#include "core/postprocess.hpp"
+#include "sample/Columnar_Sample.hpp"
+#include "sample/Sample.hpp"
+#include "io/jplace_util.hpp"
+#include "set_manipulators.hpp"
+#include "util/Options.hpp"
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <random>
+
+using namespace std;
+
+static string jplace_string(Sample<Placement> const& sample, const Options& options) {
+  rtree_mapper mapper;
+  ostringstream out;
+  out.precision(options.precision);
+  out.setf(ios::fixed, ios::floatfield);
+  sample_to_jplace_string(sample, out, mapper);
+  return out.str();
+}
+
+static string join(vector<string> const& buffers) {
+  string result;
+  for (auto const& buffer : buffers) {
+    result += buffer;
+  }
+  return result;
+}
+
+TEST(postprocess, same_as_separate_steps) {
+  mt19937 gen(5);
+  for (const bool accumulated : {false, true}) {
+    for (const unsigned int num_threads : {1u, 3u}) {
+      Options options;
+      options.acc_threshold = accumulated;
+      options.support_threshold = accumulated ? 0.95 : 0.02;
+      options.filter_max = 5;
+      options.num_threads = num_threads;
+
+      auto sample = random_sample(40, gen);
+      Columnar_Sample columnar(sample);
+
+      rtree_mapper mapper;
+      const auto buffers = postprocess(columnar, columnar.size(), options, mapper);
+
+      compute_and_set_lwr(sample);
+      filter(sample, options);
+      EXPECT_EQ(jplace_string(sample, options), join(buffers));
+
+      // the sample keeps the placements that were written
+      ASSERT_EQ(sample.size(), columnar.size());
+      for (size_t q = 0; q < sample.size(); ++q) {
+        ASSERT_EQ(sample.at(q).size(), columnar.num_placements(q));
+        for (size_t k = 0; k < sample.at(q).size(); ++k) {
+          const auto p = columnar.placement(columnar.begin(q) + k);
+          EXPECT_EQ(sample.at(q).at(k).branch_id(), p.branch_id());
+          EXPECT_DOUBLE_EQ(sample.at(q).at(k).lwr(), p.lwr());
+        }
+      }
+    }
+  }
+}
+
+TEST(postprocess, final_queries) {
+  mt19937 gen(6);
+  Options options;
+  options.filter_max = 2;
+
+  // the last queries are final already: written as they are
+  auto sample = random_sample(6, gen);
+  for (auto& pq : sample) {
+    for (auto& p : pq) {
+      p.lwr(0.25);
+    }
+  }
+  Columnar_Sample columnar(sample);
+
+  rtree_mapper mapper;
+  const auto buffers = postprocess(columnar, 4, options, mapper);
+
+  auto expected = sample;
+  Sample<Placement> placed;
+  for (size_t q = 0; q < 4; ++q) {
+    placed.push_back(sample.at(q));
+  }
+  compute_and_set_lwr(placed);
+  filter(placed, options);
+  for (size_t q = 0; q < 4; ++q) {
+    expected[q] = placed[q];
+  }
+  EXPECT_EQ(jplace_string(expected, options), join(buffers));
+  EXPECT_EQ(sample.at(5).size(), columnar.num_placements(5));
+  EXPECT_EQ(0.25, columnar.placement(columnar.begin(5)).lwr());
+}
@@ -0,0 +1,64 @@
+#include "Epatest.hpp"
+
+#include "io/store_encoding.hpp"
+
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+static vector<double> make_clv(const size_t sites, const size_t span) {
+  vector<double> clv(sites * span);
+  for (size_t i = 0; i < clv.size(); ++i) {
+    // values of widely differing magnitude across sites, far below the range of float, and zeros
+    clv[i] = (i % 7) ? std::ldexp(1.0 / (1 + i % span), -static_cast<int>(i / span) * 10) : 0.0;
+  }
+  return clv;
+}
+
+TEST(store_encoding, float32) {
+  const size_t span = 16;
+  auto clv = make_clv(50, span);
+  auto encoded = encode_float32(clv.data(), clv.size(), span);
+  EXPECT_LT(encoded.size(), clv.size() * sizeof(double));
+
+  vector<double> decoded(clv.size());
+  decode_float32(encoded.data(), encoded.size(), decoded.data(), decoded.size(), span);
+  for (size_t i = 0; i < clv.size(); ++i) {
+    EXPECT_NEAR(clv[i], decoded[i], std::abs(clv[i]) * 1e-7);
+  }
+}
+
+TEST(store_encoding, scaled16) {
+  const size_t span = 16;
+  auto clv = make_clv(50, span);
+  auto encoded = encode_scaled16(clv.data(), clv.size(), span);
+  EXPECT_LT(encoded.size(), clv.size() * sizeof(float));
+
+  vector<double> decoded(clv.size());
+  decode_scaled16(encoded.data(), encoded.size(), decoded.data(), decoded.size(), span);
+  for (size_t site = 0; site < clv.size() / span; ++site) {
+    const auto max = *max_element(&clv[site * span], &clv[site * span] + span);
+    for (size_t i = site * span; i < (site + 1) * span; ++i) {
+      EXPECT_NEAR(clv[i], decoded[i], max * 1e-4);
+    }
+  }
+}
+
+TEST(store_encoding, rle) {
+  vector<unsigned int> scaler(100, 0);
+  scaler[10] = 1;
+  scaler[11] = 1;
+  scaler[99] = 3;
+
+  auto encoded = encode_rle(scaler.data(), scaler.size());
+  EXPECT_EQ(encoded.size(), 4 * 2 * sizeof(uint32_t));
+  ASSERT_EQ(decoded_rle_size(encoded.data(), encoded.size()), scaler.size());
+
+  vector<unsigned int> decoded(scaler.size());
+  decode_rle(encoded.data(), encoded.size(), decoded.data(), decoded.size());
+  EXPECT_EQ(scaler, decoded);
+
+  EXPECT_THROW(decode_rle(encoded.data(), encoded.size(), decoded.data(), 10),
+               std::runtime_error);
+}